@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/byte_classes.h"
+#include "../src/pii_detector.h"
+
+// 1 GB of office text (a 64 MB corpus scanned 16 times) through each byte
+// classifier kernel the CPU supports: walking every digit and '@' anchor
+// alone, and built-in PII detection streamed in 1 MB chunks, which tries
+// only the offsets near those anchors.
+
+static std::string build_corpus(size_t bytes) {
+    static const char *prose[] = {
+        "the", "quarterly", "report", "was", "sent", "to", "Finance", "on", "Monday,", "see", "attached",
+        "notes.", "Please", "review", "the", "draft", "before", "Thursday", "and", "forward", "comments.",
+        "Revenue", "grew", "in", "the", "third", "quarter", "while", "costs", "held", "steady", "across", "regions.\n"};
+    static const char *identifiers[] = {"jane.doe@example.com", "+1 (555) 010-0199", "4111 1111 1111 1111",
+                                        "GB82WEST12345698765432", "AB1234567", "2024-03-17", "1,250.00",
+                                        "page 3", "room 214"};
+    std::mt19937 rng(11);
+    std::string text;
+    text.reserve(bytes + 64);
+    while (text.size() < bytes) {
+        // A few identifiers or numbers per kilobyte, as in ordinary documents.
+        if (rng() % 100 < 2) {
+            text += identifiers[rng() % (sizeof(identifiers) / sizeof(identifiers[0]))];
+        } else {
+            text += prose[rng() % (sizeof(prose) / sizeof(prose[0]))];
+        }
+        text += ' ';
+    }
+    return text;
+}
+
+template <typename Fn>
+static double gb_per_second(size_t bytes, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return bytes / seconds / (1024.0 * 1024.0 * 1024.0);
+}
+
+int main() {
+    const std::string corpus = build_corpus(64 * 1024 * 1024);
+    const int passes = 16;
+    const size_t total = corpus.size() * passes;
+    const size_t chunk = 1024 * 1024;
+    const PiiPatterns patterns({});
+    for (ByteKernel kernel : {ByteKernel::Scalar, ByteKernel::Sse2, ByteKernel::Avx2}) {
+        if (!set_byte_kernel(kernel)) continue;
+        uint64_t anchors = 0;
+        double walk = gb_per_second(total, [&] {
+            for (int p = 0; p < passes; ++p) {
+                ByteMasks masks;
+                for (size_t i = 0; i < corpus.size(); i += 32) {
+                    i += find_anchor_block(corpus.data() + i, corpus.size() - i, masks);
+                    anchors += static_cast<uint64_t>(__builtin_popcount(masks.digit | masks.at));
+                }
+            }
+        });
+        size_t detections = 0;
+        double detect = gb_per_second(total, [&] {
+            for (int p = 0; p < passes; ++p) {
+                PiiStream stream(patterns, 256);
+                for (size_t i = 0; i < corpus.size(); i += chunk) {
+                    stream.feed(corpus.data() + i, std::min(chunk, corpus.size() - i));
+                }
+                detections += stream.finish().size();
+            }
+        });
+        std::printf("%-6s anchors %6.2f GB/s (%llu found), built-in PII %5.2f GB/s (%zu detections)\n",
+                    byte_kernel_name(kernel), walk, static_cast<unsigned long long>(anchors / passes), detect,
+                    detections / passes);
+    }
+    return 0;
+}
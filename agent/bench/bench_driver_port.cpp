@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/driver_port.h"
+#include "../src/work_queue.h"
+
+// Creates from many processes against a simulated minifilter port: one
+// message in flight at a time (the old driver_policy_thread) against a pool
+// of workers with several requests outstanding. Evaluation is modelled as a
+// short CPU scan plus, for one create in 20, a wait on disk.
+
+using Clock = std::chrono::steady_clock;
+
+class SimulatedPort : public DriverMessageSource {
+public:
+    explicit SimulatedPort(size_t outstanding) : queries_(outstanding) {}
+
+    // Blocks like the create would in the kernel until its reply arrives.
+    void create(uint32_t pid, std::string path) {
+        DriverQuery query;
+        query.process_id = pid;
+        query.path = std::move(path);
+        std::future<DlpPolicyDecision> verdict;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            query.message_id = ++next_id_;
+            verdict = waiting_[query.message_id].get_future();
+        }
+        while (!queries_.push(query)) std::this_thread::yield();
+        verdict.get();
+    }
+
+    void close() { queries_.close(); }
+
+    bool receive(DriverQuery &query) override { return queries_.pop(query); }
+
+    void reply(uint64_t message_id, const DlpPolicyDecision &decision) override {
+        std::promise<DlpPolicyDecision> waiter;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = waiting_.find(message_id);
+            if (found == waiting_.end()) return;
+            waiter = std::move(found->second);
+            waiting_.erase(found);
+        }
+        waiter.set_value(decision);
+    }
+
+private:
+    BoundedQueue<DriverQuery> queries_;
+    std::mutex mutex_;
+    uint64_t next_id_ = 0;
+    std::unordered_map<uint64_t, std::promise<DlpPolicyDecision>> waiting_;
+};
+
+static DlpPolicyDecision evaluate(const DriverQuery &query) {
+    auto until = Clock::now() + std::chrono::microseconds(20);
+    uint32_t h = 2166136261u;
+    while (Clock::now() < until) {
+        for (char c : query.path) h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    if (query.message_id % 20 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    DlpPolicyDecision decision = {};
+    decision.action = DlpPolicyAction::Allow;
+    decision.rule_id = h;
+    return decision;
+}
+
+static void run(const char *label, size_t workers, size_t outstanding, int processes) {
+    SimulatedPort port(outstanding);
+    std::thread server([&] { serve_driver_queries(port, workers, evaluate); });
+    std::atomic<bool> stop{false};
+    std::mutex latencies_mutex;
+    std::vector<double> latencies;
+    std::vector<std::thread> clients;
+    auto start = Clock::now();
+    for (int p = 0; p < processes; ++p) {
+        clients.emplace_back([&, p] {
+            std::vector<double> local;
+            for (int i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+                auto begin = Clock::now();
+                port.create(static_cast<uint32_t>(p), "C:\\Users\\a\\doc-" + std::to_string(i) + ".docx");
+                local.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+            }
+            std::lock_guard<std::mutex> lock(latencies_mutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    stop = true;
+    for (auto &t : clients) t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    port.close();
+    server.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double q) { return latencies[static_cast<size_t>(q * (latencies.size() - 1))]; };
+    std::printf("%-24s %2zu workers %3zu outstanding: %8.0f creates/s, p50 %7.0f us, p99 %7.0f us\n", label,
+                workers, outstanding, latencies.size() / seconds, pct(0.50), pct(0.99));
+}
+
+int main() {
+    const int processes = 16;
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    run("single message", 1, 1, processes);
+    run("completion port pool", hw, 16, processes);
+    run("completion port pool", std::max(4u, hw), 16, processes);
+    return 0;
+}
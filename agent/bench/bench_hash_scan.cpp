@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/rule_engine.h"
+
+// Hash IOC feeds looked up through the digest index against the nested
+// rule/hash string comparison scan_hashes used to do.
+
+static std::string make_hash(uint64_t seed) {
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    uint64_t x = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (int i = 0; i < 64; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        out.push_back(hex[x & 0xF]);
+    }
+    return out;
+}
+
+static size_t nested_scan(const std::vector<Rule> &rules, const std::string &full, const std::string &partial) {
+    size_t hits = 0;
+    for (const auto &rule : rules) {
+        if (rule.type != "hash") continue;
+        for (const auto &hash : rule.hashes) {
+            if (hash == full || hash == partial) {
+                ++hits;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+int main() {
+    g_content_keywords.clear();
+    for (size_t total : {1000u, 100000u, 500000u}) {
+        std::vector<Rule> rules;
+        const size_t per_rule = 5000;
+        for (size_t base = 0; base < total; base += per_rule) {
+            Rule rule;
+            rule.id = "feed-" + std::to_string(base / per_rule);
+            rule.type = "hash";
+            for (size_t i = base; i < base + per_rule && i < total; ++i) {
+                rule.hashes.push_back(make_hash(i));
+            }
+            rules.push_back(rule);
+        }
+        RuleEngine engine;
+        auto build_start = std::chrono::steady_clock::now();
+        engine.load_from_rules(rules);
+        double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+
+        std::vector<std::string> probes;
+        for (size_t i = 0; i < 1000; ++i) {
+            probes.push_back(make_hash(i % 10 == 0 ? i * 7 % total : total + i));
+        }
+        const size_t nested_iters = total > 100000 ? 20 : 200;
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < nested_iters; ++i) {
+            sink += nested_scan(rules, probes[i % probes.size()], probes[(i + 1) % probes.size()]);
+        }
+        double nested_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / nested_iters;
+
+        const size_t index_iters = 200000;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < index_iters; ++i) {
+            sink += engine.scan_hashes(probes[i % probes.size()], probes[(i + 1) % probes.size()]).size();
+        }
+        double index_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / index_iters;
+
+        std::printf("hashes=%zu build=%.1fms nested=%.2fus/event index=%.3fus/event speedup=%.0fx memory=%.1f bytes/hash (sink=%zu)\n",
+                    engine.hash_count(), build_ms, nested_us, index_us, nested_us / index_us,
+                    static_cast<double>(engine.hash_index_bytes()) / engine.hash_count(), sink);
+    }
+    return 0;
+}
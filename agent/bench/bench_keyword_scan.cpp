@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/rule_engine.h"
+
+// Keyword rule scanning with the shared Aho-Corasick automaton against the
+// previous lowercase-and-find loop, for 10, 1k and 50k keywords.
+
+static std::string random_word(std::mt19937 &rng, size_t min_len, size_t max_len) {
+    std::uniform_int_distribution<size_t> len(min_len, max_len);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::string out(len(rng), 'a');
+    for (auto &c : out) c = static_cast<char>(letter(rng));
+    return out;
+}
+
+static std::string to_lower(const std::string &s) {
+    std::string out = s;
+    std::transform(out.begin(), out.end(), out.begin(),
+                   [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+static size_t scan_find_loop(const Rule &rule, const std::string &text) {
+    std::string lower = to_lower(text);
+    size_t count = 0;
+    for (const auto &kw : rule.keywords) {
+        auto kw_lower = to_lower(kw);
+        if (!kw_lower.empty() && lower.find(kw_lower) != std::string::npos) count++;
+    }
+    return count;
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::string text;
+    while (text.size() < 64 * 1024) {
+        text += random_word(rng, 2, 9);
+        text += ' ';
+    }
+    g_content_keywords.clear();
+
+    for (size_t keyword_count : {10, 1000, 50000}) {
+        Rule rule;
+        rule.id = "keywords";
+        rule.type = "keyword";
+        rule.severity = 4;
+        for (size_t i = 0; i < keyword_count; ++i) {
+            rule.keywords.push_back(random_word(rng, 6, 12));
+        }
+        RuleEngine engine;
+        auto load_start = std::chrono::steady_clock::now();
+        engine.load_from_rules({rule});
+        auto load = std::chrono::steady_clock::now() - load_start;
+
+        const size_t naive_iterations = keyword_count >= 50000 ? 1 : 10;
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < naive_iterations; ++i) sink += scan_find_loop(rule, text);
+        auto naive = std::chrono::steady_clock::now() - start;
+
+        const size_t iterations = 50;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            auto hits = engine.scan_text(text);
+            sink += hits.empty() ? 0 : hits.front().match_count;
+        }
+        auto automaton = std::chrono::steady_clock::now() - start;
+
+        double naive_us = std::chrono::duration<double, std::micro>(naive).count() / naive_iterations;
+        double automaton_us = std::chrono::duration<double, std::micro>(automaton).count() / iterations;
+        double mb_per_s = (text.size() / (1024.0 * 1024.0)) / (automaton_us / 1e6);
+        printf("keywords=%zu build=%.1fms find_loop=%.1fus/64KB automaton=%.1fus/64KB (%.0f MB/s) speedup=%.1fx (sink=%zu)\n",
+               keyword_count, std::chrono::duration<double, std::milli>(load).count(),
+               naive_us, automaton_us, mb_per_s, naive_us / automaton_us, sink);
+    }
+    return 0;
+}
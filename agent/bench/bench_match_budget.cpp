@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/pii_detector.h"
+#include "../src/rule_engine.h"
+
+// A log made of email addresses, the pathological case for per-file match
+// budgets: PII detection and a regex rule over it, with every match kept
+// against the configured per-type cap and rule match limit.
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static size_t stream_pii(const std::string &text, const PiiPatterns &patterns, size_t cap) {
+    PiiStream stream(patterns, g_scan_overlap_bytes, cap);
+    for (size_t pos = 0; pos < text.size(); pos += g_scan_chunk_bytes) {
+        stream.feed(text.data() + pos, std::min(g_scan_chunk_bytes, text.size() - pos));
+    }
+    return stream.finish().size();
+}
+
+static size_t stream_rules(const std::string &text, const RuleEngine &engine) {
+    RuleEngine::TextStream stream(engine, g_scan_overlap_bytes);
+    for (size_t pos = 0; pos < text.size(); pos += g_scan_chunk_bytes) {
+        stream.feed(text.data() + pos, std::min(g_scan_chunk_bytes, text.size() - pos));
+    }
+    auto hits = stream.finish();
+    return hits.empty() ? 0 : hits.front().match_count;
+}
+
+int main() {
+    const size_t lines = 20000;
+    std::string log;
+    for (size_t i = 0; i < lines; ++i) {
+        log += "2024-03-17 login ok user" + std::to_string(i) + "@corp.example.com\n";
+    }
+    const PiiPatterns patterns({});
+    Rule email;
+    email.id = "email";
+    email.type = "regex";
+    email.severity = 5;
+    email.pattern = "[a-z0-9.]+@[a-z0-9.]+\\.com";
+    RuleEngine engine;
+    engine.load_from_rules({email});
+
+    auto start = Clock::now();
+    size_t kept = stream_pii(log, patterns, SIZE_MAX);
+    double unbounded = ms_since(start);
+    start = Clock::now();
+    size_t capped = stream_pii(log, patterns, g_pii_max_hits_per_type);
+    double bounded = ms_since(start);
+    std::printf("PII, %zu lines: every detection %8.1f ms (%zu kept), cap %zu/type %6.1f ms (%zu kept)\n", lines,
+                unbounded, kept, g_pii_max_hits_per_type, bounded, capped);
+
+    const size_t limit = g_rule_match_limit;
+    g_rule_match_limit = SIZE_MAX;
+    start = Clock::now();
+    size_t counted = stream_rules(log, engine);
+    unbounded = ms_since(start);
+    g_rule_match_limit = limit;
+    start = Clock::now();
+    size_t limited = stream_rules(log, engine);
+    bounded = ms_since(start);
+    std::printf("regex rule, %zu lines: every match %8.1f ms (count %zu), limit %zu %6.1f ms (count %zu)\n", lines,
+                unbounded, counted, limit, bounded, limited);
+    return 0;
+}
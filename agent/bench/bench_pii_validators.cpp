@@ -0,0 +1,110 @@
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/pii_validators.h"
+
+// Card and IBAN candidates through the previous validators, which copied
+// each value (normalize_digits, substr) and checked one at a time, against
+// the in-place validators and the batched Luhn check.
+
+static bool previous_luhn(const std::string &digits) {
+    int sum = 0;
+    bool alternate = false;
+    for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
+        if (!std::isdigit(static_cast<unsigned char>(*it))) continue;
+        int n = *it - '0';
+        if (alternate) {
+            n *= 2;
+            if (n > 9) n -= 9;
+        }
+        sum += n;
+        alternate = !alternate;
+    }
+    return sum % 10 == 0;
+}
+
+static bool previous_card(const std::string &value) {
+    std::string digits;
+    for (char c : value) {
+        if (std::isdigit(static_cast<unsigned char>(c))) digits.push_back(c);
+    }
+    return digits.size() >= 13 && digits.size() <= 19 && previous_luhn(digits);
+}
+
+static bool previous_iban(const std::string &iban) {
+    std::string rearranged = iban.substr(4) + iban.substr(0, 4);
+    int mod = 0;
+    for (char c : rearranged) {
+        if (std::isspace(static_cast<unsigned char>(c))) continue;
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            mod = (mod * 10 + (c - '0')) % 97;
+        } else if (std::isalpha(static_cast<unsigned char>(c))) {
+            int value = std::toupper(static_cast<unsigned char>(c)) - 'A' + 10;
+            mod = (mod * 10 + (value / 10)) % 97;
+            mod = (mod * 10 + (value % 10)) % 97;
+        } else {
+            return false;
+        }
+    }
+    return mod == 1;
+}
+
+template <typename Fn>
+static double million_per_second(size_t count, int rounds, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) fn();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count * static_cast<double>(rounds) / seconds / 1e6;
+}
+
+int main() {
+    std::mt19937 rng(3);
+    std::vector<std::string> cards;
+    for (int i = 0; i < 100000; ++i) {
+        std::string card;
+        for (int group = 0; group < 4; ++group) {
+            if (group > 0) card += ' ';
+            for (int d = 0; d < 4; ++d) card += static_cast<char>('0' + rng() % 10);
+        }
+        cards.push_back(card);
+    }
+    std::vector<std::string> ibans(100000, "GB82WEST12345698765432");
+    for (auto &iban : ibans) iban[8 + rng() % 14] = static_cast<char>('0' + rng() % 10);
+
+    const int rounds = 20;
+    size_t previous_valid = 0;
+    size_t valid_count = 0;
+    double previous = million_per_second(cards.size(), rounds, [&] {
+        previous_valid = 0;
+        for (const auto &card : cards) previous_valid += previous_card(card);
+    });
+    double single = million_per_second(cards.size(), rounds, [&] {
+        valid_count = 0;
+        for (const auto &card : cards) valid_count += valid_card_number(card);
+    });
+    std::vector<std::string_view> views(cards.begin(), cards.end());
+    std::unique_ptr<bool[]> valid(new bool[views.size()]);
+    double batch = million_per_second(cards.size(), rounds, [&] {
+        valid_card_numbers(views.data(), views.size(), valid.get());
+    });
+    std::printf("cards: previous %6.1f M/s, in place %6.1f M/s, batched %6.1f M/s (%zu/%zu valid)\n", previous,
+                single, batch, previous_valid, valid_count);
+
+    double previous_ibans = million_per_second(ibans.size(), rounds, [&] {
+        previous_valid = 0;
+        for (const auto &iban : ibans) previous_valid += previous_iban(iban);
+    });
+    double ibans_in_place = million_per_second(ibans.size(), rounds, [&] {
+        valid_count = 0;
+        for (const auto &iban : ibans) valid_count += valid_iban(iban);
+    });
+    std::printf("ibans: previous %6.1f M/s, in place %6.1f M/s (%zu/%zu valid)\n", previous_ibans, ibans_in_place,
+                previous_valid, valid_count);
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/policy_image.h"
+#include "../src/rule_engine.h"
+
+// Loads a ~50 MB policy with 100k rules: the single-pass JSON reader against
+// the substring-scanning extractor it replaced, the full load, incremental
+// reloads, and a cold start from the saved policy image.
+
+namespace legacy {
+
+static std::string string_field(const std::string &s, const std::string &key) {
+    auto pos = s.find("\"" + key + "\"");
+    if (pos == std::string::npos) return "";
+    auto colon = s.find(':', pos);
+    if (colon == std::string::npos) return "";
+    auto first = s.find('"', colon + 1);
+    if (first == std::string::npos) return "";
+    auto second = s.find('"', first + 1);
+    if (second == std::string::npos) return "";
+    return s.substr(first + 1, second - first - 1);
+}
+
+static int int_field(const std::string &s, const std::string &key) {
+    auto pos = s.find("\"" + key + "\"");
+    if (pos == std::string::npos) return 0;
+    auto colon = s.find(':', pos);
+    size_t i = colon + 1;
+    while (i < s.size() && s[i] == ' ') ++i;
+    size_t j = i;
+    while (j < s.size() && s[j] >= '0' && s[j] <= '9') ++j;
+    return j > i ? std::stoi(s.substr(i, j - i)) : 0;
+}
+
+static std::vector<std::string> array_field(const std::string &s, const std::string &key) {
+    std::vector<std::string> out;
+    auto pos = s.find("\"" + key + "\"");
+    if (pos == std::string::npos) return out;
+    auto lb = s.find('[', s.find(':', pos));
+    auto rb = s.find(']', lb);
+    if (lb == std::string::npos || rb == std::string::npos) return out;
+    std::istringstream iss(s.substr(lb + 1, rb - lb - 1));
+    std::string token;
+    while (std::getline(iss, token, ',')) {
+        auto first = token.find('"');
+        auto second = first == std::string::npos ? first : token.find('"', first + 1);
+        if (second != std::string::npos) out.push_back(token.substr(first + 1, second - first - 1));
+    }
+    return out;
+}
+
+static std::vector<Rule> parse(const std::string &s) {
+    std::vector<Rule> rules;
+    auto lb = s.find('[', s.find("\"rules\""));
+    int depth = 0;
+    size_t obj_start = std::string::npos;
+    for (size_t i = lb + 1; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '{') {
+            if (depth == 0) obj_start = i;
+            depth++;
+        } else if (c == '}') {
+            depth--;
+            if (depth == 0) {
+                std::string obj = s.substr(obj_start, i - obj_start + 1);
+                Rule rule;
+                rule.id = string_field(obj, "id");
+                rule.name = string_field(obj, "name");
+                rule.type = string_field(obj, "type");
+                rule.priority = int_field(obj, "priority");
+                rule.severity = int_field(obj, "severity");
+                rule.pattern = string_field(obj, "pattern");
+                rule.keywords = array_field(obj, "keywords");
+                rule.hashes = array_field(obj, "hashes");
+                rules.push_back(rule);
+            }
+        } else if (c == ']' && depth == 0) {
+            break;
+        }
+    }
+    return rules;
+}
+
+}  // namespace legacy
+
+static std::string build_policy(size_t count) {
+    std::string out = "{\n  \"policy\": {\"name\": \"bench\", \"version\": 7},\n  \"rules\": [\n";
+    const std::string padding(300, 'x');
+    for (size_t i = 0; i < count; ++i) {
+        std::string n = std::to_string(i);
+        out += i ? ",\n    {" : "    {";
+        out += "\"id\": \"rule-" + n + "\", \"name\": \"Rule \\\"" + n + "\\\"\", \"priority\": " +
+               std::to_string(i % 10) + ", \"severity\": " + std::to_string(i % 11) + ", ";
+        switch (i % 4) {
+            case 0:
+                out += "\"type\": \"keyword\", \"keywords\": [\"alpha" + n + "\", \"beta" + n + "\", \"gamma" + n + "\"], ";
+                break;
+            case 1: {
+                std::string hash(64, "0123456789abcdef"[i % 16]);
+                hash.replace(0, n.size(), n);
+                out += "\"type\": \"hash\", \"hashes\": [\"" + hash + "\"], ";
+                break;
+            }
+            case 2:
+                out += "\"type\": \"regex\", \"pattern\": \"\\\\bCASE-" + n + "-\\\\d{4}\\\\b\", ";
+                break;
+            default:
+                out += "\"conditions\": [{\"field\": \"file.extension\", \"op\": \"==\", \"value\": \".e" + n + "\"}], ";
+                break;
+        }
+        out += "\"actions\": [\"alert\"], \"enabled\": true, \"description\": \"" + padding + "\"}";
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
+template <typename Fn>
+static double time_ms(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    g_content_keywords.clear();
+    const std::string policy = build_policy(100000);
+    size_t legacy_rules = 0;
+    size_t parsed_rules = 0;
+    double legacy_ms = time_ms([&] { legacy_rules = legacy::parse(policy).size(); });
+    double parse_ms = time_ms([&] {
+        std::vector<Rule> rules;
+        parse_rules_json(policy, rules);
+        parsed_rules = rules.size();
+    });
+    RuleEngine engine;
+    double load_ms = time_ms([&] { engine.load_from_string(policy); });
+    std::printf("policy=%.1fMB rules=%zu/%zu legacy_parse=%.0fms json_parse=%.0fms (%.0f MB/s, %.1fx) full_load=%.0fms\n",
+                policy.size() / 1048576.0, parsed_rules, legacy_rules, legacy_ms, parse_ms,
+                policy.size() / 1048576.0 / (parse_ms / 1000.0), legacy_ms / parse_ms, load_ms);
+
+    RuleEngine reloaded;
+    double same_ms = time_ms([&] { reloaded.load_from_string(policy, {}, &engine); });
+    std::string edited = policy;
+    edited.replace(edited.find("\".e3\""), 5, "\".x3\"");
+    RuleEngine condition_edit;
+    double condition_ms = time_ms([&] { condition_edit.load_from_string(edited, {}, &reloaded); });
+    edited.replace(edited.find("CASE-2-"), 7, "CASF-2-");
+    RuleEngine regex_edit;
+    double regex_ms = time_ms([&] { regex_edit.load_from_string(edited, {}, &condition_edit); });
+    std::printf("reload: unchanged=%.0fms (%zu reused) condition_edit=%.0fms (%zu rebuilt) regex_edit=%.0fms (%zu rebuilt)\n",
+                same_ms, reloaded.reload_stats().reused_rules, condition_ms,
+                condition_edit.reload_stats().compiled_rules, regex_ms, regex_edit.reload_stats().compiled_rules);
+
+    const char *image_path = "bench_policy_image.bin";
+    uint64_t key = PolicyImage::source_key(policy, {});
+    double save_ms = time_ms([&] { PolicyImage::save(engine, image_path, key); });
+    RuleEngine mapped;
+    bool mapped_ok = false;
+    double image_ms = time_ms([&] { mapped_ok = PolicyImage::load(mapped, image_path, key); });
+    std::printf("image: save=%.0fms load=%.0fms (%.1fx vs full_load) rules=%zu ok=%d\n", save_ms, image_ms,
+                load_ms / image_ms, mapped.rules().size(), mapped_ok ? 1 : 0);
+    std::remove(image_path);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/rule_engine.h"
+
+// Regex rule packs scanned with the combined lazy-DFA pass against one
+// std::sregex_iterator pass per rule.
+
+static std::vector<Rule> build_pack(size_t count) {
+    std::vector<Rule> rules;
+    for (size_t i = 0; i < count; ++i) {
+        Rule rule;
+        rule.id = "pack-" + std::to_string(i);
+        rule.type = "regex";
+        rule.severity = 6;
+        switch (i % 4) {
+            case 0: rule.pattern = "\\bACCT-" + std::to_string(1000 + i) + "-\\d{6}\\b"; break;
+            case 1: rule.pattern = "(?:token|secret)_" + std::to_string(i) + "[=:]\\s*[A-Za-z0-9]{16,}"; break;
+            case 2: rule.pattern = "\\b[A-Z]{2}" + std::to_string(i % 90 + 10) + "[A-Z0-9]{12,28}\\b"; break;
+            default: rule.pattern = "case[- ]?no\\.?\\s*" + std::to_string(i) + "/\\d{2,4}"; break;
+        }
+        rules.push_back(rule);
+    }
+    // One pattern the automaton cannot express stays on the std::regex path.
+    Rule fallback;
+    fallback.id = "pack-lookahead";
+    fallback.type = "regex";
+    fallback.pattern = "password(?=:)";
+    rules.push_back(fallback);
+    return rules;
+}
+
+static std::string build_text(size_t bytes) {
+    static const char *words[] = {
+        "the", "invoice", "was", "sent", "to", "finance", "on", "Monday", "ACCT-1000-123456",
+        "please", "review", "attached", "report", "and", "confirm", "totals", "2024",
+    };
+    std::string text;
+    size_t i = 0;
+    while (text.size() < bytes) {
+        text += words[i % (sizeof(words) / sizeof(words[0]))];
+        text += (i % 13 == 0) ? '\n' : ' ';
+        ++i;
+    }
+    text.resize(bytes);
+    return text;
+}
+
+static size_t scan_per_rule(const std::vector<std::unique_ptr<std::regex>> &res, const std::string &text) {
+    size_t hits = 0;
+    for (const auto &re : res) {
+        auto begin = std::sregex_iterator(text.begin(), text.end(), *re);
+        hits += static_cast<size_t>(std::distance(begin, std::sregex_iterator()));
+    }
+    return hits;
+}
+
+int main() {
+    g_content_keywords.clear();
+    const std::string text = build_text(16 * 1024);
+    for (size_t count : {16, 64, 256}) {
+        auto rules = build_pack(count);
+        std::vector<std::unique_ptr<std::regex>> res;
+        for (const auto &rule : rules) {
+            res.push_back(std::make_unique<std::regex>(rule.pattern, std::regex::ECMAScript));
+        }
+        RuleEngine engine;
+        engine.load_from_rules(rules);
+
+        const size_t iterations = 5;
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) sink += scan_per_rule(res, text);
+        auto per_rule = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) sink += engine.scan_text(text).size();
+        auto combined = std::chrono::steady_clock::now() - start;
+
+        double per_rule_ms = std::chrono::duration<double, std::milli>(per_rule).count() / iterations;
+        double combined_ms = std::chrono::duration<double, std::milli>(combined).count() / iterations;
+        printf("rules=%zu per_rule_passes=%.2fms/16KB single_pass=%.2fms/16KB speedup=%.1fx (sink=%zu)\n",
+               rules.size(), per_rule_ms, combined_ms, per_rule_ms / combined_ms, sink);
+    }
+    return 0;
+}
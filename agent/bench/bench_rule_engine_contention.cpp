@@ -0,0 +1,108 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/enterprise/rules/rule_engine_v2.h"
+
+// N scanning threads plus one concurrent reloader: the mutex-guarded engine
+// RuleEngineV2 used to be against the lock-free snapshot publication.
+
+static std::vector<Rule> build_rules(size_t generation) {
+    std::vector<Rule> rules;
+    for (size_t i = 0; i < 64; ++i) {
+        Rule rule;
+        rule.id = "r-" + std::to_string(i);
+        rule.severity = 5;
+        if (i % 2 == 0) {
+            rule.type = "regex";
+            rule.pattern = "\\bACCT-" + std::to_string(1000 + i + generation % 7) + "-\\d{6}\\b";
+        } else {
+            rule.type = "keyword";
+            rule.keywords = {"codename-" + std::to_string(i), "project-" + std::to_string(i)};
+        }
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+static std::string build_text() {
+    std::string text;
+    while (text.size() < 16 * 1024) {
+        text += "quarterly notes for project-17 with ACCT-1010-123456 and filler words ";
+    }
+    return text;
+}
+
+class LockedEngine {
+public:
+    void LoadRules(const std::vector<Rule> &rules) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        engine_.load_from_rules(rules);
+    }
+    std::vector<RuleMatch> ScanText(const std::string &text) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return engine_.scan_text(text);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    RuleEngine engine_;
+};
+
+template <typename Engine>
+static double run(Engine &engine, int threads, const std::string &text, size_t *reloads) {
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> scans{0};
+    size_t generation = 0;
+    std::thread reloader([&] {
+        while (!stop.load()) {
+            engine.LoadRules(build_rules(++generation));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            size_t local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (engine.ScanText(text).empty()) return;
+                ++local;
+            }
+            scans += local;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    stop = true;
+    for (auto &worker : workers) worker.join();
+    reloader.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    *reloads = generation;
+    return scans.load() / seconds;
+}
+
+int main() {
+    g_content_keywords.clear();
+    const std::string text = build_text();
+    unsigned hw = std::thread::hardware_concurrency();
+    for (int threads : {1, 2, 4, 8}) {
+        if (threads > 1 && static_cast<unsigned>(threads) > hw * 2) break;
+        LockedEngine locked;
+        locked.LoadRules(build_rules(0));
+        dlp::rules::RuleEngineV2 snapshots;
+        snapshots.LoadRules(build_rules(0));
+        size_t locked_reloads = 0;
+        size_t snapshot_reloads = 0;
+        double locked_rate = run(locked, threads, text, &locked_reloads);
+        double snapshot_rate = run(snapshots, threads, text, &snapshot_reloads);
+        std::printf("%d scanners: mutex %.0f scans/s (%zu reloads), snapshot %.0f scans/s (%zu reloads), %.1fx\n",
+                    threads, locked_rate, locked_reloads, snapshot_rate, snapshot_reloads,
+                    snapshot_rate / locked_rate);
+    }
+    return 0;
+}
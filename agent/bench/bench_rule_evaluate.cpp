@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/rule_engine.h"
+
+// 5k rules evaluated against 1k matches: the indexed evaluate() against the
+// rules x matches id/name comparison it replaced.
+
+static size_t legacy_evaluate(const std::vector<Rule> &rules, const RuleContext &context,
+                              const std::vector<RuleMatch> &matches) {
+    size_t best = rules.size();
+    int best_priority = 0;
+    int best_severity = 0;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const Rule &rule = rules[i];
+        bool matched = false;
+        if (rule.type == "regex" || rule.type == "keyword" || rule.type == "hash") {
+            for (const auto &hit : matches) {
+                if ((!rule.id.empty() && hit.rule_id == rule.id) ||
+                    (!rule.name.empty() && hit.rule_name == rule.name)) {
+                    matched = true;
+                    break;
+                }
+            }
+        } else if (!rule.conditions.empty()) {
+            matched = true;
+        }
+        for (const auto &cond : rule.conditions) {
+            if (matched && context.extension != cond.value) matched = false;
+        }
+        if (!matched) continue;
+        int severity = rule.severity;
+        if (severity == 0) {
+            for (const auto &hit : matches) {
+                if ((!rule.id.empty() && hit.rule_id == rule.id) ||
+                    (!rule.name.empty() && hit.rule_name == rule.name)) {
+                    severity = std::max(severity, hit.severity);
+                }
+            }
+        }
+        if (best == rules.size() || rule.priority > best_priority ||
+            (rule.priority == best_priority && severity > best_severity)) {
+            best = i;
+            best_priority = rule.priority;
+            best_severity = severity;
+        }
+    }
+    return best;
+}
+
+int main() {
+    g_content_keywords.clear();
+    std::vector<Rule> rules;
+    std::string text;
+    size_t planted = 0;
+    for (size_t i = 0; i < 5000; ++i) {
+        Rule rule;
+        rule.id = "rule-" + std::to_string(i);
+        rule.name = "Rule " + std::to_string(i);
+        rule.priority = static_cast<int>(i % 7);
+        rule.severity = i % 3 == 0 ? 0 : static_cast<int>(i % 10);
+        if (i % 10 == 9) {
+            rule.conditions = {{"file.extension", "==", ".ext" + std::to_string(i % 50)}};
+        } else {
+            rule.type = "keyword";
+            rule.keywords = {"marker" + std::to_string(i) + "x"};
+            if (i % 4 == 0 && planted < 1000) {
+                text += rule.keywords[0] + " ";
+                ++planted;
+            }
+        }
+        rules.push_back(rule);
+    }
+    RuleEngine engine;
+    engine.load_from_rules(rules);
+    std::vector<RuleMatch> matches = engine.scan_text(text);
+    std::vector<RuleMatch> foreign = matches;
+    for (auto &match : foreign) match.generation = 0;
+
+    RuleContext context;
+    context.extension = ".ext9";
+    const int iters = 200;
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters / 10; ++i) sink += legacy_evaluate(rules, context, matches);
+    double legacy_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / (iters / 10);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) sink += engine.evaluate(context, matches).severity;
+    double indexed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iters;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) sink += engine.evaluate(context, foreign).severity;
+    double by_name_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iters;
+
+    std::printf("rules=%zu matches=%zu legacy=%.1fus indexed=%.1fus (%.0fx) other_generation=%.1fus (%.0fx) (sink=%zu)\n",
+                rules.size(), matches.size(), legacy_us, indexed_us, legacy_us / indexed_us, by_name_us,
+                legacy_us / by_name_us, sink);
+    return 0;
+}
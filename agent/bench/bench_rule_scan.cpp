@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "../src/rule_engine.h"
+
+// Per-file cost of RuleEngine::scan_text with regex rules compiled at load
+// time, against the previous behaviour of constructing every std::regex on
+// each scan.
+
+static std::vector<Rule> build_rules(size_t count) {
+    static const char *patterns[] = {
+        "\\b\\d{3}-\\d{2}-\\d{4}\\b",
+        "\\b[A-Z]{2}\\d{2}[A-Z0-9]{11,30}\\b",
+        "AKIA[0-9A-Z]{16}",
+        "-----BEGIN [A-Z ]*PRIVATE KEY-----",
+        "\\b(?:\\d[ -]?){13,16}\\b",
+        "project[_-]?codename[:=]\\s*\\w+",
+    };
+    std::vector<Rule> rules;
+    for (size_t i = 0; i < count; ++i) {
+        Rule rule;
+        rule.id = "regex-" + std::to_string(i);
+        rule.name = rule.id;
+        rule.type = "regex";
+        rule.severity = 5;
+        rule.pattern = patterns[i % (sizeof(patterns) / sizeof(patterns[0]))];
+        if (i >= sizeof(patterns) / sizeof(patterns[0])) {
+            rule.pattern += "|marker" + std::to_string(i);
+        }
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+static std::string build_text(size_t bytes) {
+    static const char *words[] = {
+        "quarterly", "report", "the", "customer", "meeting", "agenda", "budget",
+        "review", "notes", "draft", "ssn", "123-45-6789", "contact", "office",
+    };
+    std::string text;
+    size_t i = 0;
+    while (text.size() < bytes) {
+        text += words[i % (sizeof(words) / sizeof(words[0]))];
+        text += (i % 17 == 0) ? '\n' : ' ';
+        ++i;
+    }
+    text.resize(bytes);
+    return text;
+}
+
+static size_t scan_per_call_compile(const std::vector<Rule> &rules, const std::string &text) {
+    size_t hits = 0;
+    for (const auto &rule : rules) {
+        std::regex re(rule.pattern, std::regex::ECMAScript);
+        auto begin = std::sregex_iterator(text.begin(), text.end(), re);
+        if (std::distance(begin, std::sregex_iterator()) > 0) ++hits;
+    }
+    return hits;
+}
+
+int main() {
+    const size_t iterations = 10;
+    for (size_t text_bytes : {1024, 16 * 1024}) {
+        const std::string text = build_text(text_bytes);
+        for (size_t rule_count : {8, 32}) {
+            auto rules = build_rules(rule_count);
+            RuleEngine engine;
+            engine.load_from_rules(rules);
+
+            size_t sink = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                sink += scan_per_call_compile(rules, text);
+            }
+            auto before = std::chrono::steady_clock::now() - start;
+
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                sink += engine.scan_text(text).size();
+            }
+            auto after = std::chrono::steady_clock::now() - start;
+
+            double before_us = std::chrono::duration<double, std::micro>(before).count() / iterations;
+            double after_us = std::chrono::duration<double, std::micro>(after).count() / iterations;
+            printf("text=%zuB rules=%zu per_call_compile=%.1fus/file compiled=%.1fus/file speedup=%.2fx (sink=%zu)\n",
+                   text_bytes, rule_count, before_us, after_us, before_us / after_us, sink);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "byte_classes.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define DLP_BYTE_CLASSES_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Kernel = size_t (*)(const char *data, size_t len, ByteMasks &masks);
+
+ByteMasks classify_tail(const char *data, size_t len) {
+    ByteMasks masks;
+    for (size_t i = 0; i < len && i < 32; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        if (static_cast<unsigned>(c - '0') < 10u) masks.digit |= 1u << i;
+        if (c == '@') masks.at |= 1u << i;
+    }
+    return masks;
+}
+
+// Every kernel leaves the short last block to classify_tail.
+size_t finish_tail(const char *data, size_t offset, size_t len, ByteMasks &masks) {
+    if (offset < len) {
+        masks = classify_tail(data + offset, len - offset);
+        if (masks.digit != 0 || masks.at != 0) return offset;
+    }
+    masks = ByteMasks{};
+    return len;
+}
+
+size_t find_scalar(const char *data, size_t len, ByteMasks &masks) {
+    size_t offset = 0;
+    for (; offset + 32 <= len; offset += 32) {
+        masks = classify_tail(data + offset, 32);
+        if (masks.digit != 0 || masks.at != 0) return offset;
+    }
+    return finish_tail(data, offset, len, masks);
+}
+
+#if defined(DLP_BYTE_CLASSES_X86)
+// A byte is a digit when byte - '0', unsigned, is at most 9.
+size_t find_sse2(const char *data, size_t len, ByteMasks &masks) {
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i at = _mm_set1_epi8('@');
+    size_t offset = 0;
+    for (; offset + 32 <= len; offset += 32) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + offset));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + offset + 16));
+        const __m128i lo_offset = _mm_sub_epi8(lo, zero);
+        const __m128i hi_offset = _mm_sub_epi8(hi, zero);
+        const __m128i lo_digit = _mm_cmpeq_epi8(_mm_min_epu8(lo_offset, nine), lo_offset);
+        const __m128i hi_digit = _mm_cmpeq_epi8(_mm_min_epu8(hi_offset, nine), hi_offset);
+        const __m128i lo_at = _mm_cmpeq_epi8(lo, at);
+        const __m128i hi_at = _mm_cmpeq_epi8(hi, at);
+        const __m128i any = _mm_or_si128(_mm_or_si128(lo_digit, hi_digit), _mm_or_si128(lo_at, hi_at));
+        if (_mm_movemask_epi8(any) == 0) continue;
+        masks.digit = static_cast<uint32_t>(_mm_movemask_epi8(lo_digit)) |
+                      static_cast<uint32_t>(_mm_movemask_epi8(hi_digit)) << 16;
+        masks.at = static_cast<uint32_t>(_mm_movemask_epi8(lo_at)) |
+                   static_cast<uint32_t>(_mm_movemask_epi8(hi_at)) << 16;
+        return offset;
+    }
+    return finish_tail(data, offset, len, masks);
+}
+
+// Kept to registers: MinGW does not align the stack for spilled ymm values.
+__attribute__((target("avx2"))) size_t find_avx2(const char *data, size_t len, ByteMasks &masks) {
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i at = _mm256_set1_epi8('@');
+    size_t offset = 0;
+    for (; offset + 32 <= len; offset += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + offset));
+        const __m256i digit_offset = _mm256_sub_epi8(v, zero);
+        const __m256i digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit_offset, nine), digit_offset);
+        const __m256i is_at = _mm256_cmpeq_epi8(v, at);
+        if (_mm256_testz_si256(_mm256_or_si256(digit, is_at), _mm256_or_si256(digit, is_at))) continue;
+        masks.digit = static_cast<uint32_t>(_mm256_movemask_epi8(digit));
+        masks.at = static_cast<uint32_t>(_mm256_movemask_epi8(is_at));
+        return offset;
+    }
+    return finish_tail(data, offset, len, masks);
+}
+#endif
+
+struct Dispatch {
+    ByteKernel kernel;
+    Kernel find;
+};
+
+Kernel kernel_function(ByteKernel kernel) {
+    switch (kernel) {
+#if defined(DLP_BYTE_CLASSES_X86)
+        case ByteKernel::Avx2: return find_avx2;
+        case ByteKernel::Sse2: return find_sse2;
+#endif
+        default: return find_scalar;
+    }
+}
+
+Dispatch &dispatch() {
+    static Dispatch current = [] {
+        ByteKernel kernel = ByteKernel::Scalar;
+        if (byte_kernel_supported(ByteKernel::Avx2)) {
+            kernel = ByteKernel::Avx2;
+        } else if (byte_kernel_supported(ByteKernel::Sse2)) {
+            kernel = ByteKernel::Sse2;
+        }
+        return Dispatch{kernel, kernel_function(kernel)};
+    }();
+    return current;
+}
+
+}  // namespace
+
+size_t find_anchor_block(const char *data, size_t len, ByteMasks &masks) {
+    return dispatch().find(data, len, masks);
+}
+
+ByteKernel byte_kernel() { return dispatch().kernel; }
+
+bool byte_kernel_supported(ByteKernel kernel) {
+    switch (kernel) {
+        case ByteKernel::Scalar: return true;
+#if defined(DLP_BYTE_CLASSES_X86)
+        case ByteKernel::Sse2: return true;
+        case ByteKernel::Avx2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+bool set_byte_kernel(ByteKernel kernel) {
+    if (!byte_kernel_supported(kernel)) return false;
+    dispatch() = Dispatch{kernel, kernel_function(kernel)};
+    return true;
+}
+
+const char *byte_kernel_name(ByteKernel kernel) {
+    switch (kernel) {
+        case ByteKernel::Avx2: return "avx2";
+        case ByteKernel::Sse2: return "sse2";
+        default: return "scalar";
+    }
+}
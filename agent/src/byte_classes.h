@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Classifies text 32 bytes at a time so scanners can jump between the few
+// bytes that can anchor a match instead of testing every offset. Bit i of
+// each mask describes byte i of the block.
+struct ByteMasks {
+    uint32_t digit = 0;  // [0-9]
+    uint32_t at = 0;     // '@'
+};
+
+// Returns the offset of the first 32-byte block from `data` that holds a
+// digit or '@', with its masks, or `len` when there is none. The last block
+// may be short; its bits past `len` are clear.
+size_t find_anchor_block(const char *data, size_t len, ByteMasks &masks);
+
+// The kernel is picked from the CPU at startup. Tests and benchmarks may
+// switch it while no other thread is classifying.
+enum class ByteKernel { Scalar, Sse2, Avx2 };
+ByteKernel byte_kernel();
+bool byte_kernel_supported(ByteKernel kernel);
+bool set_byte_kernel(ByteKernel kernel);
+const char *byte_kernel_name(ByteKernel kernel);
@@ -1,4 +1,5 @@
 #include "config.h"
+#include "json_reader.h"
 #include <algorithm>
 #include <cctype>
 #include <cstdio>
@@ -11,7 +12,16 @@ size_t g_size_threshold = 10 * 1024 * 1024;
 std::vector<std::string> g_usb_allow_serials;
 std::vector<std::string> g_content_keywords = {"confidential", "secret"};
 size_t g_max_scan_bytes = 64 * 1024;
+size_t g_scan_chunk_bytes = 64 * 1024;
+size_t g_scan_overlap_bytes = 4096;
 size_t g_hash_max_bytes = 1024 * 1024;
+size_t g_watch_queue_capacity = 4096;
+size_t g_coalesce_window_ms = 500;
+size_t g_scan_cache_entries = 4096;
+size_t g_driver_pending_messages = 16;
+size_t g_driver_verdict_deadline_ms = 50;
+size_t g_rule_match_limit = 100;
+size_t g_pii_max_hits_per_type = 256;
 bool g_block_on_match = false;
 bool g_alert_on_removable = true;
 std::string g_rules_path = "rules/default_policy.json";
@@ -98,65 +108,26 @@ static void normalize_extension_filter(std::vector<std::string> &exts) {
     exts.swap(out);
 }
 
-static std::string extract_string(const std::string &s, const std::string &key) {
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return "";
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return "";
-    auto first = s.find('"', colon+1);
-    if (first == std::string::npos) return "";
-    auto second = s.find('"', first+1);
-    if (second == std::string::npos) return "";
-    return s.substr(first+1, second-first-1);
+static std::string extract_string(const JsonValue &root, const char *key) {
+    JsonValue value = root.get(key);
+    return value.is_string() ? value.as_string() : std::string();
 }
 
-static std::vector<std::string> extract_array(const std::string &s, const std::string &key) {
+static std::vector<std::string> extract_array(const JsonValue &root, const char *key) {
     std::vector<std::string> out;
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return out;
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return out;
-    auto lb = s.find('[', colon);
-    auto rb = s.find(']', lb);
-    if (lb==std::string::npos || rb==std::string::npos) return out;
-    std::string body = s.substr(lb+1, rb-lb-1);
-    std::istringstream iss(body);
-    std::string token;
-    while (std::getline(iss, token, ',')) {
-        auto first = token.find('"');
-        if (first==std::string::npos) continue;
-        auto second = token.find('"', first+1);
-        if (second==std::string::npos) continue;
-        out.push_back(token.substr(first+1, second-first-1));
+    for (const auto &item : root.get(key).elements()) {
+        if (item.is_string()) out.push_back(item.as_string());
     }
     return out;
 }
 
-static bool extract_bool(const std::string &s, const std::string &key, bool default_value) {
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return default_value;
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return default_value;
-    size_t i = colon + 1;
-    while (i < s.size() && isspace((unsigned char)s[i])) ++i;
-    if (s.compare(i, 4, "true") == 0) return true;
-    if (s.compare(i, 5, "false") == 0) return false;
-    return default_value;
+static bool extract_bool(const JsonValue &root, const char *key, bool default_value) {
+    return root.get(key).as_bool(default_value);
 }
 
-static size_t extract_number(const std::string &s, const std::string &key, size_t default_value) {
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return default_value;
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return default_value;
-    size_t i = colon + 1;
-    while (i < s.size() && isspace((unsigned char)s[i])) ++i;
-    size_t j = i;
-    while (j < s.size() && (isdigit((unsigned char)s[j]))) ++j;
-    if (j > i) {
-        return std::stoull(s.substr(i, j - i));
-    }
-    return default_value;
+static size_t extract_number(const JsonValue &root, const char *key, size_t default_value) {
+    long long value = root.get(key).as_int(-1);
+    return value >= 0 ? static_cast<size_t>(value) : default_value;
 }
 
 bool load_config(const char *path) {
@@ -164,7 +135,15 @@ bool load_config(const char *path) {
     if (!ifs) return false;
     std::ostringstream oss;
     oss << ifs.rdbuf();
-    std::string s = oss.str();
+    std::string body = oss.str();
+    JsonDocument doc;
+    std::string error;
+    if (!doc.parse(body, &error)) {
+        // A malformed file does not keep the agent from starting.
+        fprintf(stderr, "config error: %s: %s; using default settings\n", path, error.c_str());
+        return true;
+    }
+    JsonValue s = doc.root();
 
     auto exts = extract_array(s, "extension_filter");
     if (!exts.empty()) g_extension_filter = exts;
@@ -216,7 +195,16 @@ bool load_config(const char *path) {
     // size_threshold (number)
     g_size_threshold = extract_number(s, "size_threshold", g_size_threshold);
     g_max_scan_bytes = extract_number(s, "max_scan_bytes", g_max_scan_bytes);
+    g_scan_chunk_bytes = extract_number(s, "scan_chunk_bytes", g_scan_chunk_bytes);
+    g_scan_overlap_bytes = extract_number(s, "scan_overlap_bytes", g_scan_overlap_bytes);
     g_hash_max_bytes = extract_number(s, "hash_max_bytes", g_hash_max_bytes);
+    g_watch_queue_capacity = extract_number(s, "watch_queue_capacity", g_watch_queue_capacity);
+    g_coalesce_window_ms = extract_number(s, "coalesce_window_ms", g_coalesce_window_ms);
+    g_scan_cache_entries = extract_number(s, "scan_cache_entries", g_scan_cache_entries);
+    g_driver_pending_messages = extract_number(s, "driver_pending_messages", g_driver_pending_messages);
+    g_driver_verdict_deadline_ms = extract_number(s, "driver_verdict_deadline_ms", g_driver_verdict_deadline_ms);
+    g_rule_match_limit = extract_number(s, "rule_match_limit", g_rule_match_limit);
+    g_pii_max_hits_per_type = extract_number(s, "pii_max_hits_per_type", g_pii_max_hits_per_type);
     g_block_on_match = extract_bool(s, "block_on_match", g_block_on_match);
     g_alert_on_removable = extract_bool(s, "alert_on_removable", g_alert_on_removable);
     g_block_severity_threshold = static_cast<int>(extract_number(s, "block_severity_threshold", g_block_severity_threshold));
@@ -238,10 +226,34 @@ bool load_config(const char *path) {
         g_max_scan_bytes = 64 * 1024;
         fprintf(stderr, "config warning: max_scan_bytes invalid, using default\n");
     }
+    if (g_scan_chunk_bytes == 0) {
+        g_scan_chunk_bytes = 64 * 1024;
+        fprintf(stderr, "config warning: scan_chunk_bytes invalid, using default\n");
+    }
+    if (g_scan_overlap_bytes == 0) {
+        g_scan_overlap_bytes = 4096;
+        fprintf(stderr, "config warning: scan_overlap_bytes invalid, using default\n");
+    }
     if (g_hash_max_bytes == 0) {
         g_hash_max_bytes = 1024 * 1024;
         fprintf(stderr, "config warning: hash_max_bytes invalid, using default\n");
     }
+    if (g_watch_queue_capacity == 0) {
+        g_watch_queue_capacity = 4096;
+        fprintf(stderr, "config warning: watch_queue_capacity invalid, using default\n");
+    }
+    if (g_driver_pending_messages == 0) {
+        g_driver_pending_messages = 16;
+        fprintf(stderr, "config warning: driver_pending_messages invalid, using default\n");
+    }
+    if (g_rule_match_limit < 4) {
+        g_rule_match_limit = 4;
+        fprintf(stderr, "config warning: rule_match_limit below 4, using 4\n");
+    }
+    if (g_pii_max_hits_per_type == 0) {
+        g_pii_max_hits_per_type = 256;
+        fprintf(stderr, "config warning: pii_max_hits_per_type invalid, using default\n");
+    }
     if (g_rules_path.empty()) {
         g_rules_path = "rules/default_policy.json";
         fprintf(stderr, "config warning: rules_config empty, using default\n");
@@ -9,7 +9,31 @@ extern size_t g_size_threshold;
 extern std::vector<std::string> g_usb_allow_serials;
 extern std::vector<std::string> g_content_keywords;
 extern size_t g_max_scan_bytes;
+// Files are scanned whole, g_scan_chunk_bytes at a time; matches up to
+// g_scan_overlap_bytes long are found across chunk boundaries.
+extern size_t g_scan_chunk_bytes;
+extern size_t g_scan_overlap_bytes;
 extern size_t g_hash_max_bytes;
+// File notifications waiting for the evaluation workers; more are dropped.
+extern size_t g_watch_queue_capacity;
+// Quiet time a path needs before its burst of notifications is evaluated;
+// 0 evaluates every notification.
+extern size_t g_coalesce_window_ms;
+// Scan outcomes kept for unchanged files and copies; 0 disables the cache.
+extern size_t g_scan_cache_entries;
+// FilterGetMessage requests kept pending on the minifilter port; raised to
+// the driver worker count when lower.
+extern size_t g_driver_pending_messages;
+// How long a driver create waits for the full content verdict before it is
+// answered from metadata and cached results; the scan then finishes in the
+// background. 0 always answers with the fast verdict.
+extern size_t g_driver_verdict_deadline_ms;
+// Matches of one regex rule counted per scan; the rule's search stops there.
+// Counts past 3 no longer change its confidence, so lower values are raised
+// to 4.
+extern size_t g_rule_match_limit;
+// PII detections kept per type and file; that type's search stops there.
+extern size_t g_pii_max_hits_per_type;
 extern bool g_block_on_match;
 extern bool g_alert_on_removable;
 extern std::string g_rules_path;
@@ -42,4 +66,6 @@ extern bool g_enable_quarantine;
 
 extern std::atomic<bool> g_running;
 
+// Fails only when `path` cannot be read. A file that is not valid JSON is
+// reported on stderr and leaves every setting at its default.
 bool load_config(const char *path);
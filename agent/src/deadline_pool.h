@@ -0,0 +1,127 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "work_queue.h"
+
+// Worker pool for jobs whose caller waits only so long. run() queues a job
+// and waits up to a deadline for its result; a job that misses the deadline
+// keeps running and hands its result to `late` on the pool thread instead.
+// submit() and wait() split the two, so the caller can do other work while
+// the job runs.
+template <typename Result>
+class DeadlinePool {
+    struct Task;
+
+public:
+    enum class Outcome {
+        Completed,  // finished in time; `out` holds the result
+        Detached,   // still running; `late` gets the result
+        Rejected    // queue full, or the pool stopped first; the job never runs
+    };
+
+    DeadlinePool(size_t workers, size_t capacity) : jobs_(capacity) {
+        for (size_t i = 0; i < std::max<size_t>(1, workers); ++i) {
+            threads_.emplace_back([this] { work(); });
+        }
+    }
+    ~DeadlinePool() { stop(); }
+
+    // A queued job; empty when the job was rejected.
+    class Ticket {
+    public:
+        explicit operator bool() const { return task_ != nullptr; }
+
+    private:
+        friend class DeadlinePool;
+        std::shared_ptr<Task> task_;
+    };
+
+    Ticket submit(std::function<Result()> job, std::function<void(Result)> late) {
+        auto task = std::make_shared<Task>();
+        task->job = std::move(job);
+        task->late = std::move(late);
+        Ticket ticket;
+        if (jobs_.push(task)) ticket.task_ = std::move(task);
+        return ticket;
+    }
+
+    // Waits for a submitted job until `deadline`. Anything the caller wrote
+    // before a Detached outcome is visible to `late`.
+    Outcome wait(Ticket &ticket, std::chrono::steady_clock::time_point deadline, Result &out) {
+        if (!ticket) return Outcome::Rejected;
+        std::shared_ptr<Task> task = std::move(ticket.task_);
+        std::unique_lock<std::mutex> lock(task->mutex);
+        if (!task->done_cv.wait_until(lock, deadline, [&] { return task->done || task->discarded; })) {
+            task->detached = true;
+            return Outcome::Detached;
+        }
+        if (task->discarded) return Outcome::Rejected;
+        out = std::move(task->result);
+        return Outcome::Completed;
+    }
+
+    Outcome run(std::function<Result()> job, std::chrono::milliseconds deadline, Result &out,
+                std::function<void(Result)> late) {
+        const auto until = std::chrono::steady_clock::now() + deadline;
+        Ticket ticket = submit(std::move(job), std::move(late));
+        return wait(ticket, until, out);
+    }
+
+    // Jobs still queued are dropped: they never run, their waiters get
+    // Rejected and `late` is not called. Running jobs finish first and still
+    // deliver late results.
+    void stop() {
+        for (auto &task : jobs_.close_and_take()) {
+            {
+                std::lock_guard<std::mutex> lock(task->mutex);
+                task->discarded = true;
+            }
+            task->done_cv.notify_one();
+        }
+        for (auto &t : threads_) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+private:
+    struct Task {
+        std::function<Result()> job;
+        std::function<void(Result)> late;
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        bool done = false;
+        bool detached = false;
+        bool discarded = false;
+        Result result;
+    };
+
+    void work() {
+        std::shared_ptr<Task> task;
+        while (jobs_.pop(task)) {
+            Result result = task->job();
+            std::unique_lock<std::mutex> lock(task->mutex);
+            if (task->detached) {
+                lock.unlock();
+                if (task->late) task->late(std::move(result));
+            } else {
+                task->result = std::move(result);
+                task->done = true;
+                lock.unlock();
+                task->done_cv.notify_one();
+            }
+            task.reset();
+        }
+    }
+
+    BoundedQueue<std::shared_ptr<Task>> jobs_;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,20 @@
+#include "driver_port.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+static void serve_worker(DriverMessageSource &source, const DriverEvaluator &evaluate) {
+    DriverQuery query;
+    while (source.receive(query)) {
+        source.reply(query.message_id, evaluate(query));
+    }
+}
+
+void serve_driver_queries(DriverMessageSource &source, size_t workers, const DriverEvaluator &evaluate) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::max<size_t>(1, workers); ++i) {
+        threads.emplace_back(serve_worker, std::ref(source), std::cref(evaluate));
+    }
+    for (auto &t : threads) t.join();
+}
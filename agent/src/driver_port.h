@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Verdict layout shared with the minifilter (see drivers/dlp_minifilter.h).
+enum class DlpPolicyAction : uint32_t {
+    Allow = 0,
+    Block = 1,
+    Alert = 2,
+    Quarantine = 3
+};
+
+struct DlpPolicyDecision {
+    DlpPolicyAction action;
+    uint32_t rule_id;
+    uint32_t severity;
+};
+
+// One file create held by the minifilter until it gets a verdict.
+struct DriverQuery {
+    uint64_t message_id = 0;
+    uint32_t process_id = 0;
+    std::string path;
+};
+
+// Where driver queries come from: the minifilter communication port in the
+// agent, a simulated port in tests and benchmarks. receive() and reply() are
+// called concurrently from every worker.
+class DriverMessageSource {
+public:
+    virtual ~DriverMessageSource() = default;
+    // Blocks for the next query; false once the source is shutting down.
+    virtual bool receive(DriverQuery &query) = 0;
+    // Releases the create that sent `message_id`.
+    virtual void reply(uint64_t message_id, const DlpPolicyDecision &decision) = 0;
+};
+
+using DriverEvaluator = std::function<DlpPolicyDecision(const DriverQuery &)>;
+
+// Runs `workers` threads that each take the next query, evaluate it and reply
+// to its message id, so one slow scan never holds up other creates. Returns
+// once every worker has seen receive() fail.
+void serve_driver_queries(DriverMessageSource &source, size_t workers, const DriverEvaluator &evaluate);
@@ -1,6 +1,7 @@
 #include "policy_fetcher.h"
 
 #include "hash.h"
+#include "json_reader.h"
 
 #include <curl/curl.h>
 #include <fstream>
@@ -16,16 +17,13 @@ static size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
     return size * nmemb;
 }
 
-static std::string extract_string_field(const std::string& s, const std::string& key) {
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return "";
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return "";
-    auto first = s.find('"', colon + 1);
-    if (first == std::string::npos) return "";
-    auto second = s.find('"', first + 1);
-    if (second == std::string::npos) return "";
-    return s.substr(first + 1, second - first - 1);
+// Reads the payload's version and signature: the first members with those
+// names anywhere in the document, as scalars.
+static void read_payload_metadata(PolicyPayload& payload) {
+    JsonDocument doc;
+    if (!doc.parse(payload.json)) return;
+    payload.version = doc.root().find_first("version").as_string();
+    payload.signature = doc.root().find_first("signature").as_string();
 }
 
 std::optional<PolicyPayload> PolicyFetcher::Fetch() {
@@ -40,11 +38,10 @@ std::optional<PolicyPayload> PolicyFetcher::Fetch() {
         std::ostringstream oss;
         oss << input.rdbuf();
         payload.json = oss.str();
-        payload.version = extract_string_field(payload.json, "version");
+        read_payload_metadata(payload);
         if (payload.version.empty()) {
             payload.version = "file";
         }
-        payload.signature = extract_string_field(payload.json, "signature");
         return payload;
     }
     CURL* curl = curl_easy_init();
@@ -72,8 +69,7 @@ std::optional<PolicyPayload> PolicyFetcher::Fetch() {
         return std::nullopt;
     }
     payload.json = response;
-    payload.signature = extract_string_field(payload.json, "signature");
-    payload.version = extract_string_field(payload.json, "version");
+    read_payload_metadata(payload);
     if (payload.version.empty()) {
         payload.version = std::to_string(code);
     }
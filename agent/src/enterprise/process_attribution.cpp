@@ -3,6 +3,9 @@
 #include <windows.h>
 #include <sddl.h>
 #include <tlhelp32.h>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace dlp::process {
@@ -16,23 +19,6 @@ static std::string wide_to_utf8(const wchar_t *w) {
     return out;
 }
 
-static uint32_t lookup_parent_pid(uint32_t pid) {
-    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (snapshot == INVALID_HANDLE_VALUE) return 0;
-    PROCESSENTRY32 entry = {};
-    entry.dwSize = sizeof(entry);
-    if (Process32First(snapshot, &entry)) {
-        do {
-            if (entry.th32ProcessID == pid) {
-                CloseHandle(snapshot);
-                return entry.th32ParentProcessID;
-            }
-        } while (Process32Next(snapshot, &entry));
-    }
-    CloseHandle(snapshot);
-    return 0;
-}
-
 static std::string lookup_process_path(HANDLE process) {
     wchar_t buffer[MAX_PATH];
     DWORD size = MAX_PATH;
@@ -69,14 +55,124 @@ static std::string lookup_user_sid(HANDLE process) {
     return result;
 }
 
-ProcessAttribution GetProcessAttribution(uint32_t pid) {
-    ProcessAttribution result;
-    result.pid = pid;
-    result.ppid = lookup_parent_pid(pid);
+static uint64_t filetime_ticks(const FILETIME &ft) {
+    return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+// Attribution of every process seen, keyed by pid and checked against the
+// process creation time so a reused pid is never served another process's
+// data. Parent pids come from one shared Toolhelp snapshot that is retaken
+// only when it predates the process asked about; the snapshot is taken
+// without holding the lock, so lookups never wait on it. Shared by the
+// watcher and the driver thread.
+class ProcessCache {
+public:
+    ProcessAttribution Get(uint32_t pid);
+
+private:
+    struct Entry {
+        uint64_t created = 0;
+        ProcessAttribution info;
+    };
+    struct ParentTable {
+        std::unordered_map<uint32_t, uint32_t> parents;
+        uint64_t taken = 0;
+    };
+
+    uint32_t ParentOf(uint32_t pid, uint64_t created);
+    static bool TakeParents(ParentTable &table);
+    void Install(ParentTable &table);
+
+    // Entries of exited processes are dropped whenever a snapshot is
+    // installed; past this many live ones, new processes are not cached.
+    static constexpr size_t kMaxEntries = 4096;
+    // One second in FILETIME units (100 ns).
+    static constexpr uint64_t kMissingPidRetakeTicks = 10000000;
+
+    std::mutex mutex_;
+    std::unordered_map<uint32_t, Entry> entries_;
+    ParentTable parents_;
+};
+
+bool ProcessCache::TakeParents(ParentTable &table) {
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return false;
+    PROCESSENTRY32 entry = {};
+    entry.dwSize = sizeof(entry);
+    if (Process32First(snapshot, &entry)) {
+        do {
+            table.parents[entry.th32ProcessID] = entry.th32ParentProcessID;
+        } while (Process32Next(snapshot, &entry));
+    }
+    CloseHandle(snapshot);
+    table.taken = filetime_ticks(now);
+    return true;
+}
+
+// Caller holds mutex_. A snapshot older than the installed one (another
+// thread's finished first) is discarded. Cached processes missing from the
+// snapshot have exited; those started after it are kept.
+void ProcessCache::Install(ParentTable &table) {
+    if (table.taken <= parents_.taken) return;
+    std::swap(parents_, table);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.created < parents_.taken && parents_.parents.count(it->first) == 0) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// `created` is 0 when the process could not be opened. A process started
+// after the snapshot forces a new one; a pid that is simply missing (already
+// exited) retakes it at most once a second.
+uint32_t ProcessCache::ParentOf(uint32_t pid, uint64_t created) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = parents_.parents.find(pid);
+        bool stale = created > parents_.taken;
+        if (!stale && found == parents_.parents.end()) {
+            FILETIME now;
+            GetSystemTimeAsFileTime(&now);
+            stale = filetime_ticks(now) - parents_.taken > kMissingPidRetakeTicks;
+        }
+        if (!stale) return found != parents_.parents.end() ? found->second : 0;
+    }
+    ParentTable fresh;
+    bool taken = TakeParents(fresh);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (taken) Install(fresh);
+    auto found = parents_.parents.find(pid);
+    return found != parents_.parents.end() ? found->second : 0;
+}
+
+ProcessAttribution ProcessCache::Get(uint32_t pid) {
     HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
     if (!process) {
+        ProcessAttribution result;
+        result.pid = pid;
+        result.ppid = ParentOf(pid, 0);
         return result;
     }
+    FILETIME created_ft, exited_ft, kernel_ft, user_ft;
+    uint64_t created = 0;
+    if (GetProcessTimes(process, &created_ft, &exited_ft, &kernel_ft, &user_ft)) {
+        created = filetime_ticks(created_ft);
+    }
+    if (created != 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(pid);
+        if (found != entries_.end() && found->second.created == created) {
+            CloseHandle(process);
+            return found->second.info;
+        }
+    }
+
+    ProcessAttribution result;
+    result.pid = pid;
     std::string full_path = lookup_process_path(process);
     if (!full_path.empty()) {
         result.command_line = full_path;
@@ -89,7 +185,19 @@ ProcessAttribution GetProcessAttribution(uint32_t pid) {
     }
     result.token.user_sid = lookup_user_sid(process);
     CloseHandle(process);
+
+    result.ppid = ParentOf(pid, created);
+    if (created != 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(pid);
+        if (found != entries_.end() || entries_.size() < kMaxEntries) entries_[pid] = Entry{created, result};
+    }
     return result;
 }
 
+ProcessAttribution GetProcessAttribution(uint32_t pid) {
+    static ProcessCache cache;
+    return cache.Get(pid);
+}
+
 }  // namespace dlp::process
@@ -19,6 +19,8 @@ struct ProcessAttribution {
     TokenInfo token;
 };
 
+// Served from a cache keyed by pid and process creation time; only the first
+// lookup of a process opens its token and walks the process list.
 ProcessAttribution GetProcessAttribution(uint32_t pid);
 
 }  // namespace dlp::process
@@ -1,43 +1,105 @@
 #include "rule_engine_v2.h"
+#include "policy_image.h"
+
+#include <atomic>
 
 namespace dlp::rules {
 
 RuleEngineV2 g_rule_engine_v2;
 
-bool RuleEngineV2::LoadFromFile(const std::string& path) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return engine_.load_from_file(path);
+namespace {
+
+std::atomic<uint64_t> g_next_generation{1};
+
+// The snapshot this thread last read, and which engine and generation it
+// came from.
+struct ReaderSnapshot {
+    const RuleEngineV2* owner = nullptr;
+    uint64_t generation = 0;
+    RuleEngineV2::Snapshot snapshot;
+};
+
+}  // namespace
+
+RuleEngineV2::RuleEngineV2()
+    : snapshot_(std::make_shared<const RuleEngine>()), generation_(g_next_generation.fetch_add(1)) {}
+
+// The snapshot is stored before the generation, so a reader that sees the
+// new generation loads this snapshot or a later one.
+void RuleEngineV2::Publish(Snapshot snapshot) {
+    std::atomic_store(&snapshot_, std::move(snapshot));
+    generation_.store(g_next_generation.fetch_add(1), std::memory_order_release);
+}
+
+RuleEngineV2::Snapshot RuleEngineV2::Current() const {
+    thread_local ReaderSnapshot reader;
+    const uint64_t generation = generation_.load(std::memory_order_acquire);
+    if (reader.owner != this || reader.generation != generation) {
+        reader.snapshot = std::atomic_load(&snapshot_);
+        reader.owner = this;
+        reader.generation = generation;
+    }
+    return reader.snapshot;
+}
+
+bool RuleEngineV2::LoadFromFile(const std::string& path, const std::vector<Rule>& defaults,
+                                const Snapshot& previous) {
+    auto engine = std::make_shared<RuleEngine>();
+    bool ok = engine->load_from_file(path, defaults, previous.get());
+    Publish(std::move(engine));
+    return ok;
 }
 
-bool RuleEngineV2::LoadFromString(const std::string& body) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return engine_.load_from_string(body);
+bool RuleEngineV2::LoadFromString(const std::string& body, const std::vector<Rule>& defaults,
+                                  const Snapshot& previous) {
+    auto engine = std::make_shared<RuleEngine>();
+    bool ok = engine->load_from_string(body, defaults, previous.get());
+    Publish(std::move(engine));
+    return ok;
 }
 
 void RuleEngineV2::LoadRules(const std::vector<Rule>& rules) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    engine_.load_from_rules(rules);
+    auto engine = std::make_shared<RuleEngine>();
+    engine->load_from_rules(rules);
+    Publish(std::move(engine));
+}
+
+bool RuleEngineV2::LoadFromImage(const std::string& path, uint64_t source_key, std::string* error) {
+    auto engine = std::make_shared<RuleEngine>();
+    if (!PolicyImage::load(*engine, path, source_key, error)) {
+        return false;
+    }
+    Publish(std::move(engine));
+    return true;
+}
+
+bool RuleEngineV2::SaveImage(const std::string& path, uint64_t source_key, std::string* error) const {
+    return PolicyImage::save(*Current(), path, source_key, error);
 }
 
 RuleDecision RuleEngineV2::Evaluate(const RuleContext& context, const std::vector<RuleMatch>& matches) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return engine_.evaluate(context, matches);
+    return Current()->evaluate(context, matches);
 }
 
-std::vector<RuleMatch> RuleEngineV2::ScanText(const std::string& text) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return engine_.scan_text(text);
+std::vector<RuleMatch> RuleEngineV2::ScanText(const std::string& text, std::string* content_keyword) const {
+    return Current()->scan_text(text, content_keyword);
 }
 
 std::vector<RuleMatch> RuleEngineV2::ScanHashes(const std::string& full_hash,
                                                 const std::string& partial_hash) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return engine_.scan_hashes(full_hash, partial_hash);
+    return Current()->scan_hashes(full_hash, partial_hash);
 }
 
 std::vector<Rule> RuleEngineV2::SnapshotRules() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return engine_.rules();
+    return Current()->rules();
+}
+
+std::vector<std::string> RuleEngineV2::LoadErrors() const {
+    return Current()->load_errors();
+}
+
+ReloadStats RuleEngineV2::LastReloadStats() const {
+    return Current()->reload_stats();
 }
 
 }  // namespace dlp::rules
@@ -2,7 +2,9 @@
 
 #include "rule_engine.h"
 
-#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,19 +16,45 @@ using Rule = ::Rule;
 using RuleDecision = ::RuleDecision;
 using RuleContext = ::RuleContext;
 
+// Publishes immutable compiled RuleEngine snapshots RCU-style: loaders build
+// a complete engine off to the side and swap it in atomically, readers grab
+// the current snapshot without taking any lock and keep it alive for as long
+// as they use it. Each thread keeps the snapshot it last read and checks it
+// against an atomic generation; only after a publish does it load the shared
+// pointer again, the one step that takes libstdc++'s internal lock. A thread
+// holds its last snapshot until its next read.
 class RuleEngineV2 {
 public:
-    bool LoadFromFile(const std::string& path);
-    bool LoadFromString(const std::string& body);
+    using Snapshot = std::shared_ptr<const RuleEngine>;
+
+    RuleEngineV2();
+
+    // With `previous`, unchanged rules and indexes are taken over from it
+    // instead of being compiled again; see RuleEngine::load_from_string.
+    bool LoadFromFile(const std::string& path, const std::vector<Rule>& defaults = {},
+                      const Snapshot& previous = nullptr);
+    bool LoadFromString(const std::string& body, const std::vector<Rule>& defaults = {},
+                        const Snapshot& previous = nullptr);
     void LoadRules(const std::vector<Rule>& rules);
+    // Publishes the policy image at `path`. Unlike the loaders above, nothing
+    // is published when the image is unusable; see PolicyImage::load.
+    bool LoadFromImage(const std::string& path, uint64_t source_key, std::string* error = nullptr);
+    // Writes the current snapshot as a policy image.
+    bool SaveImage(const std::string& path, uint64_t source_key, std::string* error = nullptr) const;
+    // Swaps in a snapshot built elsewhere, e.g. by a staging engine.
+    void Publish(Snapshot snapshot);
     RuleDecision Evaluate(const RuleContext& context, const std::vector<RuleMatch>& matches) const;
-    std::vector<RuleMatch> ScanText(const std::string& text) const;
+    std::vector<RuleMatch> ScanText(const std::string& text, std::string* content_keyword = nullptr) const;
     std::vector<RuleMatch> ScanHashes(const std::string& full_hash, const std::string& partial_hash) const;
     std::vector<Rule> SnapshotRules() const;
+    std::vector<std::string> LoadErrors() const;
+    ReloadStats LastReloadStats() const;
+    Snapshot Current() const;
 
 private:
-    mutable std::mutex mutex_;
-    RuleEngine engine_;
+    Snapshot snapshot_;
+    // Changes on every publish; unique across all engines.
+    std::atomic<uint64_t> generation_;
 };
 
 extern RuleEngineV2 g_rule_engine_v2;
@@ -30,6 +30,7 @@ void emit_file_event(const FileEvent &ev) {
     oss << "{"
         << "\"type\":\"" << json_escape(ev.event_type) << "\","
         << "\"action\":\"" << json_escape(ev.action) << "\","
+        << "\"actions\":\"" << json_escape(ev.actions) << "\","
         << "\"path\":\"" << json_escape(ev.path) << "\","
         << "\"user\":\"" << json_escape(ev.user) << "\","
         << "\"user_sid\":\"" << json_escape(ev.user_sid) << "\","
@@ -6,6 +6,8 @@
 struct FileEvent {
     std::string event_type;
     std::string action;
+    // Comma-separated actions coalesced into this event, in order.
+    std::string actions;
     std::string path;
     std::string user;
     std::string user_sid;
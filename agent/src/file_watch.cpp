@@ -1,6 +1,8 @@
 #include "file_watch.h"
 #include "log.h"
 #include "config.h"
+#include "deadline_pool.h"
+#include "driver_port.h"
 #include "sqlite_store.h"
 #include "filter.h"
 #include "event_bus.h"
@@ -11,16 +13,25 @@
 #include "enterprise/process_attribution.h"
 #include "enterprise/extraction/content_extractor.h"
 #include "enterprise/rules/rule_engine_v2.h"
+#include "path_coalescer.h"
+#include "scan_cache.h"
+#include "text_normalizer.h"
+#include "work_queue.h"
 
 #include <windows.h>
 #include <fltuser.h>
+#include <atomic>
 #include <string>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <sstream>
 #include <algorithm>
 #include <cwchar>
+#include <functional>
+#include <memory>
 
 static std::string wc_to_utf8(const wchar_t *w, int len) {
     if (!w) return std::string();
@@ -97,19 +108,6 @@ struct DlpPolicyQuery {
     wchar_t file_path[512];
 };
 
-enum class DlpPolicyAction : uint32_t {
-    Allow = 0,
-    Block = 1,
-    Alert = 2,
-    Quarantine = 3
-};
-
-struct DlpPolicyDecision {
-    DlpPolicyAction action;
-    uint32_t rule_id;
-    uint32_t severity;
-};
-
 struct DlpMessage {
     FILTER_MESSAGE_HEADER header;
     DlpPolicyQuery query;
@@ -159,69 +157,88 @@ static bool move_to_quarantine(const std::string &path, const std::string &quara
     return false;
 }
 
-static bool read_file_bytes(const std::string &path, size_t max_bytes, std::vector<unsigned char> &out, size_t &size_out) {
-    HANDLE hFile = CreateFileA(
+// What one read pass over a file produced besides the scanned content.
+struct FileRead {
+    size_t size = 0;
+    uint64_t bytes_read = 0;
+    // Empty when the file exceeds g_hash_max_bytes or changed size while read.
+    std::string sha256;
+    // SHA-256 of the first g_max_scan_bytes; empty for an empty file.
+    std::string partial_hash;
+};
+
+static HANDLE open_for_scan(const std::string &path) {
+    return CreateFileA(
         path.c_str(),
         GENERIC_READ,
         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
         NULL,
         OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
         NULL);
-    if (hFile == INVALID_HANDLE_VALUE) return false;
-    LARGE_INTEGER file_size;
-    if (!GetFileSizeEx(hFile, &file_size)) {
-        CloseHandle(hFile);
-        return false;
-    }
-    size_out = static_cast<size_t>(file_size.QuadPart);
-    size_t to_read = size_out < max_bytes ? size_out : max_bytes;
-    out.resize(to_read);
-    DWORD read = 0;
-    BOOL ok = ReadFile(hFile, out.data(), static_cast<DWORD>(to_read), &read, NULL);
-    CloseHandle(hFile);
-    if (!ok) return false;
-    out.resize(read);
+}
+
+static bool file_identity(HANDLE hFile, FileIdentity &out) {
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(hFile, &info)) return false;
+    out.volume = info.dwVolumeSerialNumber;
+    out.file_id = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    out.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    out.mtime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                info.ftLastWriteTime.dwLowDateTime;
     return true;
 }
 
-static std::string hash_file_if_small(const std::string &path, size_t max_bytes) {
-    HANDLE hFile = CreateFileA(
-        path.c_str(),
-        GENERIC_READ,
-        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-        NULL,
-        OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL,
-        NULL);
-    if (hFile == INVALID_HANDLE_VALUE) return std::string();
+// Reads an open file from its current position to the end, in blocks of up
+// to g_scan_chunk_bytes, and hands every block to the full hash, the partial
+// hash and, if given, `sink` for the content scanners. Sequential-scan reads
+// let the cache manager read ahead; the file is not mapped since it may be
+// truncated while we read it.
+static bool read_file_once(HANDLE hFile, FileRead &out,
+                           const std::function<void(const char *, size_t)> &sink) {
     LARGE_INTEGER file_size;
-    if (!GetFileSizeEx(hFile, &file_size)) {
-        CloseHandle(hFile);
-        return std::string();
-    }
-    size_t size = static_cast<size_t>(file_size.QuadPart);
-    if (size > max_bytes) {
-        CloseHandle(hFile);
-        return std::string();
-    }
-    std::vector<unsigned char> buf(size);
-    DWORD read = 0;
-    BOOL ok = ReadFile(hFile, buf.data(), static_cast<DWORD>(size), &read, NULL);
-    CloseHandle(hFile);
-    if (!ok || read != size) return std::string();
-    return sha256_hex(buf.data(), buf.size());
-}
-
-static std::string keyword_hit_text(const std::string &text) {
-    if (g_content_keywords.empty()) return {};
-    auto lower = to_lower_str_fw(text);
-    for (const auto &kw : g_content_keywords) {
-        if (!kw.empty() && lower.find(kw) != std::string::npos) {
-            return kw;
+    if (!GetFileSizeEx(hFile, &file_size)) return false;
+    out.size = static_cast<size_t>(file_size.QuadPart);
+    const bool hash_full = out.size <= g_hash_max_bytes;
+    Sha256 full;
+    Sha256 partial;
+    // Files smaller than a block get a buffer of their own size; one that
+    // grows meanwhile is still read to the end, just without a full hash.
+    size_t block_bytes = std::min<size_t>(g_scan_chunk_bytes, 1u << 30);
+    std::vector<char> block(std::max<size_t>(1, std::min(block_bytes, out.size)));
+    while (true) {
+        DWORD read = 0;
+        if (!ReadFile(hFile, block.data(), static_cast<DWORD>(block.size()), &read, NULL)) return false;
+        if (read == 0) break;
+        if (hash_full) full.update(block.data(), read);
+        if (out.bytes_read < g_max_scan_bytes) {
+            partial.update(block.data(), std::min<uint64_t>(read, g_max_scan_bytes - out.bytes_read));
         }
+        if (sink) sink(block.data(), read);
+        out.bytes_read += read;
     }
-    return {};
+    if (out.bytes_read > 0) out.partial_hash = partial.finish_hex();
+    if (hash_full && out.bytes_read == out.size) out.sha256 = full.finish_hex();
+    return true;
+}
+
+// User plus kernel CPU time of the calling thread: what a cached scan saves,
+// without the time it spent waiting for the disk or other threads.
+static ScanCache::Cost thread_cpu_time() {
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) return ScanCache::Cost(0);
+    auto ticks = [](const FILETIME &time) {
+        return static_cast<uint64_t>(time.dwHighDateTime) << 32 | time.dwLowDateTime;
+    };
+    // FILETIME counts 100 ns intervals.
+    return ScanCache::Cost((ticks(kernel) + ticks(user)) / 10);
+}
+
+// Scan outcomes of unchanged files (same identity, or a copy with the same
+// content) are reused instead of reading and scanning them again.
+static ScanCache &scan_cache() {
+    static ScanCache cache(g_scan_cache_entries);
+    return cache;
 }
 
 static std::string summarize_rule_hits(const std::vector<RuleMatch> &hits) {
@@ -261,6 +278,12 @@ static std::string summarize_pii_hits(const std::vector<PiiDetection> &hits) {
     return oss.str();
 }
 
+// Detections that failed their format or checksum check are still listed
+// in the event summary, but do not make the file count as containing PII.
+static bool contains_valid_pii(const std::vector<PiiDetection> &hits) {
+    return std::any_of(hits.begin(), hits.end(), [](const PiiDetection &hit) { return hit.valid; });
+}
+
 static std::string summarize_fingerprint_match(bool matched, const std::string &existing_path) {
     if (!matched) return std::string();
     if (!existing_path.empty()) {
@@ -302,6 +325,12 @@ static uint32_t rule_id_hash(const std::string &rule_id) {
     return hash;
 }
 
+// National-ID patterns are compiled once, from the loaded configuration.
+static const PiiPatterns &pii_patterns() {
+    static const PiiPatterns patterns(g_national_id_patterns);
+    return patterns;
+}
+
 struct PipelineResult {
     PolicyDecision policy_decision;
     RuleDecision rule_decision;
@@ -314,6 +343,15 @@ struct PipelineResult {
     std::string fingerprint_path;
 };
 
+static void apply_rules(const RuleEngine &engine,
+                        const std::string &path,
+                        const std::string &extension,
+                        const std::string &user,
+                        const std::string &drive_type,
+                        const std::string &process_name,
+                        bool removable,
+                        PipelineResult &result);
+
 static PipelineResult evaluate_pipeline(const std::string &path,
                                         const std::string &extension,
                                         const std::string &user,
@@ -323,30 +361,94 @@ static PipelineResult evaluate_pipeline(const std::string &path,
                                         std::string &sha256_out,
                                         size_t &size_out) {
     PipelineResult result;
-    std::vector<unsigned char> data;
-    size_out = 0;
-    if (read_file_bytes(path, g_max_scan_bytes, data, size_out)) {
-        result.size_exceeded = (size_out >= g_size_threshold);
-        sha256_out = hash_file_if_small(path, g_hash_max_bytes);
-    }
-
-    std::string text(reinterpret_cast<const char*>(data.data()), data.size());
-    if (text.empty()) {
-        auto extractor = dlp::extract::CreateExtractorForExtension(extension);
-        if (extractor) {
-            text = extractor->ExtractText(path);
+    // One snapshot for scan and evaluate keeps match rule indices valid even
+    // if a reload lands in between.
+    auto engine = dlp::rules::g_rule_engine_v2.Current();
+
+    const uint64_t generation = engine->generation();
+    ScanOutcome scan;
+    FileRead file;
+    bool read_ok = false;
+    HANDLE hFile = open_for_scan(path);
+    FileIdentity identity;
+    const bool cacheable = hFile != INVALID_HANDLE_VALUE && file_identity(hFile, identity);
+    bool cached = cacheable && scan_cache().find(generation, identity, scan);
+    std::string copy_sha;
+    if (!cached && cacheable && identity.size <= g_hash_max_bytes &&
+        scan_cache().copy_candidate(generation, identity, copy_sha)) {
+        // Probably a copy of a file already scanned: hashing it costs far
+        // less than scanning it.
+        FileRead hashed;
+        if (read_file_once(hFile, hashed, nullptr) && hashed.sha256 == copy_sha) {
+            cached = scan_cache().find_content(generation, copy_sha, identity, scan);
+        }
+        LARGE_INTEGER start = {};
+        if (!cached && !SetFilePointerEx(hFile, start, NULL, FILE_BEGIN)) {
+            CloseHandle(hFile);
+            hFile = open_for_scan(path);
+        }
+    }
+
+    if (cached) {
+        read_ok = true;
+        file.size = static_cast<size_t>(identity.size);
+        file.bytes_read = identity.size;
+    } else {
+        // The whole file is scanned and hashed chunk by chunk in a single read.
+        const ScanCache::Cost scan_start = thread_cpu_time();
+        RuleEngine::TextStream rule_stream(*engine, g_scan_overlap_bytes);
+        PiiStream pii_stream(pii_patterns(), g_scan_overlap_bytes, g_pii_max_hits_per_type);
+        // UTF-16 content is scanned as UTF-8; detections are mapped back to
+        // file offsets as they are found, and the map keeps only what the
+        // PII window can still report.
+        TextNormalizer normalizer;
+        pii_stream.map_offsets([&normalizer](uint64_t offset) { return normalizer.source_offset(offset); });
+        auto feed_scanners = [&](std::string_view text) {
+            rule_stream.feed(text.data(), text.size());
+            pii_stream.feed(text.data(), text.size());
+            normalizer.release_before(pii_stream.pending_offset());
+        };
+        uint64_t scanned = 0;
+        auto sink = [&](const char *chunk, size_t len) {
+            feed_scanners(normalizer.feed(chunk, len));
+            scanned += len;
+        };
+        if (hFile != INVALID_HANDLE_VALUE) read_ok = read_file_once(hFile, file, sink);
+        if (scanned == 0) {
+            auto extractor = dlp::extract::CreateExtractorForExtension(extension);
+            if (extractor) {
+                std::string text = extractor->ExtractText(path);
+                sink(text.data(), text.size());
+            }
+        }
+        feed_scanners(normalizer.finish());
+
+        std::string keyword;
+        scan.rule_hits = rule_stream.finish(&keyword);
+        scan.keyword_found = !keyword.empty();
+        if (read_ok) {
+            scan.sha256 = file.sha256;
+            scan.partial_hash = file.partial_hash;
+        }
+        auto hash_hits = engine->scan_hashes(scan.sha256, scan.partial_hash);
+        scan.rule_hits.insert(scan.rule_hits.end(), hash_hits.begin(), hash_hits.end());
+        scan.pii_hits = pii_stream.finish();
+        // Only a complete read of the version identified above is reusable.
+        if (cacheable && read_ok && file.bytes_read == identity.size) {
+            scan_cache().insert(generation, identity, scan, thread_cpu_time() - scan_start);
         }
     }
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
 
-    std::string keyword = keyword_hit_text(text);
-    result.keyword_found = !keyword.empty();
-    result.partial_hash = partial_sha256(data, g_max_scan_bytes);
-    result.rule_hits = dlp::rules::g_rule_engine_v2.ScanText(text);
-    auto hash_hits = dlp::rules::g_rule_engine_v2.ScanHashes(sha256_out, result.partial_hash);
-    result.rule_hits.insert(result.rule_hits.end(), hash_hits.begin(), hash_hits.end());
-    result.pii_hits = detect_pii(text, g_national_id_patterns);
+    if (read_ok) result.size_exceeded = (file.size >= g_size_threshold);
+    size_out = file.size;
+    sha256_out = scan.sha256;
+    result.partial_hash = scan.partial_hash;
+    result.rule_hits = std::move(scan.rule_hits);
+    result.pii_hits = std::move(scan.pii_hits);
+    result.keyword_found = scan.keyword_found;
 
-    if (!data.empty()) {
+    if (file.bytes_read > 0) {
         result.fingerprint_matched = sqlite_find_fingerprint(sha256_out, result.partial_hash, size_out, result.fingerprint_path);
         FileFingerprint fp;
         fp.path = path;
@@ -356,6 +458,20 @@ static PipelineResult evaluate_pipeline(const std::string &path,
         sqlite_insert_fingerprint(fp);
     }
 
+    apply_rules(*engine, path, extension, user, drive_type, process_name, removable, result);
+    return result;
+}
+
+// Runs the policy over what is known about the file; content fields of
+// `result` not filled in yet count as no match.
+static void apply_rules(const RuleEngine &engine,
+                        const std::string &path,
+                        const std::string &extension,
+                        const std::string &user,
+                        const std::string &drive_type,
+                        const std::string &process_name,
+                        bool removable,
+                        PipelineResult &result) {
     RuleContext rule_context;
     rule_context.path = path;
     rule_context.extension = extension;
@@ -363,123 +479,241 @@ static PipelineResult evaluate_pipeline(const std::string &path,
     rule_context.drive_type = drive_type;
     rule_context.process_name = process_name;
     rule_context.destination = drive_type;
-    rule_context.contains_pii = !result.pii_hits.empty();
+    rule_context.contains_pii = contains_valid_pii(result.pii_hits);
     rule_context.keyword_hit = result.keyword_found;
     rule_context.size_exceeded = result.size_exceeded;
     rule_context.removable_drive = removable;
     rule_context.fingerprint_matched = result.fingerprint_matched;
 
-    result.rule_decision = dlp::rules::g_rule_engine_v2.Evaluate(rule_context, result.rule_hits);
+    result.rule_decision = engine.evaluate(rule_context, result.rule_hits);
     result.policy_decision = resolve_rule_decision(result.rule_decision, removable, g_alert_on_removable);
+}
+
+// The cheap tier of a driver verdict: path, process and drive metadata plus
+// the content results cached for this exact file version, if any. Never
+// reads the file or touches SQLite.
+static PipelineResult fast_pipeline(const std::string &path,
+                                    const std::string &extension,
+                                    const std::string &user,
+                                    const std::string &drive_type,
+                                    const std::string &process_name,
+                                    bool removable) {
+    PipelineResult result;
+    auto engine = dlp::rules::g_rule_engine_v2.Current();
+    HANDLE hFile = open_for_scan(path);
+    if (hFile != INVALID_HANDLE_VALUE) {
+        FileIdentity identity;
+        ScanOutcome scan;
+        // The full pipeline's lookup is the one counted.
+        if (file_identity(hFile, identity) && scan_cache().peek(engine->generation(), identity, scan)) {
+            result.size_exceeded = identity.size >= g_size_threshold;
+            result.partial_hash = scan.partial_hash;
+            result.rule_hits = std::move(scan.rule_hits);
+            result.pii_hits = std::move(scan.pii_hits);
+            result.keyword_found = scan.keyword_found;
+        }
+        CloseHandle(hFile);
+    }
+    apply_rules(*engine, path, extension, user, drive_type, process_name, removable, result);
     return result;
 }
 
-static void process_notifications(BYTE *buf, DWORD bytes, const std::string &basepath) {
+// A file notification waiting for evaluation.
+struct WatchItem {
+    std::string path;
+    // Last action of the coalesced burst; `actions` holds the whole sequence.
+    DWORD action = 0;
+    std::vector<uint32_t> actions;
+};
+
+// Watchers only parse notifications and queue them; a pool of workers does
+// the scanning, fingerprinting and enforcement, so a slow file never keeps
+// ReadDirectoryChangesW from being reissued.
+static BoundedQueue<WatchItem> &watch_queue() {
+    static BoundedQueue<WatchItem> queue(g_watch_queue_capacity);
+    return queue;
+}
+static std::atomic<uint64_t> g_watch_queued{0};
+static std::atomic<uint64_t> g_watch_dropped{0};
+static std::atomic<uint64_t> g_watch_overflows{0};
+// Driver creates answered with the full pipeline verdict, with the fast
+// metadata verdict because the full one missed the deadline (or the deep
+// scan pool was saturated), and fast verdicts the full one later overruled.
+static std::atomic<uint64_t> g_driver_full_verdicts{0};
+static std::atomic<uint64_t> g_driver_fast_verdicts{0};
+static std::atomic<uint64_t> g_driver_followups{0};
+
+// Between the watchers and that queue, notifications wait until their path
+// has been quiet for g_coalesce_window_ms, so a burst from one save is
+// evaluated once, against the final file state. A path that keeps changing
+// is still evaluated at least every kCoalesceMaxDelayFactor windows.
+static constexpr size_t kCoalesceMaxDelayFactor = 10;
+static std::mutex g_coalesce_mutex;
+static std::condition_variable g_coalesce_wake;
+
+static PathCoalescer &coalescer() {
+    static PathCoalescer instance(std::chrono::milliseconds(g_coalesce_window_ms),
+                                  std::chrono::milliseconds(g_coalesce_window_ms * kCoalesceMaxDelayFactor));
+    return instance;
+}
+
+FileWatchStats file_watch_stats() {
+    FileWatchStats stats;
+    stats.queued = g_watch_queued.load();
+    stats.dropped = g_watch_dropped.load();
+    stats.overflows = g_watch_overflows.load();
+    stats.queue_depth = watch_queue().size();
+    stats.driver_full_verdicts = g_driver_full_verdicts.load();
+    stats.driver_fast_verdicts = g_driver_fast_verdicts.load();
+    stats.driver_followups = g_driver_followups.load();
+    ScanCache::Stats cache = scan_cache().stats();
+    stats.cache_lookups = cache.lookups;
+    stats.cache_hits = cache.identity_hits + cache.content_hits;
+    stats.cache_saved_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(cache.saved).count());
+    std::lock_guard<std::mutex> lock(g_coalesce_mutex);
+    stats.coalesced = coalescer().merged();
+    stats.pending_paths = coalescer().pending();
+    return stats;
+}
+
+static const char *action_name(DWORD action) {
+    switch (action) {
+        case FILE_ACTION_ADDED: return "ADDED";
+        case FILE_ACTION_REMOVED: return "REMOVED";
+        case FILE_ACTION_MODIFIED: return "MODIFIED";
+        case FILE_ACTION_RENAMED_OLD_NAME: return "RENAMED_FROM";
+        case FILE_ACTION_RENAMED_NEW_NAME: return "RENAMED_TO";
+    }
+    return "UNKNOWN";
+}
+
+static void enqueue_item(WatchItem item) {
+    if (watch_queue().push(std::move(item))) {
+        ++g_watch_queued;
+    } else {
+        ++g_watch_dropped;
+    }
+}
+
+static void enqueue_burst(PathCoalescer::Burst &burst) {
+    WatchItem item;
+    item.path = std::move(burst.path);
+    item.action = burst.actions.back();
+    item.actions = std::move(burst.actions);
+    enqueue_item(std::move(item));
+}
+
+static void handle_file_event(const WatchItem &item) {
+    FileEvent ev;
+    ev.event_type = "file";
+    ev.action = action_name(item.action);
+    for (size_t i = 0; i < item.actions.size(); ++i) {
+        if (i > 0) ev.actions += ",";
+        ev.actions += action_name(item.actions[i]);
+    }
+    ev.path = item.path;
+    ev.user = get_username();
+    ev.drive_type = drive_type_for_path(item.path);
+    ev.size_bytes = 0;
+    auto proc_info = dlp::process::GetProcessAttribution(GetCurrentProcessId());
+    ev.process_name = proc_info.process_name;
+    ev.pid = proc_info.pid;
+    ev.ppid = proc_info.ppid;
+    ev.command_line = proc_info.command_line;
+    ev.user_sid = proc_info.token.user_sid;
+
+    bool is_removable = (ev.drive_type == "REMOVABLE");
+    std::string extension = file_extension(item.path);
+    PipelineResult result;
+    if (item.action != FILE_ACTION_REMOVED && item.action != FILE_ACTION_RENAMED_OLD_NAME) {
+        if (path_is_directory(item.path)) return;
+        result = evaluate_pipeline(item.path,
+                                   extension,
+                                   ev.user,
+                                   ev.drive_type,
+                                   ev.process_name,
+                                   is_removable,
+                                   ev.sha256,
+                                   ev.size_bytes);
+    } else {
+        result.policy_decision = resolve_rule_decision({}, is_removable, g_alert_on_removable);
+    }
+
+    ev.rule_id = result.rule_decision.rule_id;
+    ev.rule_name = result.rule_decision.rule_name;
+    ev.severity = result.rule_decision.severity;
+    ev.content_flags = build_content_flags(contains_valid_pii(result.pii_hits),
+                                           result.keyword_found,
+                                           result.size_exceeded,
+                                           result.fingerprint_matched);
+    ev.device_context = build_device_context(ev.drive_type, is_removable);
+    ev.decision = result.policy_decision.decision;
+    std::vector<std::string> extra_reasons;
+    extra_reasons.push_back(result.policy_decision.reason);
+    auto rules_summary = summarize_rule_hits(result.rule_hits);
+    if (!rules_summary.empty()) extra_reasons.push_back(rules_summary);
+    auto pii_summary = summarize_pii_hits(result.pii_hits);
+    if (!pii_summary.empty()) extra_reasons.push_back(pii_summary);
+    auto fp_summary = summarize_fingerprint_match(result.fingerprint_matched, result.fingerprint_path);
+    if (!fp_summary.empty()) extra_reasons.push_back(fp_summary);
+    std::ostringstream reason_stream;
+    for (size_t i = 0; i < extra_reasons.size(); ++i) {
+        if (i > 0) reason_stream << " | ";
+        reason_stream << extra_reasons[i];
+    }
+    ev.reason = reason_stream.str();
+
+    if (item.action == FILE_ACTION_ADDED || item.action == FILE_ACTION_MODIFIED ||
+        item.action == FILE_ACTION_RENAMED_NEW_NAME) {
+        std::string enforcement_detail;
+        if (result.policy_decision.action == RuleAction::ShadowCopy && g_enable_shadow_copy) {
+            std::string shadow_path;
+            if (copy_to_shadow(item.path, g_shadow_copy_dir, shadow_path)) {
+                enforcement_detail = "shadow_copy=" + shadow_path;
+            }
+        } else if (result.policy_decision.action == RuleAction::Quarantine && g_enable_quarantine) {
+            std::string quarantine_path;
+            if (move_to_quarantine(item.path, g_quarantine_dir, quarantine_path)) {
+                enforcement_detail = "quarantine=" + quarantine_path;
+            }
+        } else if (result.policy_decision.action == RuleAction::Block) {
+            if (DeleteFileA(item.path.c_str()) == TRUE) {
+                enforcement_detail = "blocked_deleted";
+            } else {
+                enforcement_detail = "block_failed";
+            }
+        }
+        if (!enforcement_detail.empty()) {
+            if (!ev.reason.empty()) ev.reason += " | ";
+            ev.reason += enforcement_detail;
+        }
+    }
+    emit_file_event(ev);
+}
+
+static void process_notifications(BYTE *buf, const std::string &basepath) {
     FILE_NOTIFY_INFORMATION *fni = (FILE_NOTIFY_INFORMATION*)buf;
     while (true) {
         int nameLen = fni->FileNameLength / sizeof(wchar_t);
         std::string name = wc_to_utf8(fni->FileName, nameLen);
-        std::string fullpath;
-        if (!basepath.empty()) {
-            fullpath = basepath + "\\" + name;
-        } else fullpath = name;
-
-        // ignore temporary Office lockfiles starting with ~$ and .tmp
-        if (should_ignore_name(name)) goto next_item;
-        // extension filter
-        if (extension_allowed(name)) {
-            const char *action = "UNKNOWN";
-            switch (fni->Action) {
-                case FILE_ACTION_ADDED: action = "ADDED"; break;
-                case FILE_ACTION_REMOVED: action = "REMOVED"; break;
-                case FILE_ACTION_MODIFIED: action = "MODIFIED"; break;
-                case FILE_ACTION_RENAMED_OLD_NAME: action = "RENAMED_FROM"; break;
-                case FILE_ACTION_RENAMED_NEW_NAME: action = "RENAMED_TO"; break;
-            }
-
-            FileEvent ev;
-            ev.event_type = "file";
-            ev.action = action;
-            ev.path = fullpath;
-            ev.user = get_username();
-            ev.drive_type = drive_type_for_path(fullpath);
-            ev.size_bytes = 0;
-            auto proc_info = dlp::process::GetProcessAttribution(GetCurrentProcessId());
-            ev.process_name = proc_info.process_name;
-            ev.pid = proc_info.pid;
-            ev.ppid = proc_info.ppid;
-            ev.command_line = proc_info.command_line;
-            ev.user_sid = proc_info.token.user_sid;
-
-            bool is_removable = (ev.drive_type == "REMOVABLE");
-            std::string extension = file_extension(fullpath);
-            PipelineResult result;
-            if (fni->Action != FILE_ACTION_REMOVED && fni->Action != FILE_ACTION_RENAMED_OLD_NAME) {
-                if (path_is_directory(fullpath)) goto next_item;
-                result = evaluate_pipeline(fullpath,
-                                           extension,
-                                           ev.user,
-                                           ev.drive_type,
-                                           ev.process_name,
-                                           is_removable,
-                                           ev.sha256,
-                                           ev.size_bytes);
+        // ignore temporary Office lockfiles starting with ~$ and .tmp, then
+        // apply the extension filter
+        if (!should_ignore_name(name) && extension_allowed(name)) {
+            std::string path = basepath.empty() ? name : basepath + "\\" + name;
+            if (g_coalesce_window_ms == 0) {
+                WatchItem item;
+                item.path = std::move(path);
+                item.action = fni->Action;
+                item.actions.push_back(fni->Action);
+                enqueue_item(std::move(item));
             } else {
-                result.policy_decision = resolve_rule_decision({}, is_removable, g_alert_on_removable);
+                std::lock_guard<std::mutex> lock(g_coalesce_mutex);
+                // The flusher only needs waking when it had nothing to wait for.
+                bool was_idle = coalescer().pending() == 0;
+                coalescer().add(path, fni->Action, PathCoalescer::Clock::now());
+                if (was_idle) g_coalesce_wake.notify_one();
             }
-
-            ev.rule_id = result.rule_decision.rule_id;
-            ev.rule_name = result.rule_decision.rule_name;
-            ev.severity = result.rule_decision.severity;
-            ev.content_flags = build_content_flags(!result.pii_hits.empty(),
-                                                   result.keyword_found,
-                                                   result.size_exceeded,
-                                                   result.fingerprint_matched);
-            ev.device_context = build_device_context(ev.drive_type, is_removable);
-            ev.decision = result.policy_decision.decision;
-            std::vector<std::string> extra_reasons;
-            extra_reasons.push_back(result.policy_decision.reason);
-            auto rules_summary = summarize_rule_hits(result.rule_hits);
-            if (!rules_summary.empty()) extra_reasons.push_back(rules_summary);
-            auto pii_summary = summarize_pii_hits(result.pii_hits);
-            if (!pii_summary.empty()) extra_reasons.push_back(pii_summary);
-            auto fp_summary = summarize_fingerprint_match(result.fingerprint_matched, result.fingerprint_path);
-            if (!fp_summary.empty()) extra_reasons.push_back(fp_summary);
-            std::ostringstream reason_stream;
-            for (size_t i = 0; i < extra_reasons.size(); ++i) {
-                if (i > 0) reason_stream << " | ";
-                reason_stream << extra_reasons[i];
-            }
-            ev.reason = reason_stream.str();
-
-            if (fni->Action == FILE_ACTION_ADDED || fni->Action == FILE_ACTION_MODIFIED ||
-                fni->Action == FILE_ACTION_RENAMED_NEW_NAME) {
-                std::string enforcement_detail;
-                if (result.policy_decision.action == RuleAction::ShadowCopy && g_enable_shadow_copy) {
-                    std::string shadow_path;
-                    if (copy_to_shadow(fullpath, g_shadow_copy_dir, shadow_path)) {
-                        enforcement_detail = "shadow_copy=" + shadow_path;
-                    }
-                } else if (result.policy_decision.action == RuleAction::Quarantine && g_enable_quarantine) {
-                    std::string quarantine_path;
-                    if (move_to_quarantine(fullpath, g_quarantine_dir, quarantine_path)) {
-                        enforcement_detail = "quarantine=" + quarantine_path;
-                    }
-                } else if (result.policy_decision.action == RuleAction::Block) {
-                    if (DeleteFileA(fullpath.c_str()) == TRUE) {
-                        enforcement_detail = "blocked_deleted";
-                    } else {
-                        enforcement_detail = "block_failed";
-                    }
-                }
-                if (!enforcement_detail.empty()) {
-                    if (!ev.reason.empty()) ev.reason += " | ";
-                    ev.reason += enforcement_detail;
-                }
-            }
-            emit_file_event(ev);
         }
-next_item:
         if (fni->NextEntryOffset == 0) break;
         fni = (FILE_NOTIFY_INFORMATION*)(((BYTE*)fni) + fni->NextEntryOffset);
     }
@@ -500,21 +734,68 @@ static void watch_path_thread(const std::string &path) {
     }
     const DWORD bufSize = 64*1024;
     std::vector<BYTE> buf(bufSize);
-    DWORD bytes = 0;
     while (g_running) {
+        DWORD bytes = 0;
         BOOL ok = ReadDirectoryChangesW(hDir, buf.data(), bufSize, TRUE,
             FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
             &bytes, NULL, NULL);
-        if (ok && bytes > 0) {
-            process_notifications(buf.data(), bytes, path);
+        DWORD error = ok ? ERROR_SUCCESS : GetLastError();
+        if (!ok && error != ERROR_NOTIFY_ENUM_DIR) {
+            log_error("ReadDirectoryChangesW failed on %s (%lu)", path.c_str(), error);
+            // Back off rather than spin on a handle that keeps failing.
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        } else if (error == ERROR_NOTIFY_ENUM_DIR || bytes == 0) {
+            // The notification buffer overflowed and the changes since the
+            // last call were discarded.
+            ++g_watch_overflows;
+            log_error("Change notifications lost on %s: buffer overflow", path.c_str());
+        } else {
+            process_notifications(buf.data(), path);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
     CloseHandle(hDir);
 }
 
+// Hands bursts to the evaluation workers as they fall due; whatever is
+// pending at shutdown is flushed.
+static void coalesce_thread() {
+    std::vector<PathCoalescer::Burst> due;
+    std::unique_lock<std::mutex> lock(g_coalesce_mutex);
+    while (g_running) {
+        auto wake = std::min(coalescer().next_due(), PathCoalescer::Clock::now() + std::chrono::seconds(1));
+        g_coalesce_wake.wait_until(lock, wake);
+        coalescer().take_due(PathCoalescer::Clock::now(), due);
+        if (due.empty()) continue;
+        lock.unlock();
+        for (auto &burst : due) enqueue_burst(burst);
+        due.clear();
+        lock.lock();
+    }
+    coalescer().take_due(PathCoalescer::Clock::time_point::max(), due);
+    lock.unlock();
+    for (auto &burst : due) enqueue_burst(burst);
+}
+
+static void watch_worker_thread() {
+    WatchItem item;
+    while (watch_queue().pop(item)) {
+        handle_file_event(item);
+    }
+}
+
 void file_watch_thread() {
     log_info("File watch thread started");
+    BoundedQueue<WatchItem> &queue = watch_queue();
+    unsigned worker_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> evaluators;
+    for (unsigned i = 0; i < worker_count; ++i) {
+        evaluators.emplace_back(watch_worker_thread);
+    }
+    log_info("File evaluation pool: %u workers, queue capacity %llu, coalesce window %llu ms", worker_count,
+             static_cast<unsigned long long>(queue.capacity()), static_cast<unsigned long long>(g_coalesce_window_ms));
+    std::thread flusher;
+    if (g_coalesce_window_ms > 0) flusher = std::thread(coalesce_thread);
+
     std::vector<std::thread> workers;
     // always watch local user folder
     workers.emplace_back(watch_path_thread, std::string("C:\\Users"));
@@ -535,93 +816,262 @@ void file_watch_thread() {
     }
 
     for (auto &t : workers) if (t.joinable()) t.join();
+    if (flusher.joinable()) flusher.join();
+    queue.close();
+    for (auto &t : evaluators) t.join();
 }
 
-void driver_policy_thread() {
-    log_info("Driver policy thread started");
-    HANDLE port = nullptr;
-    HRESULT hr = FilterConnectCommunicationPort(L"\\DlpMinifilterPort", 0, nullptr, 0, nullptr, &port);
-    if (FAILED(hr)) {
-        log_info("Minifilter port not available, driver policy thread exiting");
-        return;
+// Deep scans waiting for a worker; when full, creates get the fast verdict
+// without content analysis.
+static constexpr size_t kDeepScanQueueCapacity = 256;
+
+// A driver create and its pipeline evaluation.
+struct DriverEvaluation {
+    FileEvent event;
+    PipelineResult result;
+    bool removable = false;
+};
+
+static DlpPolicyDecision to_driver_decision(const PipelineResult &result) {
+    DlpPolicyDecision decision = {};
+    decision.rule_id = rule_id_hash(result.rule_decision.rule_id);
+    decision.severity = static_cast<uint32_t>(result.rule_decision.severity);
+    if (should_block_driver(result.policy_decision)) {
+        decision.action = DlpPolicyAction::Block;
+    } else if (result.policy_decision.action == RuleAction::Alert) {
+        decision.action = DlpPolicyAction::Alert;
+    } else {
+        decision.action = DlpPolicyAction::Allow;
     }
-    while (g_running) {
-        DlpMessage msg = {};
-        OVERLAPPED ov = {};
-        ov.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-        if (!ov.hEvent) {
-            break;
+    return decision;
+}
+
+static void emit_driver_event(DriverEvaluation &eval, const std::string &detail) {
+    FileEvent &ev = eval.event;
+    const PipelineResult &result = eval.result;
+    ev.rule_id = result.rule_decision.rule_id;
+    ev.rule_name = result.rule_decision.rule_name;
+    ev.severity = result.rule_decision.severity;
+    ev.content_flags = build_content_flags(contains_valid_pii(result.pii_hits),
+                                           result.keyword_found,
+                                           result.size_exceeded,
+                                           result.fingerprint_matched);
+    ev.device_context = build_device_context(ev.drive_type, eval.removable);
+    ev.decision = result.policy_decision.decision;
+    ev.reason = result.policy_decision.reason;
+    if (!detail.empty()) ev.reason += " | " + detail;
+    emit_file_event(ev);
+}
+
+// The full verdict of a create that was let through on its fast verdict.
+// The create cannot be refused any more, so a block becomes a quarantine of
+// the file and anything short of that an alert.
+static void follow_up_driver_verdict(DriverEvaluation &eval, const PolicyDecision &fast) {
+    std::string detail = "verdict_tier=fast:" + fast.decision;
+    const PolicyDecision &full = eval.result.policy_decision;
+    if (should_block_driver(full) && !should_block_driver(fast)) {
+        ++g_driver_followups;
+        std::string quarantine_path;
+        // Files are not moved once shutdown has begun.
+        if (!g_enable_quarantine || !g_running) {
+            detail += " | followup=alert";
+        } else if (move_to_quarantine(eval.event.path, g_quarantine_dir, quarantine_path)) {
+            detail += " | followup=quarantine=" + quarantine_path;
+        } else {
+            detail += " | followup=quarantine_failed";
         }
-        hr = FilterGetMessage(port, &msg.header, sizeof(msg), &ov);
-        if (hr == HRESULT_FROM_WIN32(ERROR_IO_PENDING)) {
-            DWORD wait = WaitForSingleObject(ov.hEvent, 2000);
-            if (wait == WAIT_TIMEOUT) {
-                CloseHandle(ov.hEvent);
-                continue;
-            }
+    } else if (full.action == RuleAction::Alert && fast.action == RuleAction::Allow) {
+        ++g_driver_followups;
+        detail += " | followup=alert";
+    }
+    emit_driver_event(eval, detail);
+}
+
+static DlpPolicyDecision evaluate_driver_query(const DriverQuery &query, DeadlinePool<DriverEvaluation> &deep) {
+    DriverEvaluation base;
+    FileEvent &ev = base.event;
+    const std::string &path = query.path;
+    std::string extension = file_extension(path);
+    auto proc_info = dlp::process::GetProcessAttribution(query.process_id);
+    ev.event_type = "file";
+    ev.action = "DRIVER_CREATE";
+    ev.path = path;
+    ev.user = get_username();
+    ev.user_sid = proc_info.token.user_sid;
+    ev.drive_type = drive_type_for_path(path);
+    ev.process_name = proc_info.process_name;
+    ev.pid = proc_info.pid;
+    ev.ppid = proc_info.ppid;
+    ev.command_line = proc_info.command_line;
+    base.removable = (ev.drive_type == "REMOVABLE");
+
+    if (path.empty()) {
+        base.result.policy_decision = resolve_rule_decision({}, base.removable, g_alert_on_removable);
+        ++g_driver_full_verdicts;
+        emit_driver_event(base, std::string());
+        return to_driver_decision(base.result);
+    }
+
+    // The full pipeline runs on the deep scan pool while the fast verdict is
+    // computed here; the create waits for the full one only until the
+    // deadline and otherwise goes ahead on the fast verdict.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_driver_verdict_deadline_ms);
+    auto full_scan = [base, extension]() mutable {
+        FileEvent &ev = base.event;
+        base.result = evaluate_pipeline(ev.path, extension, ev.user, ev.drive_type, ev.process_name,
+                                        base.removable, ev.sha256, ev.size_bytes);
+        return base;
+    };
+    // Written before the wait below, so a late result always finds it.
+    auto fast_decision = std::make_shared<PolicyDecision>();
+    auto ticket = deep.submit(full_scan, [fast_decision](DriverEvaluation late) {
+        follow_up_driver_verdict(late, *fast_decision);
+    });
+    DriverEvaluation fast = base;
+    fast.result = fast_pipeline(path, extension, ev.user, ev.drive_type, ev.process_name, base.removable);
+    *fast_decision = fast.result.policy_decision;
+
+    DriverEvaluation full;
+    auto outcome = deep.wait(ticket, deadline, full);
+    if (outcome == DeadlinePool<DriverEvaluation>::Outcome::Completed) {
+        ++g_driver_full_verdicts;
+        emit_driver_event(full, std::string());
+        return to_driver_decision(full.result);
+    }
+
+    ++g_driver_fast_verdicts;
+    if (outcome == DeadlinePool<DriverEvaluation>::Outcome::Rejected) {
+        emit_driver_event(fast, "verdict_tier=fast | deep_scan=skipped");
+    }
+    return to_driver_decision(fast.result);
+}
+
+// Keeps `slots` FilterGetMessage requests pending on the minifilter port,
+// completing into one I/O completion port. A worker that dequeues a message
+// re-arms its slot before evaluating, so the driver always has a buffer to
+// deliver the next create into.
+class FilterPortSource : public DriverMessageSource {
+public:
+    FilterPortSource(HANDLE port, size_t slots) : port_(port), slot_count_(std::max<size_t>(1, slots)),
+                                                 slots_(new Slot[slot_count_]) {}
+
+    ~FilterPortSource() override {
+        // Closing the port cancels the pending requests; their buffers must
+        // stay valid until each cancellation has been dequeued.
+        CloseHandle(port_);
+        while (pending_ > 0) {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            LPOVERLAPPED ov = nullptr;
+            GetQueuedCompletionStatus(iocp_, &bytes, &key, &ov, 1000);
+            if (!ov) break;
+            --pending_;
         }
-        CloseHandle(ov.hEvent);
-        if (FAILED(hr)) {
-            if (!g_running) break;
-            continue;
+        if (pending_ > 0) {
+            log_error("Driver port: %llu requests still pending at shutdown", static_cast<unsigned long long>(pending_.load()));
+            slots_.release();
         }
+        if (iocp_) CloseHandle(iocp_);
+    }
 
-        std::string path = wc_to_utf8(msg.query.file_path, -1);
-        std::string extension = file_extension(path);
-        auto proc_info = dlp::process::GetProcessAttribution(msg.query.process_id);
-        std::string user = get_username();
-        std::string drive_type = drive_type_for_path(path);
-        bool is_removable = (drive_type == "REMOVABLE");
-        FileEvent ev;
-        ev.event_type = "file";
-        ev.action = "DRIVER_CREATE";
-        ev.path = path;
-        ev.user = user;
-        ev.user_sid = proc_info.token.user_sid;
-        ev.drive_type = drive_type;
-        ev.process_name = proc_info.process_name;
-        ev.pid = proc_info.pid;
-        ev.ppid = proc_info.ppid;
-        ev.command_line = proc_info.command_line;
-
-        PipelineResult result;
-        if (!path.empty()) {
-            result = evaluate_pipeline(path,
-                                       extension,
-                                       user,
-                                       drive_type,
-                                       ev.process_name,
-                                       is_removable,
-                                       ev.sha256,
-                                       ev.size_bytes);
-        } else {
-            result.policy_decision = resolve_rule_decision({}, is_removable, g_alert_on_removable);
+    bool start(DWORD workers) {
+        iocp_ = CreateIoCompletionPort(port_, nullptr, 0, workers);
+        if (!iocp_) {
+            log_error("Driver port: CreateIoCompletionPort failed (%lu)", GetLastError());
+            return false;
         }
+        for (size_t i = 0; i < slot_count_; ++i) post(slots_[i]);
+        return pending_ > 0;
+    }
 
-        ev.rule_id = result.rule_decision.rule_id;
-        ev.rule_name = result.rule_decision.rule_name;
-        ev.severity = result.rule_decision.severity;
-        ev.content_flags = build_content_flags(!result.pii_hits.empty(),
-                                               result.keyword_found,
-                                               result.size_exceeded,
-                                               result.fingerprint_matched);
-        ev.device_context = build_device_context(drive_type, is_removable);
-        ev.decision = result.policy_decision.decision;
-        ev.reason = result.policy_decision.reason;
-        emit_file_event(ev);
+    bool receive(DriverQuery &query) override {
+        for (;;) {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            LPOVERLAPPED ov = nullptr;
+            BOOL ok = GetQueuedCompletionStatus(iocp_, &bytes, &key, &ov, 1000);
+            if (!ov) {
+                // Timed out; look at g_running again.
+                if (!g_running) return false;
+                continue;
+            }
+            --pending_;
+            Slot &slot = *CONTAINING_RECORD(ov, Slot, ov);
+            if (!ok) {
+                if (!g_running) return false;
+                log_error("Driver port: FilterGetMessage failed (%lu)", GetLastError());
+                post(slot);
+                continue;
+            }
+            const DlpMessage &msg = slot.msg;
+            query.message_id = msg.header.MessageId;
+            query.process_id = msg.query.process_id;
+            size_t len = wcsnlen(msg.query.file_path, sizeof(msg.query.file_path) / sizeof(wchar_t));
+            query.path = wc_to_utf8(msg.query.file_path, static_cast<int>(len));
+            post(slot);
+            return true;
+        }
+    }
 
+    void reply(uint64_t message_id, const DlpPolicyDecision &decision) override {
         DlpReply reply = {};
-        reply.header.MessageId = msg.header.MessageId;
-        reply.decision.rule_id = rule_id_hash(result.rule_decision.rule_id);
-        reply.decision.severity = static_cast<uint32_t>(result.rule_decision.severity);
-        if (should_block_driver(result.policy_decision)) {
-            reply.decision.action = DlpPolicyAction::Block;
-        } else if (result.policy_decision.action == RuleAction::Alert) {
-            reply.decision.action = DlpPolicyAction::Alert;
-        } else {
-            reply.decision.action = DlpPolicyAction::Allow;
+        reply.header.MessageId = message_id;
+        reply.decision = decision;
+        HRESULT hr = FilterReplyMessage(port_, &reply.header, sizeof(reply));
+        if (FAILED(hr) && g_running) {
+            // The create was cancelled or the driver disconnected; nothing
+            // waits for this verdict any more.
+            log_error("Driver port: reply to message %llu failed (0x%08lx)",
+                      static_cast<unsigned long long>(message_id), static_cast<unsigned long>(hr));
+        }
+    }
+
+private:
+    struct Slot {
+        OVERLAPPED ov;
+        DlpMessage msg;
+    };
+
+    void post(Slot &slot) {
+        if (!g_running) return;
+        ZeroMemory(&slot.ov, sizeof(slot.ov));
+        ++pending_;
+        HRESULT hr = FilterGetMessage(port_, &slot.msg.header, sizeof(slot.msg), &slot.ov);
+        // A request that completes at once is still queued to the completion port.
+        if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_IO_PENDING)) {
+            --pending_;
+            log_error("Driver port: FilterGetMessage could not be queued (0x%08lx)", static_cast<unsigned long>(hr));
         }
-        FilterReplyMessage(port, &reply.header, sizeof(reply));
     }
-    CloseHandle(port);
+
+    HANDLE port_;
+    HANDLE iocp_ = nullptr;
+    const size_t slot_count_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> pending_{0};
+};
+
+void driver_policy_thread() {
+    log_info("Driver policy thread started");
+    HANDLE port = nullptr;
+    HRESULT hr = FilterConnectCommunicationPort(L"\\DlpMinifilterPort", 0, nullptr, 0, nullptr, &port);
+    if (FAILED(hr)) {
+        log_info("Minifilter port not available, driver policy thread exiting");
+        return;
+    }
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t slots = std::max<size_t>(g_driver_pending_messages, workers);
+    FilterPortSource source(port, slots);
+    if (!source.start(workers)) {
+        log_error("Driver port: no message requests could be queued, driver policy thread exiting");
+        return;
+    }
+    // Stopped on the way out: deep scans still queued are dropped, and only
+    // those already running hold up shutdown.
+    DeadlinePool<DriverEvaluation> deep(workers, kDeepScanQueueCapacity);
+    log_info("Driver policy pool: %u workers, %llu pending message requests, %llu ms verdict deadline", workers,
+             static_cast<unsigned long long>(slots), static_cast<unsigned long long>(g_driver_verdict_deadline_ms));
+    serve_driver_queries(source, workers, [&deep](const DriverQuery &query) {
+        return evaluate_driver_query(query, deep);
+    });
 }
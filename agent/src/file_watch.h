@@ -1,3 +1,33 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Counters for the hand-off from the directory watchers to the evaluation
+// workers.
+struct FileWatchStats {
+    // Notifications queued for evaluation and those lost to a full queue.
+    uint64_t queued = 0;
+    uint64_t dropped = 0;
+    // ReadDirectoryChangesW calls that reported a notification buffer overflow.
+    uint64_t overflows = 0;
+    // Notifications merged into a pending burst for the same path, and the
+    // paths currently waiting for their quiet window.
+    uint64_t coalesced = 0;
+    size_t pending_paths = 0;
+    size_t queue_depth = 0;
+    // Scan result cache: files looked up, those served without a rescan, and
+    // the scanning CPU time that saved.
+    uint64_t cache_lookups = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_saved_ms = 0;
+    // Minifilter creates answered with the full verdict, with the fast
+    // verdict after the deadline, and fast verdicts later overruled by a
+    // quarantine or alert.
+    uint64_t driver_full_verdicts = 0;
+    uint64_t driver_fast_verdicts = 0;
+    uint64_t driver_followups = 0;
+};
+
 void file_watch_thread();
 void driver_policy_thread();
+FileWatchStats file_watch_stats();
@@ -3,46 +3,73 @@
 #include <bcrypt.h>
 #include <vector>
 
-std::string sha256_hex(const void *data, size_t len) {
+Sha256::Sha256() {
     BCRYPT_ALG_HANDLE hAlg = NULL;
-    if (BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, NULL, 0) != 0) return std::string();
-    DWORD obj_len = 0, hash_len = 0, reslen = 0;
-    if (BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&obj_len, sizeof(DWORD), &reslen, 0) != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return std::string();
+    if (BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, NULL, 0) != 0) {
+        failed_ = true;
+        return;
     }
-    if (BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&hash_len, sizeof(DWORD), &reslen, 0) != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return std::string();
+    alg_ = hAlg;
+    DWORD obj_len = 0, reslen = 0;
+    if (BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&obj_len, sizeof(DWORD), &reslen, 0) != 0) {
+        failed_ = true;
+        return;
     }
-    std::vector<unsigned char> obj(obj_len);
+    obj_.resize(obj_len);
     BCRYPT_HASH_HANDLE hHash = NULL;
-    if (BCryptCreateHash(hAlg, &hHash, obj.data(), obj_len, NULL, 0, 0) != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return std::string();
+    if (BCryptCreateHash(hAlg, &hHash, obj_.data(), obj_len, NULL, 0, 0) != 0) {
+        failed_ = true;
+        return;
     }
-    if (BCryptHashData(hHash, (PUCHAR)data, (ULONG)len, 0) != 0) {
-        BCryptDestroyHash(hHash);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+    hash_ = hHash;
+}
+
+Sha256::~Sha256() {
+    if (hash_) BCryptDestroyHash(static_cast<BCRYPT_HASH_HANDLE>(hash_));
+    if (alg_) BCryptCloseAlgorithmProvider(static_cast<BCRYPT_ALG_HANDLE>(alg_), 0);
+}
+
+void Sha256::update(const void *data, size_t len) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    while (!failed_ && len > 0) {
+        ULONG piece = len > 0x40000000u ? 0x40000000u : static_cast<ULONG>(len);
+        if (BCryptHashData(static_cast<BCRYPT_HASH_HANDLE>(hash_), (PUCHAR)p, piece, 0) != 0) {
+            failed_ = true;
+        }
+        p += piece;
+        len -= piece;
+    }
+}
+
+std::string Sha256::finish_hex() {
+    if (failed_) return std::string();
+    failed_ = true;
+    DWORD hash_len = 0, reslen = 0;
+    if (BCryptGetProperty(static_cast<BCRYPT_ALG_HANDLE>(alg_), BCRYPT_HASH_LENGTH, (PUCHAR)&hash_len,
+                          sizeof(DWORD), &reslen, 0) != 0) {
         return std::string();
     }
     std::vector<unsigned char> hash(hash_len);
-    if (BCryptFinishHash(hHash, hash.data(), hash_len, 0) != 0) {
-        BCryptDestroyHash(hHash);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+    if (BCryptFinishHash(static_cast<BCRYPT_HASH_HANDLE>(hash_), hash.data(), hash_len, 0) != 0) {
         return std::string();
     }
-    BCryptDestroyHash(hHash);
-    BCryptCloseAlgorithmProvider(hAlg,0);
     static const char hex[] = "0123456789abcdef";
-    std::string out; out.reserve(hash_len*2);
-    for (DWORD i=0;i<hash_len;i++) {
+    std::string out;
+    out.reserve(hash_len * 2);
+    for (DWORD i = 0; i < hash_len; ++i) {
         unsigned char b = hash[i];
-        out.push_back(hex[b>>4]); out.push_back(hex[b&0xF]);
+        out.push_back(hex[b >> 4]);
+        out.push_back(hex[b & 0xF]);
     }
     return out;
 }
 
+std::string sha256_hex(const void *data, size_t len) {
+    Sha256 hash;
+    hash.update(data, len);
+    return hash.finish_hex();
+}
+
 std::string hmac_sha256_hex(const std::string &key, const std::string &data) {
     BCRYPT_ALG_HANDLE hAlg = NULL;
     if (BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, NULL, BCRYPT_ALG_HANDLE_HMAC_FLAG) != 0) {
@@ -1,4 +1,27 @@
 #pragma once
 #include <string>
+#include <vector>
+
 std::string sha256_hex(const void *data, size_t len);
 std::string hmac_sha256_hex(const std::string &key, const std::string &data);
+
+// SHA-256 over data that arrives in pieces, e.g. a file read block by block.
+class Sha256 {
+public:
+    Sha256();
+    ~Sha256();
+    Sha256(const Sha256 &) = delete;
+    Sha256 &operator=(const Sha256 &) = delete;
+
+    void update(const void *data, size_t len);
+    // Hex digest of everything passed to update(); empty if hashing failed.
+    // The object is spent afterwards.
+    std::string finish_hex();
+
+private:
+    // BCRYPT_ALG_HANDLE / BCRYPT_HASH_HANDLE, kept opaque here.
+    void *alg_ = nullptr;
+    void *hash_ = nullptr;
+    std::vector<unsigned char> obj_;
+    bool failed_ = false;
+};
@@ -0,0 +1,94 @@
+#include "hash_index.h"
+#include <algorithm>
+#include <cstring>
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Digests are uniformly distributed already; any eight bytes make a hash.
+static size_t slot_hash(const HashIndex::Digest &digest) {
+    uint64_t h;
+    std::memcpy(&h, digest.data(), sizeof(h));
+    return static_cast<size_t>(h ^ (h >> 29));
+}
+
+bool HashIndex::parse_hex(const std::string &hex, Digest &out) {
+    if (hex.size() != out.size() * 2) return false;
+    for (size_t i = 0; i < out.size(); ++i) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+void HashIndex::add(const Digest &digest, uint64_t value) {
+    pending_.push_back({digest, value});
+}
+
+void HashIndex::build() {
+    std::sort(pending_.begin(), pending_.end());
+    pending_.erase(std::unique(pending_.begin(), pending_.end()), pending_.end());
+
+    count_ = 0;
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        if (i == 0 || pending_[i].first != pending_[i - 1].first) ++count_;
+    }
+    slots_.clear();
+    values_.clear();
+    mask_ = 0;
+    if (count_ == 0) {
+        pending_.clear();
+        pending_.shrink_to_fit();
+        return;
+    }
+    // Keep the load factor at or below 3/4 so probe runs stay short.
+    size_t capacity = 16;
+    while (capacity * 3 < count_ * 4) capacity <<= 1;
+    slots_.assign(capacity, Slot());
+    mask_ = capacity - 1;
+    values_.reserve(pending_.size());
+
+    for (size_t i = 0; i < pending_.size();) {
+        const Digest &digest = pending_[i].first;
+        size_t pos = slot_hash(digest) & mask_;
+        while (slots_[pos].end != 0) pos = (pos + 1) & mask_;
+        Slot &slot = slots_[pos];
+        slot.digest = digest;
+        slot.begin = static_cast<uint32_t>(values_.size());
+        for (; i < pending_.size() && pending_[i].first == digest; ++i) {
+            values_.push_back(pending_[i].second);
+        }
+        slot.end = static_cast<uint32_t>(values_.size());
+    }
+    pending_.clear();
+    pending_.shrink_to_fit();
+}
+
+void HashIndex::clear() {
+    pending_.clear();
+    slots_.clear();
+    values_.clear();
+    mask_ = 0;
+    count_ = 0;
+}
+
+HashIndex::Range HashIndex::lookup(const Digest &digest) const {
+    if (slots_.empty()) return Range(nullptr, nullptr);
+    for (size_t pos = slot_hash(digest) & mask_;; pos = (pos + 1) & mask_) {
+        const Slot &slot = slots_[pos];
+        if (slot.end == 0) return Range(nullptr, nullptr);
+        if (slot.digest == digest) {
+            return Range(values_.data() + slot.begin, values_.data() + slot.end);
+        }
+    }
+}
+
+size_t HashIndex::memory_bytes() const {
+    return slots_.capacity() * sizeof(Slot) + values_.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Open-addressing table from 32-byte SHA-256 digests to the values added for
+// them. Built once, then immutable: lookups are a handful of probes over a
+// flat array and never allocate.
+class HashIndex {
+public:
+    using Digest = std::array<uint8_t, 32>;
+    // A contiguous, ascending run of the values stored for one digest.
+    using Range = std::pair<const uint64_t *, const uint64_t *>;
+
+    // Parses 64 hex digits (either case) into a digest.
+    static bool parse_hex(const std::string &hex, Digest &out);
+
+    void add(const Digest &digest, uint64_t value);
+    void build();
+    void clear();
+
+    // Rewrites every stored value in place; `fn` must keep the values of one
+    // digest in ascending order.
+    template <typename Fn>
+    void transform_values(Fn fn) {
+        for (auto &value : values_) value = fn(value);
+    }
+
+    Range lookup(const Digest &digest) const;
+    size_t size() const { return count_; }
+    size_t memory_bytes() const;
+
+private:
+    friend class PolicyImage;
+
+    struct Slot {
+        Digest digest;
+        // Values live in values_[begin, end); end == 0 marks an empty slot.
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    std::vector<std::pair<Digest, uint64_t>> pending_;
+    std::vector<Slot> slots_;
+    std::vector<uint64_t> values_;
+    size_t mask_ = 0;
+    size_t count_ = 0;
+};
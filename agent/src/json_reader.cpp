@@ -0,0 +1,368 @@
+#include "json_reader.h"
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr int kMaxDepth = 256;
+
+struct Parser {
+    std::string_view text;
+    size_t pos = 0;
+    std::string message;
+
+    bool fail(const char *what) {
+        if (message.empty()) message = what;
+        return false;
+    }
+
+    void skip_ws() {
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (c != ' ' && c != '\n' && c != '\r' && c != '\t') break;
+            ++pos;
+        }
+    }
+
+    bool literal(std::string_view word) {
+        if (text.compare(pos, word.size(), word) != 0) return fail("invalid literal");
+        pos += word.size();
+        return true;
+    }
+
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    bool number() {
+        if (pos < text.size() && text[pos] == '-') ++pos;
+        if (pos >= text.size() || !is_digit(text[pos])) return fail("invalid number");
+        if (text[pos] == '0') {
+            ++pos;
+        } else {
+            while (pos < text.size() && is_digit(text[pos])) ++pos;
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            if (pos >= text.size() || !is_digit(text[pos])) return fail("invalid number");
+            while (pos < text.size() && is_digit(text[pos])) ++pos;
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) ++pos;
+            if (pos >= text.size() || !is_digit(text[pos])) return fail("invalid number");
+            while (pos < text.size() && is_digit(text[pos])) ++pos;
+        }
+        return true;
+    }
+
+    // Called on the opening quote; leaves pos after the closing quote.
+    bool string(bool &escaped) {
+        ++pos;
+        escaped = false;
+        const char *base = text.data();
+        while (pos < text.size()) {
+            // Jump to the next quote; only the stretch before it can hold an
+            // escape, and most strings have none.
+            const void *q = std::memchr(base + pos, '"', text.size() - pos);
+            size_t quote = q ? static_cast<size_t>(static_cast<const char *>(q) - base) : text.size();
+            const void *b = std::memchr(base + pos, '\\', quote - pos);
+            if (!b) {
+                if (quote == text.size()) break;
+                pos = quote + 1;
+                return true;
+            }
+            escaped = true;
+            pos = static_cast<size_t>(static_cast<const char *>(b) - base);
+            if (pos + 1 >= text.size()) break;
+            char e = text[pos + 1];
+            if (e == 'u') {
+                for (size_t k = 2; k < 6; ++k) {
+                    char h = pos + k < text.size() ? text[pos + k] : '\0';
+                    bool hex = is_digit(h) || (h >= 'a' && h <= 'f') || (h >= 'A' && h <= 'F');
+                    if (!hex) return fail("invalid \\u escape");
+                }
+                pos += 6;
+                continue;
+            }
+            if (e != '"' && e != '\\' && e != '/' && e != 'b' && e != 'f' && e != 'n' && e != 'r' && e != 't') {
+                return fail("invalid escape");
+            }
+            pos += 2;
+        }
+        return fail("unterminated string");
+    }
+};
+
+void append_utf8(std::string &out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+uint32_t hex4(std::string_view s, size_t at) {
+    uint32_t v = 0;
+    for (size_t k = 0; k < 4; ++k) {
+        char c = s[at + k];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= static_cast<uint32_t>(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= static_cast<uint32_t>(c - 'a' + 10);
+        else v |= static_cast<uint32_t>(c - 'A' + 10);
+    }
+    return v;
+}
+
+}  // namespace
+
+std::string JsonDocument::unescape(std::string_view raw) {
+    std::string out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c != '\\' || i + 1 >= raw.size()) {
+            out.push_back(c);
+            continue;
+        }
+        char e = raw[++i];
+        switch (e) {
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                if (i + 4 >= raw.size()) break;
+                uint32_t cp = hex4(raw, i + 1);
+                i += 4;
+                if (cp >= 0xD800 && cp < 0xDC00 && i + 6 < raw.size() && raw[i + 1] == '\\' &&
+                    raw[i + 2] == 'u') {
+                    uint32_t low = hex4(raw, i + 3);
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default: out.push_back(e); break;
+        }
+    }
+    return out;
+}
+
+bool JsonDocument::parse(std::string_view text, std::string *error) {
+    nodes_.clear();
+    text_ = text;
+    Parser p{text};
+    if (text.size() >= std::numeric_limits<uint32_t>::max()) {
+        p.fail("document too large");
+    } else {
+        // Policies average roughly one node per couple dozen bytes.
+        nodes_.reserve(text.size() / 24 + 16);
+        // Node indices of the containers currently open.
+        std::vector<uint32_t> open;
+        bool ok = true;
+        bool done = false;
+        while (ok && !done) {
+            p.skip_ws();
+            if (!open.empty()) {
+                Node &parent = nodes_[open.back()];
+                bool in_object = parent.type == JsonType::Object;
+                bool first = parent.length == 0;
+                char c = p.pos < text.size() ? text[p.pos] : '\0';
+                if (c == (in_object ? '}' : ']')) {
+                    ++p.pos;
+                    nodes_[open.back()].end = static_cast<uint32_t>(nodes_.size());
+                    open.pop_back();
+                    if (open.empty()) done = true;
+                    continue;
+                }
+                if (!first) {
+                    if (c != ',') {
+                        ok = p.fail(in_object ? "expected ',' or '}'" : "expected ',' or ']'");
+                        break;
+                    }
+                    ++p.pos;
+                    p.skip_ws();
+                }
+                ++parent.length;
+                if (in_object) {
+                    if (p.pos >= text.size() || text[p.pos] != '"') {
+                        ok = p.fail("expected object key");
+                        break;
+                    }
+                    size_t start = p.pos;
+                    bool escaped = false;
+                    if (!p.string(escaped)) {
+                        ok = false;
+                        break;
+                    }
+                    nodes_.push_back(Node{JsonType::String, escaped, true, static_cast<uint32_t>(start + 1),
+                                          static_cast<uint32_t>(p.pos - start - 2),
+                                          static_cast<uint32_t>(nodes_.size() + 1)});
+                    p.skip_ws();
+                    if (p.pos >= text.size() || text[p.pos] != ':') {
+                        ok = p.fail("expected ':'");
+                        break;
+                    }
+                    ++p.pos;
+                    p.skip_ws();
+                }
+            }
+
+            if (p.pos >= text.size()) {
+                ok = p.fail("unexpected end of input");
+                break;
+            }
+            size_t start = p.pos;
+            char c = text[p.pos];
+            uint32_t index = static_cast<uint32_t>(nodes_.size());
+            if (c == '{' || c == '[') {
+                if (open.size() >= static_cast<size_t>(kMaxDepth)) {
+                    ok = p.fail("nesting too deep");
+                    break;
+                }
+                ++p.pos;
+                nodes_.push_back(Node{c == '{' ? JsonType::Object : JsonType::Array, false, false,
+                                      static_cast<uint32_t>(start), 0, index + 1});
+                open.push_back(index);
+                continue;
+            }
+            Node node{JsonType::Null, false, false, static_cast<uint32_t>(start), 0, index + 1};
+            if (c == '"') {
+                node.type = JsonType::String;
+                ok = p.string(node.escaped);
+                node.offset = static_cast<uint32_t>(start + 1);
+                node.length = static_cast<uint32_t>(p.pos - start - 2);
+            } else if (c == 't' || c == 'f') {
+                node.type = JsonType::Bool;
+                ok = p.literal(c == 't' ? "true" : "false");
+                node.length = static_cast<uint32_t>(p.pos - start);
+            } else if (c == 'n') {
+                ok = p.literal("null");
+                node.length = 4;
+            } else if (c == '-' || Parser::is_digit(c)) {
+                node.type = JsonType::Number;
+                ok = p.number();
+                node.length = static_cast<uint32_t>(p.pos - start);
+            } else {
+                ok = p.fail("unexpected character");
+            }
+            if (!ok) break;
+            nodes_.push_back(node);
+            if (open.empty()) done = true;
+        }
+        if (ok) {
+            p.skip_ws();
+            if (p.pos != text.size()) p.fail("trailing characters");
+        }
+    }
+    if (!p.message.empty()) {
+        if (error) *error = p.message + " at offset " + std::to_string(p.pos);
+        nodes_.clear();
+        text_ = std::string_view();
+        return false;
+    }
+    return true;
+}
+
+JsonValue JsonDocument::root() const {
+    if (nodes_.empty()) return JsonValue();
+    return JsonValue(this, 0);
+}
+
+JsonType JsonValue::type() const {
+    return doc_->nodes_[index_].type;
+}
+
+std::string_view JsonValue::raw() const {
+    if (!valid()) return std::string_view();
+    const auto &node = doc_->nodes_[index_];
+    if (node.type == JsonType::Array || node.type == JsonType::Object) return std::string_view();
+    return doc_->text_.substr(node.offset, node.length);
+}
+
+std::string JsonValue::as_string(const std::string &fallback) const {
+    if (!valid()) return fallback;
+    const auto &node = doc_->nodes_[index_];
+    switch (node.type) {
+        case JsonType::String:
+            return node.escaped ? JsonDocument::unescape(raw()) : std::string(raw());
+        case JsonType::Number:
+        case JsonType::Bool:
+            return std::string(raw());
+        default:
+            return fallback;
+    }
+}
+
+long long JsonValue::as_int(long long fallback) const {
+    if (!is_number()) return fallback;
+    std::string_view text = raw();
+    long long value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) return fallback;
+    return value;
+}
+
+bool JsonValue::as_bool(bool fallback) const {
+    if (!is_bool()) return fallback;
+    return raw()[0] == 't';
+}
+
+bool JsonValue::equals(std::string_view text) const {
+    if (!is_string()) return false;
+    const auto &node = doc_->nodes_[index_];
+    if (!node.escaped) return raw() == text;
+    return JsonDocument::unescape(raw()) == text;
+}
+
+JsonValue JsonValue::get(std::string_view key) const {
+    for (const auto &member : members()) {
+        if (member.key.equals(key)) return member.value;
+    }
+    return JsonValue();
+}
+
+JsonValue JsonValue::find_first(std::string_view key) const {
+    if (!valid()) return JsonValue();
+    const auto &nodes = doc_->nodes_;
+    for (uint32_t i = index_ + 1; i < nodes[index_].end; ++i) {
+        if (nodes[i].key && JsonValue(doc_, i).equals(key)) return JsonValue(doc_, i + 1);
+    }
+    return JsonValue();
+}
+
+JsonValue::Range<JsonValue::ElementIterator> JsonValue::elements() const {
+    if (!is_array()) return {ElementIterator(nullptr, 0), ElementIterator(nullptr, 0)};
+    const auto &node = doc_->nodes_[index_];
+    return {ElementIterator(doc_, index_ + 1), ElementIterator(doc_, node.end)};
+}
+
+JsonValue::Range<JsonValue::MemberIterator> JsonValue::members() const {
+    if (!is_object()) return {MemberIterator(nullptr, 0), MemberIterator(nullptr, 0)};
+    const auto &node = doc_->nodes_[index_];
+    return {MemberIterator(doc_, index_ + 1), MemberIterator(doc_, node.end)};
+}
+
+JsonValue::ElementIterator &JsonValue::ElementIterator::operator++() {
+    index_ = doc_->nodes_[index_].end;
+    return *this;
+}
+
+JsonValue::MemberIterator &JsonValue::MemberIterator::operator++() {
+    index_ = doc_->nodes_[index_ + 1].end;
+    return *this;
+}
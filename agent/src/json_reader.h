@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal JSON reader: one pass over the text builds a flat tape of nodes
+// that point back into the source buffer, so nothing is copied until a
+// caller asks for a value. Strings are unescaped lazily. The source buffer
+// must outlive the document.
+
+enum class JsonType : uint8_t { Null, Bool, Number, String, Array, Object };
+
+class JsonDocument;
+
+class JsonValue {
+public:
+    JsonValue() = default;
+
+    bool valid() const { return doc_ != nullptr; }
+    JsonType type() const;
+    bool is_null() const { return valid() && type() == JsonType::Null; }
+    bool is_bool() const { return valid() && type() == JsonType::Bool; }
+    bool is_number() const { return valid() && type() == JsonType::Number; }
+    bool is_string() const { return valid() && type() == JsonType::String; }
+    bool is_array() const { return valid() && type() == JsonType::Array; }
+    bool is_object() const { return valid() && type() == JsonType::Object; }
+
+    // Source text of a scalar: string contents without the quotes (escapes
+    // left in place), or the literal of a number or boolean.
+    std::string_view raw() const;
+    // String contents with escapes resolved; for numbers and booleans their
+    // literal. Anything else yields `fallback`.
+    std::string as_string(const std::string &fallback = std::string()) const;
+    long long as_int(long long fallback) const;
+    bool as_bool(bool fallback) const;
+    // True when this is a string equal to `text` once unescaped.
+    bool equals(std::string_view text) const;
+
+    // Member of an object, or an invalid value.
+    JsonValue get(std::string_view key) const;
+    // First member named `key` anywhere below this value, in document order.
+    JsonValue find_first(std::string_view key) const;
+
+    class ElementIterator;
+    class MemberIterator;
+    struct Member;
+    template <typename It>
+    struct Range {
+        It first;
+        It last;
+        It begin() const { return first; }
+        It end() const { return last; }
+    };
+    // Elements of an array; empty for anything else.
+    Range<ElementIterator> elements() const;
+    // Key/value pairs of an object; empty for anything else.
+    Range<MemberIterator> members() const;
+
+private:
+    friend class JsonDocument;
+    JsonValue(const JsonDocument *doc, uint32_t index) : doc_(doc), index_(index) {}
+
+    const JsonDocument *doc_ = nullptr;
+    uint32_t index_ = 0;
+};
+
+struct JsonValue::Member {
+    JsonValue key;
+    JsonValue value;
+};
+
+class JsonValue::ElementIterator {
+public:
+    ElementIterator(const JsonDocument *doc, uint32_t index) : doc_(doc), index_(index) {}
+    JsonValue operator*() const { return JsonValue(doc_, index_); }
+    ElementIterator &operator++();
+    bool operator!=(const ElementIterator &other) const { return index_ != other.index_; }
+
+private:
+    const JsonDocument *doc_;
+    uint32_t index_;
+};
+
+class JsonValue::MemberIterator {
+public:
+    MemberIterator(const JsonDocument *doc, uint32_t index) : doc_(doc), index_(index) {}
+    Member operator*() const { return Member{JsonValue(doc_, index_), JsonValue(doc_, index_ + 1)}; }
+    MemberIterator &operator++();
+    bool operator!=(const MemberIterator &other) const { return index_ != other.index_; }
+
+private:
+    const JsonDocument *doc_;
+    uint32_t index_;
+};
+
+class JsonDocument {
+public:
+    // Parses `text`. On failure returns false and describes the problem and
+    // its byte offset in `error`; the document is then empty.
+    bool parse(std::string_view text, std::string *error = nullptr);
+    JsonValue root() const;
+    size_t node_count() const { return nodes_.size(); }
+
+    static std::string unescape(std::string_view raw);
+
+private:
+    friend class JsonValue;
+    friend class JsonValue::ElementIterator;
+    friend class JsonValue::MemberIterator;
+
+    struct Node {
+        JsonType type;
+        bool escaped;
+        bool key;
+        uint32_t offset;
+        uint32_t length;
+        // One past the last node of this value's subtree.
+        uint32_t end;
+    };
+
+    std::string_view text_;
+    std::vector<Node> nodes_;
+};
@@ -0,0 +1,188 @@
+#include "keyword_matcher.h"
+#include <algorithm>
+
+namespace {
+
+struct FoldTable {
+    unsigned char map[256];
+    FoldTable() {
+        for (int c = 0; c < 256; ++c) {
+            map[c] = static_cast<unsigned char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+        }
+    }
+};
+
+const FoldTable kFold;
+
+}  // namespace
+
+uint32_t KeywordMatcher::add(const std::string &keyword) {
+    if (keyword.empty()) return npos;
+    if (trie_.empty()) {
+        trie_.emplace_back();
+        pattern_.assign(1, npos);
+    }
+    uint32_t state = 0;
+    for (unsigned char raw : keyword) {
+        unsigned char c = kFold.map[raw];
+        uint32_t next = 0;
+        for (const auto &edge : trie_[state]) {
+            if (edge.first == c) {
+                next = edge.second;
+                break;
+            }
+        }
+        if (next == 0) {
+            next = static_cast<uint32_t>(trie_.size());
+            trie_[state].emplace_back(c, next);
+            trie_.emplace_back();
+            pattern_.push_back(npos);
+        }
+        state = next;
+    }
+    if (pattern_[state] == npos) {
+        pattern_[state] = static_cast<uint32_t>(patterns_++);
+    }
+    return pattern_[state];
+}
+
+void KeywordMatcher::build() {
+    if (trie_.empty()) {
+        clear();
+        return;
+    }
+    const size_t n = trie_.size();
+    for (auto &edges : trie_) {
+        std::sort(edges.begin(), edges.end());
+    }
+
+    // Renumber states breadth-first so shallow states, where scans spend
+    // almost all their time, get the low ids covered by the dense table.
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> renumber(n, 0);
+    order.reserve(n);
+    order.push_back(0);
+    for (size_t head = 0; head < order.size(); ++head) {
+        for (const auto &edge : trie_[order[head]]) {
+            renumber[edge.second] = static_cast<uint32_t>(order.size());
+            order.push_back(edge.second);
+        }
+    }
+    std::vector<uint32_t> pattern(n, npos);
+    edge_offset_.assign(n + 1, 0);
+    edge_label_.clear();
+    edge_target_.clear();
+    for (size_t s = 0; s < n; ++s) {
+        const auto &edges = trie_[order[s]];
+        pattern[s] = pattern_[order[s]];
+        edge_offset_[s] = static_cast<uint32_t>(edge_label_.size());
+        for (const auto &edge : edges) {
+            edge_label_.push_back(edge.first);
+            edge_target_.push_back(renumber[edge.second]);
+        }
+    }
+    edge_offset_[n] = static_cast<uint32_t>(edge_label_.size());
+    pattern_.swap(pattern);
+    trie_.clear();
+    trie_.shrink_to_fit();
+
+    auto child = [this](uint32_t state, unsigned char c) -> uint32_t {
+        for (uint32_t e = edge_offset_[state]; e < edge_offset_[state + 1]; ++e) {
+            if (edge_label_[e] == c) return edge_target_[e];
+        }
+        return 0;
+    };
+    // BFS numbering means every state's parent and fail target precede it.
+    fail_.assign(n, 0);
+    output_.assign(n, 0);
+    for (uint32_t u = 0; u < n; ++u) {
+        for (uint32_t e = edge_offset_[u]; e < edge_offset_[u + 1]; ++e) {
+            uint32_t v = edge_target_[e];
+            if (u == 0) continue;
+            uint32_t f = fail_[u];
+            uint32_t target = child(f, edge_label_[e]);
+            while (f != 0 && target == 0) {
+                f = fail_[f];
+                target = child(f, edge_label_[e]);
+            }
+            fail_[v] = target;
+        }
+        if (u != 0) {
+            output_[u] = pattern_[fail_[u]] != npos ? fail_[u] : output_[fail_[u]];
+        }
+    }
+
+    dense_states_ = std::min<size_t>(n, kDenseStates);
+    dense_.assign(dense_states_ * 256, 0);
+    for (uint32_t s = 0; s < dense_states_; ++s) {
+        uint32_t *row = &dense_[static_cast<size_t>(s) * 256];
+        if (s != 0) {
+            const uint32_t *fail_row = &dense_[static_cast<size_t>(fail_[s]) * 256];
+            std::copy(fail_row, fail_row + 256, row);
+        }
+        for (uint32_t e = edge_offset_[s]; e < edge_offset_[s + 1]; ++e) {
+            row[edge_label_[e]] = edge_target_[e];
+        }
+    }
+}
+
+void KeywordMatcher::clear() {
+    patterns_ = 0;
+    trie_.clear();
+    dense_states_ = 0;
+    dense_.clear();
+    edge_offset_.clear();
+    edge_label_.clear();
+    edge_target_.clear();
+    fail_.clear();
+    pattern_.clear();
+    output_.clear();
+}
+
+void KeywordMatcher::begin(Scratch &scratch) const {
+    if (scratch.stamp.size() < patterns_) {
+        scratch.stamp.resize(patterns_, 0);
+    }
+    if (++scratch.epoch == 0) {
+        std::fill(scratch.stamp.begin(), scratch.stamp.end(), 0u);
+        scratch.epoch = 1;
+    }
+    scratch.hits.clear();
+}
+
+uint32_t KeywordMatcher::next_state(uint32_t state, unsigned char c) const {
+    while (state >= dense_states_) {
+        uint32_t lo = edge_offset_[state];
+        uint32_t hi = edge_offset_[state + 1];
+        if (hi - lo <= 8) {
+            for (uint32_t e = lo; e < hi; ++e) {
+                if (edge_label_[e] == c) return edge_target_[e];
+            }
+        } else {
+            auto first = edge_label_.begin() + lo;
+            auto it = std::lower_bound(first, edge_label_.begin() + hi, c);
+            if (it != edge_label_.begin() + hi && *it == c) {
+                return edge_target_[lo + static_cast<uint32_t>(it - first)];
+            }
+        }
+        state = fail_[state];
+    }
+    return dense_[static_cast<size_t>(state) * 256 + c];
+}
+
+uint32_t KeywordMatcher::feed(uint32_t state, const char *data, size_t len, Scratch &scratch) const {
+    if (fail_.empty()) return state;
+    for (size_t i = 0; i < len; ++i) {
+        state = next_state(state, kFold.map[static_cast<unsigned char>(data[i])]);
+        uint32_t node = pattern_[state] != npos ? state : output_[state];
+        // A pattern already reported implies its whole suffix chain was too.
+        while (node != 0) {
+            uint32_t id = pattern_[node];
+            if (scratch.stamp[id] == scratch.epoch) break;
+            scratch.stamp[id] = scratch.epoch;
+            scratch.hits.push_back(id);
+            node = output_[node];
+        }
+    }
+    return state;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ASCII case-insensitive Aho-Corasick automaton over any number of keywords.
+// Scanning is linear in the text length plus the number of distinct keywords
+// reported; the automaton is immutable once built and safe to share between
+// threads.
+class KeywordMatcher {
+public:
+    static constexpr uint32_t npos = 0xFFFFFFFFu;
+
+    // Per-thread scan state: remembers which patterns were already reported so
+    // repeated occurrences are not walked again.
+    struct Scratch {
+        std::vector<uint32_t> stamp;
+        uint32_t epoch = 0;
+        std::vector<uint32_t> hits;
+    };
+
+    // Adds a keyword (lowercased) and returns its pattern id. Identical
+    // keywords share one id. Empty keywords return npos.
+    uint32_t add(const std::string &keyword);
+    void build();
+    void clear();
+
+    bool empty() const { return patterns_ == 0; }
+    size_t pattern_count() const { return patterns_; }
+    size_t state_count() const { return fail_.size(); }
+
+    // Starts a new scan: resets the reported-pattern set in `scratch`.
+    void begin(Scratch &scratch) const;
+    // Feeds `len` bytes from automaton state `state` and returns the state
+    // reached. Ids of newly seen patterns are appended to scratch.hits.
+    uint32_t feed(uint32_t state, const char *data, size_t len, Scratch &scratch) const;
+
+private:
+    friend class PolicyImage;
+
+    uint32_t next_state(uint32_t state, unsigned char c) const;
+
+    size_t patterns_ = 0;
+    // Build-time trie; released by build().
+    std::vector<std::vector<std::pair<unsigned char, uint32_t>>> trie_;
+    // Flattened automaton, states numbered breadth-first. The first
+    // dense_states_ states carry a full 256-entry transition row.
+    static constexpr size_t kDenseStates = 1024;
+    size_t dense_states_ = 0;
+    std::vector<uint32_t> dense_;
+    std::vector<uint32_t> edge_offset_;
+    std::vector<unsigned char> edge_label_;
+    std::vector<uint32_t> edge_target_;
+    std::vector<uint32_t> fail_;
+    std::vector<uint32_t> pattern_;
+    std::vector<uint32_t> output_;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The view stays valid until
+// close() or destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Maps `path`; fails for missing or empty files.
+    bool open(const std::string &path);
+    void close();
+
+    const unsigned char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const unsigned char *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void *file_ = nullptr;
+    void *mapping_ = nullptr;
+#endif
+};
@@ -0,0 +1,50 @@
+#include "path_coalescer.h"
+
+#include <algorithm>
+#include <cctype>
+
+static std::string path_key(const std::string &path) {
+    std::string key = path;
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+    return key;
+}
+
+void PathCoalescer::add(const std::string &path, uint32_t action, Clock::time_point now) {
+    auto inserted = bursts_.emplace(path_key(path), Burst());
+    Burst &burst = inserted.first->second;
+    if (inserted.second) {
+        burst.path = path;
+        burst.first_seen = now;
+    } else {
+        ++merged_;
+    }
+    burst.last_seen = now;
+    ++burst.notifications;
+    if (!burst.actions.empty() && burst.actions.back() == action) return;
+    if (burst.actions.size() == kMaxActions) burst.actions.pop_back();
+    burst.actions.push_back(action);
+}
+
+PathCoalescer::Clock::time_point PathCoalescer::due(const Burst &burst) const {
+    return std::min(burst.last_seen + quiet_, burst.first_seen + max_delay_);
+}
+
+void PathCoalescer::take_due(Clock::time_point now, std::vector<Burst> &out) {
+    size_t first = out.size();
+    for (auto it = bursts_.begin(); it != bursts_.end();) {
+        if (due(it->second) <= now) {
+            out.push_back(std::move(it->second));
+            it = bursts_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::sort(out.begin() + first, out.end(),
+              [](const Burst &a, const Burst &b) { return a.first_seen < b.first_seen; });
+}
+
+PathCoalescer::Clock::time_point PathCoalescer::next_due() const {
+    Clock::time_point next = Clock::time_point::max();
+    for (const auto &entry : bursts_) next = std::min(next, due(entry.second));
+    return next;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Merges bursts of change notifications for the same path into one. A burst
+// is due once no notification for its path arrived for `quiet`, or, while
+// the path keeps changing, `max_delay` after its first notification. Paths
+// compare ASCII case-insensitively, as on Windows volumes. Not thread-safe.
+class PathCoalescer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Burst {
+        // Path as first reported.
+        std::string path;
+        // Actions in arrival order with immediate repeats collapsed, capped
+        // at kMaxActions (the last one is always kept).
+        std::vector<uint32_t> actions;
+        size_t notifications = 0;
+        Clock::time_point first_seen;
+        Clock::time_point last_seen;
+    };
+
+    static constexpr size_t kMaxActions = 16;
+
+    PathCoalescer(Clock::duration quiet, Clock::duration max_delay)
+        : quiet_(quiet), max_delay_(max_delay) {}
+
+    void add(const std::string &path, uint32_t action, Clock::time_point now);
+    // Moves every burst due at `now` into `out`, oldest first.
+    void take_due(Clock::time_point now, std::vector<Burst> &out);
+    // When the next burst falls due; Clock::time_point::max() if none is pending.
+    Clock::time_point next_due() const;
+
+    size_t pending() const { return bursts_.size(); }
+    // Notifications folded into a burst that was already pending.
+    uint64_t merged() const { return merged_; }
+
+private:
+    Clock::time_point due(const Burst &burst) const;
+
+    Clock::duration quiet_;
+    Clock::duration max_delay_;
+    std::unordered_map<std::string, Burst> bursts_;
+    uint64_t merged_ = 0;
+};
@@ -1,113 +1,386 @@
 #include "pii_detector.h"
+#include "byte_classes.h"
+#include "pii_validators.h"
 #include <algorithm>
-#include <cctype>
+#include <iterator>
+#include <memory>
 #include <regex>
+#include <string_view>
 
-static bool luhn_check(const std::string &digits) {
-    int sum = 0;
-    bool alternate = false;
-    for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
-        if (!std::isdigit(static_cast<unsigned char>(*it))) continue;
-        int n = *it - '0';
-        if (alternate) {
-            n *= 2;
-            if (n > 9) n -= 9;
+namespace {
+
+// Byte classes of the built-in patterns, in the "C" locale std::regex uses.
+enum : uint16_t {
+    kWord = 1 << 0,           // \w: [A-Za-z0-9_]
+    kDigit = 1 << 1,          // [0-9]
+    kUpper = 1 << 2,          // [A-Z]
+    kLetter = 1 << 3,         // [A-Z], case-insensitive
+    kEmailLocal = 1 << 4,     // [A-Z0-9._%+-], case-insensitive
+    kEmailDomain = 1 << 5,    // [A-Z0-9.-], case-insensitive
+    kPhoneBody = 1 << 6,      // [0-9()\-\.\s]
+    kCardSeparator = 1 << 7,  // [ -]
+    kIbanBody = 1 << 8,       // [A-Z0-9]
+    kPhoneStart = 1 << 9,     // \+?[0-9]
+};
+
+struct ClassTable {
+    uint16_t bits[256] = {};
+    ClassTable() {
+        for (int c = 0; c < 256; ++c) {
+            const bool digit = c >= '0' && c <= '9';
+            const bool upper = c >= 'A' && c <= 'Z';
+            const bool letter = upper || (c >= 'a' && c <= 'z');
+            uint16_t b = 0;
+            if (digit || letter || c == '_') b |= kWord;
+            if (digit) b |= kDigit | kPhoneStart;
+            if (upper) b |= kUpper;
+            if (letter) b |= kLetter;
+            if (digit || letter || c == '.' || c == '_' || c == '%' || c == '+' || c == '-') b |= kEmailLocal;
+            if (digit || letter || c == '.' || c == '-') b |= kEmailDomain;
+            if (digit || c == '(' || c == ')' || c == '-' || c == '.' || c == ' ' || (c >= '\t' && c <= '\r')) {
+                b |= kPhoneBody;
+            }
+            if (c == ' ' || c == '-') b |= kCardSeparator;
+            if (digit || upper) b |= kIbanBody;
+            if (c == '+') b |= kPhoneStart;
+            bits[c] = b;
         }
-        sum += n;
-        alternate = !alternate;
-    }
-    return sum % 10 == 0;
-}
-
-static bool iban_check(const std::string &iban) {
-    std::string rearranged = iban.substr(4) + iban.substr(0, 4);
-    int mod = 0;
-    for (char c : rearranged) {
-        if (std::isspace(static_cast<unsigned char>(c))) continue;
-        if (std::isdigit(static_cast<unsigned char>(c))) {
-            mod = (mod * 10 + (c - '0')) % 97;
-        } else if (std::isalpha(static_cast<unsigned char>(c))) {
-            int value = std::toupper(static_cast<unsigned char>(c)) - 'A' + 10;
-            mod = (mod * 10 + (value / 10)) % 97;
-            mod = (mod * 10 + (value % 10)) % 97;
-        } else {
-            return false;
+    }
+};
+
+const ClassTable kClasses;
+constexpr size_t npos = static_cast<size_t>(-1);
+
+// The window being scanned. Offsets are window offsets.
+struct Text {
+    const char *data;
+    size_t size;
+    bool final;
+
+    bool is(size_t i, uint16_t cls) const {
+        return i < size && (kClasses.bits[static_cast<unsigned char>(data[i])] & cls) != 0;
+    }
+    // \b as std::regex evaluates it. A non-final window has more text after
+    // it, so its end is never a boundary (match_not_eow).
+    bool boundary(size_t i) const {
+        if (i >= size && !final) return false;
+        return (i > 0 && is(i - 1, kWord)) != is(i, kWord);
+    }
+};
+
+// Each matcher answers "does the pattern match starting exactly at `s`, and
+// where does that match end" with std::regex's backtracking order, so that
+// trying starts left to right reproduces regex_search.
+
+// \b[A-Z0-9._%+-]+@[A-Z0-9.-]+\.[A-Z]{2,}\b, case-insensitive. The local part
+// cannot contain '@', so every start in one run of local characters ends at
+// that run's '@' and shares its domain, worked out once per run.
+class EmailMatcher {
+public:
+    size_t match(const Text &t, size_t s) {
+        if (!t.boundary(s)) return npos;
+        if (s >= run_end_) {
+            run_end_ = s;
+            while (t.is(run_end_, kEmailLocal)) ++run_end_;
+            domain_end_ = domain(t, run_end_);
         }
+        return domain_end_;
     }
-    return mod == 1;
-}
 
-static std::string normalize_digits(const std::string &value) {
-    std::string out;
-    for (char c : value) {
-        if (std::isdigit(static_cast<unsigned char>(c))) out.push_back(c);
+private:
+    static size_t domain(const Text &t, size_t at) {
+        if (at >= t.size || t.data[at] != '@') return npos;
+        size_t run_end = at + 1;
+        while (t.is(run_end, kEmailDomain)) ++run_end;
+        // The greedy domain gives back characters until it is followed by a
+        // '.' and two or more letters ending on a word boundary.
+        for (size_t dot = run_end; dot-- > at + 2;) {
+            if (t.data[dot] != '.') continue;
+            size_t end = dot + 1;
+            while (t.is(end, kLetter)) ++end;
+            if (end - dot > 2 && t.boundary(end)) return end;
+        }
+        return npos;
     }
-    return out;
+
+    size_t run_end_ = 0;
+    size_t domain_end_ = npos;
+};
+
+// \b\+?[0-9][0-9()\-\.\s]{7,}[0-9]\b. The greedy body gives back characters
+// until a digit followed by a word boundary ends the match, so every start
+// in one body run ends at the same place: the run's last such digit.
+class PhoneMatcher {
+public:
+    size_t match(const Text &t, size_t s) {
+        if (!t.boundary(s)) return npos;
+        const size_t first = t.data[s] == '+' ? s + 1 : s;
+        if (!t.is(first, kDigit)) return npos;
+        if (first >= run_end_) {
+            run_end_ = first;
+            while (t.is(run_end_, kPhoneBody)) ++run_end_;
+            last_end_ = npos;
+            for (size_t end = run_end_; end > first + 1; --end) {
+                if (t.is(end - 1, kDigit) && t.boundary(end)) {
+                    last_end_ = end;
+                    break;
+                }
+            }
+        }
+        // A first digit, at least seven body characters, a last digit.
+        return last_end_ != npos && last_end_ >= first + 9 ? last_end_ : npos;
+    }
+
+private:
+    size_t run_end_ = 0;
+    size_t last_end_ = npos;
+};
+
+// \b[A-Z]{1,2}[0-9]{6,9}\b
+size_t match_passport(const Text &t, size_t s) {
+    if (!t.boundary(s)) return npos;
+    // A third capital leaves no digit after either letter count.
+    const size_t letters = t.is(s + 1, kUpper) ? 2 : 1;
+    const size_t digits = s + letters;
+    size_t end = digits;
+    while (end < digits + 10 && t.is(end, kDigit)) ++end;
+    if (end - digits < 6 || end - digits > 9) return npos;
+    return t.boundary(end) ? end : npos;
 }
 
-static void add_matches(const std::regex &pattern,
-                        const std::string &type,
-                        const std::string &text,
-                        std::vector<PiiDetection> &out) {
-    for (auto it = std::sregex_iterator(text.begin(), text.end(), pattern);
-         it != std::sregex_iterator(); ++it) {
-        PiiDetection det;
-        det.type = type;
-        det.value = it->str();
-        det.start = static_cast<size_t>(it->position());
-        det.end = det.start + it->length();
-        out.push_back(det);
+// \b[A-Z]{2}[0-9]{2}[A-Z0-9]{11,30}\b
+size_t match_iban(const Text &t, size_t s) {
+    if (!t.is(s + 1, kUpper) || !t.is(s + 2, kDigit) || !t.is(s + 3, kDigit) || !t.boundary(s)) return npos;
+    const size_t body = s + 4;
+    size_t end = body;
+    while (end < body + 31 && t.is(end, kIbanBody)) ++end;
+    if (end - body < 11 || end - body > 30) return npos;
+    return t.boundary(end) ? end : npos;
+}
+
+// (?:\d[ -]*?){13,19}\b after `digits` repetitions, the last digit just
+// before `p`. The group repeats greedily and the separators lazily: at every
+// step another digit is tried first, then ending the match, and only then
+// one more separator.
+size_t card_from(const Text &t, size_t p, int digits) {
+    for (size_t q = p;; ++q) {
+        if (digits < 19 && t.is(q, kDigit)) {
+            size_t end = card_from(t, q + 1, digits + 1);
+            if (end != npos) return end;
+        }
+        if (digits >= 13 && t.boundary(q)) return q;
+        if (!t.is(q, kCardSeparator)) return npos;
     }
 }
 
-std::vector<PiiDetection> detect_pii(const std::string &text,
-                                     const std::vector<std::string> &national_patterns) {
-    std::vector<PiiDetection> out;
-    if (text.empty()) return out;
-
-    std::regex email_re(R"((?i)\b[A-Z0-9._%+-]+@[A-Z0-9.-]+\.[A-Z]{2,}\b)");
-    add_matches(email_re, "email", text, out);
-
-    std::regex phone_re(R"(\b\+?[0-9][0-9()\-\.\s]{7,}[0-9]\b)");
-    add_matches(phone_re, "phone", text, out);
-
-    std::regex passport_re(R"(\b[A-Z]{1,2}[0-9]{6,9}\b)");
-    add_matches(passport_re, "passport", text, out);
-
-    std::regex iban_re(R"(\b[A-Z]{2}[0-9]{2}[A-Z0-9]{11,30}\b)");
-    for (auto it = std::sregex_iterator(text.begin(), text.end(), iban_re);
-         it != std::sregex_iterator(); ++it) {
-        PiiDetection det;
-        det.type = "iban";
-        det.value = it->str();
-        det.start = static_cast<size_t>(it->position());
-        det.end = det.start + it->length();
-        det.valid = iban_check(det.value);
-        out.push_back(det);
-    }
-
-    std::regex cc_re(R"(\b(?:\d[ -]*?){13,19}\b)");
-    for (auto it = std::sregex_iterator(text.begin(), text.end(), cc_re);
-         it != std::sregex_iterator(); ++it) {
-        PiiDetection det;
-        det.type = "credit_card";
-        det.value = it->str();
-        det.start = static_cast<size_t>(it->position());
-        det.end = det.start + it->length();
-        std::string digits = normalize_digits(det.value);
-        det.valid = digits.size() >= 13 && digits.size() <= 19 && luhn_check(digits);
-        out.push_back(det);
+// \b(?:\d[ -]*?){13,19}\b
+size_t match_card(const Text &t, size_t s) {
+    if (!t.boundary(s)) return npos;
+    return card_from(t, s + 1, 1);
+}
+
+// Built-in patterns in report order, with the bytes that can start a match.
+enum Builtin { kEmail, kPhone, kPassport, kIban, kCard, kBuiltinCount };
+const char *const kBuiltinTypes[kBuiltinCount] = {"email", "phone", "passport", "iban", "credit_card"};
+const uint16_t kBuiltinStart[kBuiltinCount] = {kEmailLocal, kPhoneStart, kUpper, kUpper, kDigit};
+
+}  // namespace
+
+// Card numbers are checked together in finish().
+static void validate(PiiDetection &det) {
+    if (det.type == "iban") {
+        det.valid = valid_iban(det.value);
+    } else if (det.type == "national_id") {
+        det.valid = valid_national_id(det.value);
     }
+}
 
+PiiPatterns::PiiPatterns(const std::vector<std::string> &national_patterns) {
     for (const auto &pattern : national_patterns) {
         if (pattern.empty()) continue;
         try {
-            std::regex national_re(pattern);
-            add_matches(national_re, "national_id", text, out);
+            national_.emplace_back(pattern);
         } catch (const std::regex_error &) {
             continue;
         }
+        in_set_.push_back(national_set_.add(pattern, static_cast<uint32_t>(national_.size() - 1)));
+    }
+    national_set_.build();
+}
+
+PiiStream::PiiStream(const PiiPatterns &patterns, size_t overlap, size_t max_per_type)
+    : patterns_in_(patterns), window_(overlap), max_per_type_(max_per_type) {
+    for (const char *type : kBuiltinTypes) {
+        patterns_.push_back({type, nullptr, {}, {}});
+    }
+    for (const auto &re : patterns.national_) {
+        patterns_.push_back({"national_id", &re, {}, {}});
     }
+}
+
+void PiiStream::feed(const char *data, size_t len) {
+    if (len == 0 || saturated()) return;
+    window_.append(data, len);
+    search(false);
+}
 
+std::vector<PiiDetection> PiiStream::finish() {
+    search(true);
+    std::vector<PiiDetection> &cards = patterns_[kCard].found;
+    if (!cards.empty()) {
+        std::vector<std::string_view> values;
+        values.reserve(cards.size());
+        for (const auto &card : cards) values.push_back(card.value);
+        std::unique_ptr<bool[]> valid(new bool[cards.size()]);
+        valid_card_numbers(values.data(), values.size(), valid.get());
+        for (size_t i = 0; i < cards.size(); ++i) cards[i].valid = valid[i];
+    }
+    std::vector<PiiDetection> out;
+    for (auto &pattern : patterns_) {
+        std::move(pattern.found.begin(), pattern.found.end(), std::back_inserter(out));
+        pattern.found.clear();
+    }
     return out;
 }
+
+uint64_t PiiStream::pending_offset() const {
+    return saturated() ? UINT64_MAX : window_.base();
+}
+
+bool PiiStream::saturated() const {
+    return std::all_of(patterns_.begin(), patterns_.end(),
+                       [this](const Pattern &pattern) { return pattern.found.size() >= max_per_type_; });
+}
+
+void PiiStream::report(Pattern &pattern, uint64_t start, std::string value) {
+    PiiDetection det;
+    det.type = pattern.type;
+    const uint64_t end = start + value.size();
+    det.start = static_cast<size_t>(map_ ? map_(start) : start);
+    det.end = static_cast<size_t>(map_ ? map_(end) : end);
+    det.value = std::move(value);
+    validate(det);
+    pattern.found.push_back(std::move(det));
+}
+
+// One pass over the window for all built-in types. An email's local part
+// runs up to an '@', and every other match has a digit in its first three
+// bytes, so only offsets near those anchors are tried, and the byte
+// classifier skips the text between them. Emails and the digit-anchored types each
+// try their offsets left to right, and a type tries only offsets its first
+// byte can start and its cursor has reached.
+void PiiStream::scan_builtin(bool final) {
+    if (!window_.ready(final)) return;
+    const std::string &data = window_.data();
+    const uint64_t base = window_.base();
+    // Every built-in match is at least one byte long.
+    const uint64_t stop = std::min(window_.limit(final) + 1, window_.end());
+    const Text text{data.data(), data.size(), final};
+    EmailMatcher email;
+    PhoneMatcher phone;
+
+    // Bytes that can start a match of a type still below its cap.
+    auto starts = [this] {
+        uint16_t mask = 0;
+        for (size_t b = 0; b < kBuiltinCount; ++b) {
+            if (patterns_[b].found.size() < max_per_type_) mask |= kBuiltinStart[b];
+        }
+        return mask;
+    };
+    uint16_t wanted = starts();
+    auto try_at = [&](uint64_t pos, size_t first, size_t last) {
+        const size_t i = static_cast<size_t>(pos - base);
+        const uint16_t cls = kClasses.bits[static_cast<unsigned char>(data[i])];
+        if ((cls & wanted) == 0) return;
+        for (size_t b = first; b < last; ++b) {
+            Pattern &pattern = patterns_[b];
+            if ((cls & kBuiltinStart[b]) == 0 || pos < pattern.cursor.resume) continue;
+            if (pattern.found.size() >= max_per_type_) continue;
+            size_t end = npos;
+            switch (b) {
+                case kEmail: end = email.match(text, i); break;
+                case kPhone: end = phone.match(text, i); break;
+                case kPassport: end = match_passport(text, i); break;
+                case kIban: end = match_iban(text, i); break;
+                case kCard: end = match_card(text, i); break;
+            }
+            if (end == npos) continue;
+            report(pattern, pos, data.substr(i, end - i));
+            pattern.cursor.resume = base + end;
+            if (pattern.found.size() >= max_per_type_) wanted = starts();
+        }
+    };
+
+    uint64_t from = stop;
+    for (size_t b = 0; b < kBuiltinCount; ++b) {
+        if (patterns_[b].found.size() < max_per_type_) from = std::min(from, patterns_[b].cursor.resume);
+    }
+    // Offsets before these have been tried, or cannot start a match.
+    uint64_t email_next = from;
+    uint64_t digit_next = from;
+    // Anchors past `stop` still count: a start just before it can have its
+    // digit two bytes later, or its '@' anywhere in the overlap.
+    const uint64_t anchors_end = window_.end();
+    for (uint64_t block = from; wanted != 0 && block < anchors_end; block += 32) {
+        const size_t i = static_cast<size_t>(block - base);
+        ByteMasks masks;
+        block += find_anchor_block(data.data() + i, static_cast<size_t>(anchors_end - block), masks);
+        for (uint32_t anchors = masks.digit | masks.at; anchors != 0; anchors &= anchors - 1) {
+            const unsigned bit = static_cast<unsigned>(__builtin_ctz(anchors));
+            const uint64_t pos = block + bit;
+            if (masks.digit >> bit & 1) {
+                digit_next = std::max(digit_next, pos < 2 ? 0 : pos - 2);
+                for (; digit_next <= pos && digit_next < stop; ++digit_next) try_at(digit_next, kPhone, kBuiltinCount);
+            } else {
+                // '@' is not a local-part byte, so runs never reach back past
+                // the previous '@'.
+                uint64_t run = pos;
+                while (run > email_next && text.is(static_cast<size_t>(run - 1 - base), kEmailLocal)) --run;
+                for (; run < pos && run < stop; ++run) try_at(run, kEmail, kPhone);
+                email_next = pos + 1;
+            }
+        }
+    }
+    for (size_t b = 0; b < kBuiltinCount; ++b) {
+        window_.skip(patterns_[b].cursor, final);
+    }
+}
+
+void PiiStream::search(bool final) {
+    scan_builtin(final);
+    if (patterns_.size() == kBuiltinCount || !window_.ready(final)) return;
+    candidates_.clear();
+    patterns_in_.national_set_.match(window_.data().data(), window_.data().size(), candidates_);
+    size_t next = 0;
+    for (size_t p = kBuiltinCount; p < patterns_.size(); ++p) {
+        Pattern &pattern = patterns_[p];
+        const size_t national = p - kBuiltinCount;
+        bool unmatched = false;
+        if (patterns_in_.in_set_[national]) {
+            while (next < candidates_.size() && candidates_[next] < national) ++next;
+            unmatched = next == candidates_.size() || candidates_[next] != national;
+        }
+        if (unmatched || pattern.found.size() >= max_per_type_) {
+            window_.skip(pattern.cursor, final);
+            continue;
+        }
+        window_.search(*pattern.re, pattern.cursor, final, [&](const std::smatch &m, uint64_t start) {
+            report(pattern, start, m.str());
+            return pattern.found.size() < max_per_type_;
+        });
+    }
+}
+
+std::vector<PiiDetection> detect_pii(const std::string &text, const PiiPatterns &patterns, size_t max_per_type) {
+    if (text.empty()) return {};
+    // An overlap past the end defers every match to finish(): one pass.
+    PiiStream stream(patterns, text.size() + 1, max_per_type);
+    stream.feed(text.data(), text.size());
+    return stream.finish();
+}
+
+std::vector<PiiDetection> detect_pii(const std::string &text,
+                                     const std::vector<std::string> &national_patterns) {
+    if (text.empty()) return {};
+    return detect_pii(text, PiiPatterns(national_patterns));
+}
@@ -1,7 +1,14 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <regex>
 #include <string>
 #include <vector>
 
+#include "regex_set.h"
+#include "stream_window.h"
+
 struct PiiDetection {
     std::string type;
     std::string value;
@@ -10,5 +17,67 @@ struct PiiDetection {
     bool valid = true;
 };
 
+// Detection patterns, compiled once per configuration. The built-in types
+// (email, phone, passport, IBAN, credit card) are found by a hand-written
+// single-pass scanner that reports exactly what their regular expressions
+// would; configured national-ID patterns stay std::regex, behind a RegexSet
+// prefilter that skips text none of them match. Patterns that do not compile
+// are skipped.
+class PiiPatterns {
+public:
+    explicit PiiPatterns(const std::vector<std::string> &national_patterns);
+
+private:
+    friend class PiiStream;
+    std::vector<std::regex> national_;
+    // Patterns the set could not take are always searched.
+    std::vector<bool> in_set_;
+    RegexSet national_set_;
+};
+
+// At most `max_per_type` detections of each type, the first ones in the text.
+std::vector<PiiDetection> detect_pii(const std::string &text, const PiiPatterns &patterns,
+                                     size_t max_per_type = SIZE_MAX);
+// Compiles `national_patterns` for this one call.
 std::vector<PiiDetection> detect_pii(const std::string &text,
                                      const std::vector<std::string> &national_patterns);
+
+// detect_pii over text fed in chunks, with memory bounded by one chunk plus
+// `overlap` bytes and at most `max_per_type` detections of each type. Offsets
+// are stream offsets; a detection shorter than `overlap` is found wherever
+// the chunk boundaries fall. finish() lists detections as detect_pii does.
+// A type stops searching at its cap, and once every type is full the rest
+// of the stream is ignored. `patterns` must outlive the stream.
+class PiiStream {
+public:
+    PiiStream(const PiiPatterns &patterns, size_t overlap, size_t max_per_type = SIZE_MAX);
+
+    // Translates the start and end of each detection as it is found, e.g.
+    // from normalized text back to file offsets.
+    void map_offsets(std::function<uint64_t(uint64_t)> map) { map_ = std::move(map); }
+    void feed(const char *data, size_t len);
+    std::vector<PiiDetection> finish();
+    // Stream offset below which no detection will be found any more.
+    uint64_t pending_offset() const;
+
+private:
+    // One detection type; `re` is null for the built-in types.
+    struct Pattern {
+        std::string type;
+        const std::regex *re;
+        StreamWindow::Cursor cursor;
+        std::vector<PiiDetection> found;
+    };
+
+    bool saturated() const;
+    void search(bool final);
+    void scan_builtin(bool final);
+    void report(Pattern &pattern, uint64_t start, std::string value);
+
+    const PiiPatterns &patterns_in_;
+    StreamWindow window_;
+    size_t max_per_type_;
+    std::vector<Pattern> patterns_;
+    std::vector<uint32_t> candidates_;
+    std::function<uint64_t(uint64_t)> map_;
+};
@@ -0,0 +1,164 @@
+#include "pii_validators.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+bool is_upper(char c) { return c >= 'A' && c <= 'Z'; }
+
+// Card numbers in one batch are checked kLanes at a time: digit j (from the
+// right) of every lane sits in one row, so each Luhn step is a loop over
+// lanes with no branches.
+constexpr size_t kLanes = 16;
+constexpr size_t kMaxCardDigits = 19;
+constexpr size_t kMinCardDigits = 13;
+
+// Writes the digits of `value`, rightmost first, into column `lane` and
+// returns how many there were, or 0 when the format is wrong.
+size_t load_card_digits(std::string_view value, uint8_t (&digits)[kMaxCardDigits][kLanes], size_t lane) {
+    size_t count = 0;
+    bool after_digit = false;
+    for (size_t i = value.size(); i-- > 0;) {
+        const char c = value[i];
+        if (is_digit(c)) {
+            if (count == kMaxCardDigits) return 0;
+            digits[count++][lane] = static_cast<uint8_t>(c - '0');
+            after_digit = true;
+        } else if ((c == ' ' || c == '-') && after_digit) {
+            after_digit = false;
+        } else {
+            return 0;
+        }
+    }
+    return after_digit ? count : 0;
+}
+
+// Registered IBAN countries and lengths (SWIFT IBAN registry).
+struct IbanCountry {
+    char code[3];
+    uint8_t length;
+};
+
+const IbanCountry kIbanCountries[] = {
+    {"AD", 24}, {"AE", 23}, {"AL", 28}, {"AT", 20}, {"AZ", 28}, {"BA", 20}, {"BE", 16}, {"BG", 22}, {"BH", 22},
+    {"BI", 27}, {"BR", 29}, {"BY", 28}, {"CH", 21}, {"CR", 22}, {"CY", 28}, {"CZ", 24}, {"DE", 22}, {"DJ", 27},
+    {"DK", 18}, {"DO", 28}, {"EE", 20}, {"EG", 29}, {"ES", 24}, {"FI", 18}, {"FK", 18}, {"FO", 18}, {"FR", 27},
+    {"GB", 22}, {"GE", 22}, {"GI", 23}, {"GL", 18}, {"GR", 27}, {"GT", 28}, {"HN", 28}, {"HR", 21}, {"HU", 28},
+    {"IE", 22}, {"IL", 23}, {"IQ", 23}, {"IS", 26}, {"IT", 27}, {"JO", 30}, {"KW", 30}, {"KZ", 20}, {"LB", 28},
+    {"LC", 32}, {"LI", 21}, {"LT", 20}, {"LU", 20}, {"LV", 21}, {"LY", 25}, {"MC", 27}, {"MD", 24}, {"ME", 22},
+    {"MK", 19}, {"MN", 20}, {"MR", 27}, {"MT", 31}, {"MU", 30}, {"NI", 28}, {"NL", 18}, {"NO", 15}, {"OM", 23},
+    {"PK", 24}, {"PL", 28}, {"PS", 29}, {"PT", 25}, {"QA", 29}, {"RO", 24}, {"RS", 22}, {"RU", 33}, {"SA", 24},
+    {"SC", 31}, {"SD", 18}, {"SE", 24}, {"SI", 19}, {"SK", 24}, {"SM", 27}, {"SO", 23}, {"ST", 25}, {"SV", 28},
+    {"TL", 23}, {"TN", 24}, {"TR", 26}, {"UA", 29}, {"VA", 22}, {"VG", 24}, {"XK", 20}, {"YE", 30},
+};
+
+// Lengths indexed by the two letters of the country code.
+struct IbanLengths {
+    uint8_t by_code[26 * 26] = {};
+    IbanLengths() {
+        for (const auto &country : kIbanCountries) {
+            by_code[(country.code[0] - 'A') * 26 + (country.code[1] - 'A')] = country.length;
+        }
+    }
+};
+
+const IbanLengths kIbanLengths;
+
+// Folds one IBAN character into a running mod 97: digits as themselves,
+// letters as 10 to 35.
+int mod97_step(int mod, char c) {
+    if (is_digit(c)) return (mod * 10 + (c - '0')) % 97;
+    return (mod * 100 + (c - 'A' + 10)) % 97;
+}
+
+// Parses exactly `len` digits at `at`, or returns -1.
+int parse_digits(std::string_view value, size_t at, size_t len) {
+    int n = 0;
+    for (size_t i = at; i < at + len; ++i) {
+        if (!is_digit(value[i])) return -1;
+        n = n * 10 + (value[i] - '0');
+    }
+    return n;
+}
+
+}  // namespace
+
+void valid_card_numbers(const std::string_view *values, size_t count, bool *out) {
+    for (size_t first = 0; first < count; first += kLanes) {
+        const size_t lanes = std::min(kLanes, count - first);
+        // Rows past a value's length stay zero, which Luhn ignores.
+        uint8_t digits[kMaxCardDigits][kLanes] = {};
+        size_t lengths[kLanes] = {};
+        for (size_t k = 0; k < lanes; ++k) lengths[k] = load_card_digits(values[first + k], digits, k);
+        uint32_t sums[kLanes] = {};
+        for (size_t j = 0; j < kMaxCardDigits; j += 2) {
+            for (size_t k = 0; k < kLanes; ++k) sums[k] += digits[j][k];
+        }
+        for (size_t j = 1; j < kMaxCardDigits; j += 2) {
+            for (size_t k = 0; k < kLanes; ++k) {
+                const uint32_t doubled = digits[j][k] * 2u;
+                sums[k] += doubled > 9 ? doubled - 9 : doubled;
+            }
+        }
+        for (size_t k = 0; k < lanes; ++k) {
+            out[first + k] = lengths[k] >= kMinCardDigits && sums[k] % 10 == 0;
+        }
+    }
+}
+
+bool valid_card_number(std::string_view value) {
+    size_t count = 0;
+    uint32_t sum = 0;
+    bool after_digit = false;
+    for (size_t i = value.size(); i-- > 0;) {
+        const char c = value[i];
+        if (is_digit(c)) {
+            if (count == kMaxCardDigits) return false;
+            const uint32_t digit = static_cast<uint32_t>(c - '0') << (count++ & 1);
+            sum += digit > 9 ? digit - 9 : digit;
+            after_digit = true;
+        } else if ((c == ' ' || c == '-') && after_digit) {
+            after_digit = false;
+        } else {
+            return false;
+        }
+    }
+    return after_digit && count >= kMinCardDigits && sum % 10 == 0;
+}
+
+size_t iban_length(std::string_view country) {
+    if (country.size() != 2 || !is_upper(country[0]) || !is_upper(country[1])) return 0;
+    return kIbanLengths.by_code[(country[0] - 'A') * 26 + (country[1] - 'A')];
+}
+
+bool valid_iban(std::string_view value) {
+    if (value.size() < 4 || value.size() != iban_length(value.substr(0, 2))) return false;
+    if (!is_digit(value[2]) || !is_digit(value[3])) return false;
+    // The check runs over the BBAN followed by the first four characters.
+    int mod = 0;
+    for (size_t i = 4; i < value.size(); ++i) {
+        if (!is_digit(value[i]) && !is_upper(value[i])) return false;
+        mod = mod97_step(mod, value[i]);
+    }
+    for (size_t i = 0; i < 4; ++i) mod = mod97_step(mod, value[i]);
+    return mod == 1;
+}
+
+bool valid_ssn(std::string_view value) {
+    if (value.size() != 11 || value[3] != value[6] || (value[3] != '-' && value[3] != ' ')) return false;
+    const int area = parse_digits(value, 0, 3);
+    const int group = parse_digits(value, 4, 2);
+    const int serial = parse_digits(value, 7, 4);
+    if (area < 0 || group < 0 || serial < 0) return false;
+    return area != 0 && area != 666 && area < 900 && group != 0 && serial != 0;
+}
+
+bool valid_national_id(std::string_view value) {
+    // AAA-GG-SSSS, the shape of the default national-ID pattern.
+    const bool ssn_shape = value.size() == 11 && (value[3] == '-' || value[3] == ' ') && value[6] == value[3] &&
+                           parse_digits(value, 0, 3) >= 0 && parse_digits(value, 4, 2) >= 0 &&
+                           parse_digits(value, 7, 4) >= 0;
+    if (ssn_shape) return valid_ssn(value);
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// Format and checksum validators for PII candidates. They read values in
+// place and never allocate.
+
+// 13 to 19 digits, single spaces or hyphens allowed between them, passing
+// the Luhn check.
+bool valid_card_number(std::string_view value);
+// valid_card_number for each of `count` values into out[i], checked side by
+// side so the compiler can vectorise the Luhn sums.
+void valid_card_numbers(const std::string_view *values, size_t count, bool *out);
+
+// IBAN length for an upper-case ISO country code, 0 when the country does
+// not issue IBANs.
+size_t iban_length(std::string_view country);
+// Country code, that country's length, upper-case letters and digits only,
+// and the ISO 7064 mod 97-10 check.
+bool valid_iban(std::string_view value);
+
+// US SSN, AAA-GG-SSSS: area not 000, 666 or 900-999; group not 00; serial
+// not 0000.
+bool valid_ssn(std::string_view value);
+// Checks a configured national-ID match with the validator for its format;
+// formats without a validator are accepted.
+bool valid_national_id(std::string_view value);
@@ -0,0 +1,711 @@
+#include "policy_image.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+
+#include "config.h"
+#include "fnv1a.h"
+#include "mapped_file.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'L', 'P', 'P', 'O', 'L', 'I', 'M'};
+// Written in native order; an image from a machine of the other byte order
+// reads back as 0x04030201 and is rejected.
+constexpr uint32_t kByteOrderMark = 0x01020304u;
+
+enum Section : uint32_t {
+    kStrings,
+    kRules,
+    kRuleLists,
+    kConditions,
+    kActions,
+    kLoadErrors,
+    kPacks,
+    kKeywordMeta,
+    kKeywordDense,
+    kKeywordEdgeOffset,
+    kKeywordEdgeLabel,
+    kKeywordEdgeTarget,
+    kKeywordFail,
+    kKeywordPattern,
+    kKeywordOutput,
+    kKeywordOwnerOffset,
+    kKeywordOwners,
+    kContentKeywordRank,
+    kContentKeywords,
+    kHashMeta,
+    kHashSlots,
+    kHashValues,
+    kEvalOrder,
+    kRank,
+    kRankSeverityBound,
+    kConditionRules,
+    kAliasOffset,
+    kAlias,
+    kRegexStates,
+    kRegexCharsets,
+    kRegexStarts,
+    kRegexIds,
+    kRegexByteClass,
+    kRegexClassRep,
+    kSectionCount
+};
+
+// File layout: ImageHeader, then sections (SectionHeader + data, padded to 8
+// bytes) in any order. The checksum covers everything after the header.
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_key;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+struct SectionHeader {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t bytes;
+};
+
+// A string in the kStrings section.
+struct StrRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct RuleRecord {
+    StrRef id;
+    StrRef name;
+    StrRef type;
+    StrRef pattern;
+    int32_t priority;
+    int32_t severity;
+    uint32_t enabled;
+    // Keywords, then hashes, as consecutive kRuleLists entries.
+    uint32_t list_begin;
+    uint32_t keyword_count;
+    uint32_t hash_count;
+    uint32_t condition_begin;
+    uint32_t condition_count;
+    uint32_t action_begin;
+    uint32_t action_count;
+};
+
+// The source condition and the predicate compiled from it.
+struct ConditionRecord {
+    StrRef field;
+    StrRef op;
+    StrRef value;
+    StrRef compiled_value;
+    uint8_t compiled_field;
+    uint8_t compiled_op;
+    uint8_t flag;
+    uint8_t reserved;
+};
+
+struct PackRecord {
+    StrRef path;
+    uint32_t present;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t hash;
+};
+
+struct KeywordMeta {
+    uint64_t patterns;
+    uint64_t dense_states;
+};
+
+struct HashMeta {
+    uint64_t mask;
+    uint64_t count;
+};
+
+// Corruption check, not a signature: four FNV-style lanes over 8-byte words
+// so verifying a large image runs near memory speed.
+uint64_t image_checksum(const unsigned char *data, size_t len) {
+    uint64_t lanes[4] = {1469598103934665603ull, 1469598103934665603ull ^ 1,
+                         1469598103934665603ull ^ 2, 1469598103934665603ull ^ 3};
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        for (size_t l = 0; l < 4; ++l) {
+            uint64_t word;
+            std::memcpy(&word, data + i + l * 8, sizeof(word));
+            lanes[l] = (lanes[l] ^ word) * 1099511628211ull;
+            lanes[l] ^= lanes[l] >> 32;
+        }
+    }
+    return fnv1a64(data + i, len - i, fnv1a64(lanes, sizeof(lanes)));
+}
+
+bool fail(std::string *error, const std::string &message) {
+    if (error) *error = message;
+    return false;
+}
+
+class ImageWriter {
+public:
+    StrRef intern(const std::string &text) {
+        auto it = interned_.find(text);
+        if (it != interned_.end()) return it->second;
+        StrRef ref{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(text.size())};
+        strings_ += text;
+        interned_.emplace(text, ref);
+        return ref;
+    }
+
+    std::vector<StrRef> intern_all(const std::vector<std::string> &texts) {
+        std::vector<StrRef> refs;
+        refs.reserve(texts.size());
+        for (const auto &text : texts) refs.push_back(intern(text));
+        return refs;
+    }
+
+    template <typename T>
+    void section(Section id, const T *data, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "image sections hold plain data");
+        SectionHeader header{id, static_cast<uint32_t>(sizeof(T)), count * sizeof(T)};
+        append(&header, sizeof(header));
+        append(data, header.bytes);
+        payload_.append((8 - payload_.size() % 8) % 8, '\0');
+    }
+
+    template <typename T>
+    void section(Section id, const std::vector<T> &items) {
+        section(id, items.data(), items.size());
+    }
+
+    // Returns false when the string table outgrew 32-bit offsets.
+    bool finish(uint64_t source_key, std::string &image) {
+        if (strings_.size() > 0xFFFFFFFFull) return false;
+        section(kStrings, strings_.data(), strings_.size());
+        ImageHeader header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = PolicyImage::kFormatVersion;
+        header.byte_order = kByteOrderMark;
+        header.source_key = source_key;
+        header.payload_size = payload_.size();
+        header.checksum = image_checksum(reinterpret_cast<const unsigned char *>(payload_.data()),
+                                         payload_.size());
+        image.assign(reinterpret_cast<const char *>(&header), sizeof(header));
+        image += payload_;
+        return true;
+    }
+
+private:
+    void append(const void *data, size_t len) {
+        if (len) payload_.append(static_cast<const char *>(data), len);
+    }
+
+    std::string strings_;
+    std::unordered_map<std::string, StrRef> interned_;
+    std::string payload_;
+};
+
+class ImageReader {
+public:
+    bool open(const MappedFile &file, uint64_t source_key, std::string &error) {
+        if (file.size() < sizeof(ImageHeader)) {
+            error = "truncated header";
+            return false;
+        }
+        ImageHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+            error = "not a policy image";
+            return false;
+        }
+        if (header.version != PolicyImage::kFormatVersion) {
+            error = "format version " + std::to_string(header.version);
+            return false;
+        }
+        if (header.byte_order != kByteOrderMark) {
+            error = "foreign byte order";
+            return false;
+        }
+        if (header.payload_size != file.size() - sizeof(header)) {
+            error = "truncated payload";
+            return false;
+        }
+        if (header.source_key != source_key) {
+            error = "built from a different policy";
+            return false;
+        }
+        const unsigned char *payload = file.data() + sizeof(header);
+        const size_t size = static_cast<size_t>(header.payload_size);
+        if (image_checksum(payload, size) != header.checksum) {
+            error = "checksum mismatch";
+            return false;
+        }
+        size_t offset = 0;
+        while (offset < size) {
+            SectionHeader section;
+            if (size - offset < sizeof(section)) {
+                error = "corrupt section table";
+                return false;
+            }
+            std::memcpy(&section, payload + offset, sizeof(section));
+            offset += sizeof(section);
+            if (section.bytes > size - offset) {
+                error = "corrupt section table";
+                return false;
+            }
+            if (section.id < kSectionCount) {
+                sections_[section.id] = View{payload + offset, section.bytes, section.element_size, true};
+            }
+            offset += static_cast<size_t>(section.bytes);
+            offset += std::min<size_t>((8 - offset % 8) % 8, size - offset);
+        }
+        if (!sections_[kStrings].present) {
+            error = "missing string table";
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool read(Section id, std::vector<T> &out) const {
+        const View &view = sections_[id];
+        if (!view.present || view.element_size != sizeof(T)) return false;
+        out.resize(static_cast<size_t>(view.bytes / sizeof(T)));
+        if (!out.empty()) std::memcpy(out.data(), view.data, out.size() * sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    bool read_one(Section id, T &out) const {
+        std::vector<T> items;
+        if (!read(id, items) || items.size() != 1) return false;
+        out = items[0];
+        return true;
+    }
+
+    bool text(StrRef ref, std::string &out) const {
+        const View &strings = sections_[kStrings];
+        if (static_cast<uint64_t>(ref.offset) + ref.length > strings.bytes) return false;
+        out.assign(reinterpret_cast<const char *>(strings.data) + ref.offset, ref.length);
+        return true;
+    }
+
+    bool texts(Section id, std::vector<std::string> &out) const {
+        std::vector<StrRef> refs;
+        if (!read(id, refs)) return false;
+        out.resize(refs.size());
+        for (size_t i = 0; i < refs.size(); ++i) {
+            if (!text(refs[i], out[i])) return false;
+        }
+        return true;
+    }
+
+private:
+    struct View {
+        const unsigned char *data = nullptr;
+        uint64_t bytes = 0;
+        uint32_t element_size = 0;
+        bool present = false;
+    };
+    std::array<View, kSectionCount> sections_{};
+};
+
+void write_rules(ImageWriter &writer, const std::vector<Rule> &rules,
+                 const std::vector<CompiledRule> &compiled) {
+    std::vector<RuleRecord> records;
+    std::vector<StrRef> lists;
+    std::vector<ConditionRecord> conditions;
+    std::vector<uint8_t> actions;
+    records.reserve(rules.size());
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const Rule &rule = rules[i];
+        RuleRecord record{};
+        record.id = writer.intern(rule.id);
+        record.name = writer.intern(rule.name);
+        record.type = writer.intern(rule.type);
+        record.pattern = writer.intern(rule.pattern);
+        record.priority = rule.priority;
+        record.severity = rule.severity;
+        record.enabled = rule.enabled ? 1 : 0;
+        record.list_begin = static_cast<uint32_t>(lists.size());
+        record.keyword_count = static_cast<uint32_t>(rule.keywords.size());
+        record.hash_count = static_cast<uint32_t>(rule.hashes.size());
+        for (const auto &keyword : rule.keywords) lists.push_back(writer.intern(keyword));
+        for (const auto &hash : rule.hashes) lists.push_back(writer.intern(hash));
+        record.condition_begin = static_cast<uint32_t>(conditions.size());
+        record.condition_count = static_cast<uint32_t>(rule.conditions.size());
+        for (size_t c = 0; c < rule.conditions.size(); ++c) {
+            const CompiledCondition &predicate = compiled[i].conditions[c];
+            ConditionRecord condition{};
+            condition.field = writer.intern(rule.conditions[c].field);
+            condition.op = writer.intern(rule.conditions[c].op);
+            condition.value = writer.intern(rule.conditions[c].value);
+            condition.compiled_value = writer.intern(predicate.value);
+            condition.compiled_field = static_cast<uint8_t>(predicate.field);
+            condition.compiled_op = static_cast<uint8_t>(predicate.op);
+            condition.flag = predicate.flag ? 1 : 0;
+            conditions.push_back(condition);
+        }
+        record.action_begin = static_cast<uint32_t>(actions.size());
+        record.action_count = static_cast<uint32_t>(rule.actions.size());
+        for (RuleAction action : rule.actions) actions.push_back(static_cast<uint8_t>(action));
+        records.push_back(record);
+    }
+    writer.section(kRules, records);
+    writer.section(kRuleLists, lists);
+    writer.section(kConditions, conditions);
+    writer.section(kActions, actions);
+}
+
+bool read_rules(const ImageReader &reader, std::vector<Rule> &rules,
+                std::vector<CompiledRule> &compiled) {
+    std::vector<RuleRecord> records;
+    std::vector<StrRef> lists;
+    std::vector<ConditionRecord> conditions;
+    std::vector<uint8_t> actions;
+    if (!reader.read(kRules, records) || !reader.read(kRuleLists, lists) ||
+        !reader.read(kConditions, conditions) || !reader.read(kActions, actions)) {
+        return false;
+    }
+    rules.assign(records.size(), Rule{});
+    compiled.assign(records.size(), CompiledRule{});
+    for (size_t i = 0; i < records.size(); ++i) {
+        const RuleRecord &record = records[i];
+        Rule &rule = rules[i];
+        if (!reader.text(record.id, rule.id) || !reader.text(record.name, rule.name) ||
+            !reader.text(record.type, rule.type) || !reader.text(record.pattern, rule.pattern)) {
+            return false;
+        }
+        rule.priority = record.priority;
+        rule.severity = record.severity;
+        rule.enabled = record.enabled != 0;
+
+        uint64_t list_end = static_cast<uint64_t>(record.list_begin) + record.keyword_count + record.hash_count;
+        if (list_end > lists.size()) return false;
+        rule.keywords.resize(record.keyword_count);
+        for (uint32_t k = 0; k < record.keyword_count; ++k) {
+            if (!reader.text(lists[record.list_begin + k], rule.keywords[k])) return false;
+        }
+        rule.hashes.resize(record.hash_count);
+        for (uint32_t h = 0; h < record.hash_count; ++h) {
+            if (!reader.text(lists[record.list_begin + record.keyword_count + h], rule.hashes[h])) return false;
+        }
+
+        if (static_cast<uint64_t>(record.condition_begin) + record.condition_count > conditions.size()) {
+            return false;
+        }
+        rule.conditions.resize(record.condition_count);
+        compiled[i].conditions.resize(record.condition_count);
+        for (uint32_t c = 0; c < record.condition_count; ++c) {
+            const ConditionRecord &condition = conditions[record.condition_begin + c];
+            RuleCondition &source = rule.conditions[c];
+            CompiledCondition &predicate = compiled[i].conditions[c];
+            if (!reader.text(condition.field, source.field) || !reader.text(condition.op, source.op) ||
+                !reader.text(condition.value, source.value) ||
+                !reader.text(condition.compiled_value, predicate.value)) {
+                return false;
+            }
+            if (condition.compiled_field > static_cast<uint8_t>(ConditionField::FingerprintMatched) ||
+                condition.compiled_op > static_cast<uint8_t>(ConditionOp::EndsWith)) {
+                return false;
+            }
+            predicate.field = static_cast<ConditionField>(condition.compiled_field);
+            predicate.op = static_cast<ConditionOp>(condition.compiled_op);
+            predicate.flag = condition.flag != 0;
+        }
+
+        if (static_cast<uint64_t>(record.action_begin) + record.action_count > actions.size()) return false;
+        rule.actions.resize(record.action_count);
+        for (uint32_t a = 0; a < record.action_count; ++a) {
+            uint8_t action = actions[record.action_begin + a];
+            if (action > static_cast<uint8_t>(RuleAction::ShadowCopy)) return false;
+            rule.actions[a] = static_cast<RuleAction>(action);
+        }
+    }
+    return true;
+}
+
+bool pack_unchanged(const PolicyPackSource &pack) {
+    std::ifstream in(pack.path, std::ios::binary);
+    if (!in) return !pack.present;
+    if (!pack.present) return false;
+    std::string body((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return body.size() == pack.size && fnv1a64(body.data(), body.size()) == pack.hash;
+}
+
+}  // namespace
+
+uint64_t PolicyImage::source_key(const std::string &body, const std::vector<Rule> &defaults) {
+    uint64_t key = fnv1a64(&kFormatVersion, sizeof(kFormatVersion));
+    // Length-prefixed so adjacent fields cannot run into each other.
+    auto mix = [&key](const std::string &text) {
+        uint64_t length = text.size();
+        key = fnv1a64(&length, sizeof(length), key);
+        key = fnv1a64(text.data(), text.size(), key);
+    };
+    auto mix_list = [&mix](const std::vector<std::string> &texts) {
+        mix(std::to_string(texts.size()));
+        for (const auto &text : texts) mix(text);
+    };
+    mix(body);
+    mix(g_rules_path);
+    mix_list(g_content_keywords);
+    mix(std::to_string(defaults.size()));
+    for (const auto &rule : defaults) {
+        mix(rule.id);
+        mix(rule.name);
+        mix(rule.type);
+        mix(rule.pattern);
+        mix(std::to_string(rule.priority) + "/" + std::to_string(rule.severity) + "/" +
+            (rule.enabled ? "1" : "0"));
+        mix_list(rule.keywords);
+        mix_list(rule.hashes);
+        mix(std::to_string(rule.conditions.size()));
+        for (const auto &condition : rule.conditions) {
+            mix(condition.field);
+            mix(condition.op);
+            mix(condition.value);
+        }
+        std::string actions;
+        for (RuleAction action : rule.actions) actions += static_cast<char>('0' + static_cast<int>(action));
+        mix(actions);
+    }
+    return key;
+}
+
+bool PolicyImage::save(const RuleEngine &engine, const std::string &path, uint64_t source_key,
+                       std::string *error) {
+    ImageWriter writer;
+    write_rules(writer, engine.rules_, engine.compiled_);
+    writer.section(kLoadErrors, writer.intern_all(engine.load_errors_));
+    std::vector<PackRecord> packs;
+    for (const auto &pack : engine.pack_sources_) {
+        packs.push_back(PackRecord{writer.intern(pack.path), pack.present ? 1u : 0u, 0, pack.size, pack.hash});
+    }
+    writer.section(kPacks, packs);
+
+    const KeywordMatcher &keywords = engine.keywords_;
+    KeywordMeta keyword_meta{keywords.patterns_, keywords.dense_states_};
+    writer.section(kKeywordMeta, &keyword_meta, 1);
+    writer.section(kKeywordDense, keywords.dense_);
+    writer.section(kKeywordEdgeOffset, keywords.edge_offset_);
+    writer.section(kKeywordEdgeLabel, keywords.edge_label_);
+    writer.section(kKeywordEdgeTarget, keywords.edge_target_);
+    writer.section(kKeywordFail, keywords.fail_);
+    writer.section(kKeywordPattern, keywords.pattern_);
+    writer.section(kKeywordOutput, keywords.output_);
+    writer.section(kKeywordOwnerOffset, engine.keyword_owner_offset_);
+    std::vector<uint32_t> owners;
+    owners.reserve(engine.keyword_owners_.size() * 2);
+    for (const auto &owner : engine.keyword_owners_) {
+        owners.push_back(owner.first);
+        owners.push_back(owner.second);
+    }
+    writer.section(kKeywordOwners, owners);
+    writer.section(kContentKeywordRank, engine.content_keyword_rank_);
+    writer.section(kContentKeywords, writer.intern_all(engine.content_keywords_));
+
+    const HashIndex &hashes = engine.hashes_;
+    HashMeta hash_meta{hashes.mask_, hashes.count_};
+    writer.section(kHashMeta, &hash_meta, 1);
+    writer.section(kHashSlots, hashes.slots_);
+    writer.section(kHashValues, hashes.values_);
+
+    writer.section(kEvalOrder, engine.eval_order_);
+    writer.section(kRank, engine.rank_);
+    writer.section(kRankSeverityBound, engine.rank_severity_bound_);
+    writer.section(kConditionRules, engine.condition_rules_);
+    writer.section(kAliasOffset, engine.alias_offset_);
+    writer.section(kAlias, engine.alias_);
+
+    const RegexSet &regexes = engine.regex_set_;
+    writer.section(kRegexStates, regexes.states_);
+    writer.section(kRegexCharsets, regexes.charsets_);
+    writer.section(kRegexStarts, regexes.starts_);
+    writer.section(kRegexIds, regexes.ids_);
+    writer.section(kRegexByteClass, regexes.byte_class_, 256);
+    writer.section(kRegexClassRep, regexes.class_rep_);
+
+    std::string image;
+    if (!writer.finish(source_key, image)) return fail(error, "string table too large");
+
+    // Written beside the target and renamed over it, so a crash mid-write
+    // never leaves a torn image behind.
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        out.close();
+        if (!out) return fail(error, "cannot write " + temp);
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        std::filesystem::remove(temp, ignored);
+        return fail(error, "cannot replace " + path + ": " + ec.message());
+    }
+    return true;
+}
+
+bool PolicyImage::load(RuleEngine &engine, const std::string &path, uint64_t source_key,
+                       std::string *error) {
+    MappedFile file;
+    if (!file.open(path)) return fail(error, "cannot map " + path);
+    ImageReader reader;
+    std::string message;
+    if (!reader.open(file, source_key, message)) return fail(error, path + ": " + message);
+
+    const std::string corrupt = path + ": corrupt ";
+    RuleEngine staged;
+    if (!read_rules(reader, staged.rules_, staged.compiled_)) return fail(error, corrupt + "rule table");
+    const size_t rule_count = staged.rules_.size();
+
+    std::vector<PackRecord> packs;
+    if (!reader.texts(kLoadErrors, staged.load_errors_) || !reader.read(kPacks, packs)) {
+        return fail(error, corrupt + "load metadata");
+    }
+    for (const auto &record : packs) {
+        PolicyPackSource pack;
+        if (!reader.text(record.path, pack.path)) return fail(error, corrupt + "pack table");
+        pack.present = record.present != 0;
+        pack.size = record.size;
+        pack.hash = record.hash;
+        if (!pack_unchanged(pack)) return fail(error, "rule pack changed: " + pack.path);
+        staged.pack_sources_.push_back(std::move(pack));
+    }
+
+    KeywordMatcher &keywords = staged.keywords_;
+    KeywordMeta keyword_meta;
+    std::vector<uint32_t> owners;
+    if (!reader.read_one(kKeywordMeta, keyword_meta) || !reader.read(kKeywordDense, keywords.dense_) ||
+        !reader.read(kKeywordEdgeOffset, keywords.edge_offset_) ||
+        !reader.read(kKeywordEdgeLabel, keywords.edge_label_) ||
+        !reader.read(kKeywordEdgeTarget, keywords.edge_target_) || !reader.read(kKeywordFail, keywords.fail_) ||
+        !reader.read(kKeywordPattern, keywords.pattern_) || !reader.read(kKeywordOutput, keywords.output_) ||
+        !reader.read(kKeywordOwnerOffset, staged.keyword_owner_offset_) || !reader.read(kKeywordOwners, owners) ||
+        !reader.read(kContentKeywordRank, staged.content_keyword_rank_) ||
+        !reader.texts(kContentKeywords, staged.content_keywords_)) {
+        return fail(error, corrupt + "keyword automaton");
+    }
+    keywords.patterns_ = static_cast<size_t>(keyword_meta.patterns);
+    keywords.dense_states_ = static_cast<size_t>(keyword_meta.dense_states);
+    const size_t states = keywords.fail_.size();
+    bool automaton_ok = keywords.dense_states_ <= states &&
+                        keywords.dense_.size() == keywords.dense_states_ * 256 &&
+                        keywords.edge_offset_.size() == (states ? states + 1 : 0) &&
+                        keywords.edge_label_.size() == keywords.edge_target_.size() &&
+                        keywords.pattern_.size() == states && keywords.output_.size() == states &&
+                        staged.keyword_owner_offset_.size() == keywords.patterns_ + 1 &&
+                        staged.content_keyword_rank_.size() == keywords.patterns_ && owners.size() % 2 == 0 &&
+                        staged.keyword_owner_offset_.back() == owners.size() / 2;
+    if (!automaton_ok) return fail(error, corrupt + "keyword automaton");
+    // Every index the scan follows stays in range, and the walks terminate:
+    // failure links lead to shallower (earlier) states until a dense one,
+    // and output links only to states that end a pattern.
+    automaton_ok = keywords.dense_states_ == std::min<size_t>(states, KeywordMatcher::kDenseStates) &&
+                   (states == 0 || (keywords.edge_offset_.front() == 0 &&
+                                    keywords.edge_offset_.back() == keywords.edge_label_.size()));
+    for (uint32_t target : keywords.dense_) automaton_ok = automaton_ok && target < states;
+    for (uint32_t target : keywords.edge_target_) automaton_ok = automaton_ok && target < states;
+    for (size_t s = 0; automaton_ok && s < states; ++s) {
+        const uint32_t pattern = keywords.pattern_[s];
+        const uint32_t output = keywords.output_[s];
+        automaton_ok = keywords.edge_offset_[s] <= keywords.edge_offset_[s + 1] &&
+                       (s == 0 ? keywords.fail_[s] == 0 : keywords.fail_[s] < s) &&
+                       (pattern == KeywordMatcher::npos || pattern < keywords.patterns_) && output < states &&
+                       (output == 0 || keywords.pattern_[output] != KeywordMatcher::npos);
+    }
+    for (size_t p = 0; automaton_ok && p < keywords.patterns_; ++p) {
+        automaton_ok = staged.keyword_owner_offset_[p] <= staged.keyword_owner_offset_[p + 1];
+        const uint32_t rank = staged.content_keyword_rank_[p];
+        automaton_ok = automaton_ok && (rank == KeywordMatcher::npos || rank < staged.content_keywords_.size());
+    }
+    if (!automaton_ok || (!staged.keyword_owner_offset_.empty() && staged.keyword_owner_offset_.front() != 0)) {
+        return fail(error, corrupt + "keyword automaton");
+    }
+    staged.keyword_owners_.resize(owners.size() / 2);
+    for (size_t i = 0; i < staged.keyword_owners_.size(); ++i) {
+        if (owners[2 * i] >= rule_count || owners[2 * i + 1] >= staged.rules_[owners[2 * i]].keywords.size()) {
+            return fail(error, corrupt + "keyword owners");
+        }
+        staged.keyword_owners_[i] = {owners[2 * i], owners[2 * i + 1]};
+    }
+
+    HashIndex &hashes = staged.hashes_;
+    HashMeta hash_meta;
+    if (!reader.read_one(kHashMeta, hash_meta) || !reader.read(kHashSlots, hashes.slots_) ||
+        !reader.read(kHashValues, hashes.values_)) {
+        return fail(error, corrupt + "hash index");
+    }
+    hashes.mask_ = static_cast<size_t>(hash_meta.mask);
+    hashes.count_ = static_cast<size_t>(hash_meta.count);
+    if (hashes.slots_.size() != (hashes.slots_.empty() ? 0 : hashes.mask_ + 1)) {
+        return fail(error, corrupt + "hash index");
+    }
+    for (const auto &slot : hashes.slots_) {
+        if (slot.begin > slot.end || slot.end > hashes.values_.size()) return fail(error, corrupt + "hash index");
+    }
+    for (uint64_t value : hashes.values_) {
+        if ((value >> 32) >= rule_count || (value & 0xFFFFFFFFu) >= staged.rules_[value >> 32].hashes.size()) {
+            return fail(error, corrupt + "hash index");
+        }
+    }
+
+    if (!reader.read(kEvalOrder, staged.eval_order_) || !reader.read(kRank, staged.rank_) ||
+        !reader.read(kRankSeverityBound, staged.rank_severity_bound_) ||
+        !reader.read(kConditionRules, staged.condition_rules_) ||
+        !reader.read(kAliasOffset, staged.alias_offset_) || !reader.read(kAlias, staged.alias_)) {
+        return fail(error, corrupt + "decision tables");
+    }
+    bool tables_ok = staged.eval_order_.size() == rule_count && staged.rank_.size() == rule_count &&
+                     staged.rank_severity_bound_.size() == rule_count &&
+                     staged.alias_offset_.size() == rule_count + 1 &&
+                     staged.alias_offset_.back() == staged.alias_.size();
+    for (uint32_t index : staged.eval_order_) tables_ok = tables_ok && index < rule_count;
+    for (uint32_t rank : staged.rank_) tables_ok = tables_ok && rank < rule_count;
+    for (uint32_t rank : staged.condition_rules_) tables_ok = tables_ok && rank < rule_count;
+    for (uint32_t index : staged.alias_) tables_ok = tables_ok && index < rule_count;
+    if (!tables_ok) return fail(error, corrupt + "decision tables");
+
+    RegexSet &regexes = staged.regex_set_;
+    std::vector<uint16_t> byte_class;
+    if (!reader.read(kRegexStates, regexes.states_) || !reader.read(kRegexCharsets, regexes.charsets_) ||
+        !reader.read(kRegexStarts, regexes.starts_) || !reader.read(kRegexIds, regexes.ids_) ||
+        !reader.read(kRegexByteClass, byte_class) || !reader.read(kRegexClassRep, regexes.class_rep_) ||
+        byte_class.size() != 256 || regexes.starts_.size() != regexes.ids_.size()) {
+        return fail(error, corrupt + "regex set");
+    }
+    std::copy(byte_class.begin(), byte_class.end(), regexes.byte_class_);
+    regexes.class_count_ = static_cast<uint32_t>(regexes.class_rep_.size());
+    bool regexes_ok = true;
+    for (uint16_t cls : byte_class) regexes_ok = regexes_ok && cls < regexes.class_count_;
+    for (uint32_t start : regexes.starts_) regexes_ok = regexes_ok && start < regexes.states_.size();
+    for (const auto &state : regexes.states_) {
+        regexes_ok = regexes_ok && state.kind <= RegexSet::StateKind::Match &&
+                     state.out < regexes.states_.size() && state.out1 < regexes.states_.size();
+        if (state.kind == RegexSet::StateKind::Char) regexes_ok = regexes_ok && state.arg < regexes.charsets_.size();
+        if (state.kind == RegexSet::StateKind::Match) regexes_ok = regexes_ok && state.arg < regexes.starts_.size();
+    }
+    for (uint32_t id : regexes.ids_) {
+        if (id >= rule_count) {
+            regexes_ok = false;
+            break;
+        }
+        staged.compiled_[id].in_regex_set = true;
+    }
+    if (!regexes_ok) return fail(error, corrupt + "regex set");
+    file.close();
+
+    // std::regex has no serialized form: patterns the regex set pre-filters
+    // compile on first use, the others here.
+    if (!staged.attach_regexes(message)) return fail(error, path + ": " + message);
+    staged.build_rule_maps();
+    engine = std::move(staged);
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rule_engine.h"
+
+// Versioned binary snapshot of a compiled RuleEngine: interned strings, rule
+// and predicate tables, the keyword automaton, the regex set, the hash index
+// and the decision tables. Loading maps the file read-only, verifies its
+// checksum and copies the tables out without parsing. std::regex has no
+// serialized form; patterns are compiled again, lazily where the regex set
+// pre-filters them.
+class PolicyImage {
+public:
+    static constexpr uint32_t kFormatVersion = 1;
+
+    // Identifies everything an image is built from besides its rule packs:
+    // the policy body, the built-in `defaults`, g_content_keywords and
+    // g_rules_path. Packs are checked against their recorded content hash.
+    static uint64_t source_key(const std::string &body, const std::vector<Rule> &defaults);
+
+    // Writes `engine` to `path`, replacing any previous image.
+    static bool save(const RuleEngine &engine, const std::string &path, uint64_t source_key,
+                     std::string *error = nullptr);
+    // Replaces `engine` with the image at `path`. Fails, leaving `engine`
+    // untouched, when the image is missing, corrupt, from another format
+    // version, built from another source_key, or a pack it read has changed.
+    static bool load(RuleEngine &engine, const std::string &path, uint64_t source_key,
+                     std::string *error = nullptr);
+};
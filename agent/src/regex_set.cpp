@@ -0,0 +1,808 @@
+#include "regex_set.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+constexpr size_t kMaxPatternStates = 20000;
+constexpr int kMaxRepeat = 1000;
+constexpr int kMaxNesting = 200;
+constexpr size_t kMaxDfaStates = 4096;
+// Sets scanned in turn on one thread (rule regexes and national-ID patterns,
+// per chunk) each keep their own DFA; beyond this the least recently used
+// cache is reset for the next set.
+constexpr size_t kDfaCachesPerThread = 4;
+// Rough per-entry cost of an unordered_map node beyond its key and value.
+constexpr size_t kIndexNodeBytes = 4 * sizeof(void *);
+
+enum AssertKind : uint32_t { kBol, kEol, kWordBoundary, kNotWordBoundary };
+
+// Character context on either side of a position.
+enum Context : unsigned char { kEdge = 0, kNonWord = 1, kWord = 2 };
+
+std::atomic<uint64_t> g_next_instance_id{1};
+
+bool is_word_byte(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// Frees a container's storage; clear() keeps it.
+template <typename T>
+void release_storage(T &container) {
+    T().swap(container);
+}
+
+std::bitset<256> digit_set() {
+    std::bitset<256> set;
+    for (int c = '0'; c <= '9'; ++c) set.set(c);
+    return set;
+}
+
+std::bitset<256> word_set() {
+    std::bitset<256> set;
+    for (int c = 0; c < 256; ++c) {
+        if (is_word_byte(static_cast<unsigned char>(c))) set.set(c);
+    }
+    return set;
+}
+
+std::bitset<256> space_set() {
+    std::bitset<256> set;
+    for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) set.set(static_cast<unsigned char>(c));
+    return set;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+enum class NodeKind { Empty, Chars, Assert, Concat, Alt, Repeat };
+
+struct Node {
+    NodeKind kind = NodeKind::Empty;
+    uint32_t arg = 0;
+    int min = 0;
+    int max = 0;  // -1 when unbounded
+    std::vector<Node> children;
+};
+
+// Recursive-descent parser for the ECMAScript subset the automaton handles.
+// Anything outside it fails the parse rather than risk diverging from
+// std::regex.
+class Parser {
+public:
+    Parser(const std::string &pattern, std::vector<std::bitset<256>> &charsets)
+        : p_(pattern), charsets_(charsets) {}
+
+    bool parse(Node &out) {
+        out = parse_alt();
+        return ok_ && pos_ == p_.size();
+    }
+
+private:
+    bool at_end() const { return pos_ >= p_.size(); }
+    char peek() const { return p_[pos_]; }
+
+    uint32_t add_set(const std::bitset<256> &set) {
+        charsets_.push_back(set);
+        return static_cast<uint32_t>(charsets_.size() - 1);
+    }
+
+    Node chars(const std::bitset<256> &set) {
+        Node node;
+        node.kind = NodeKind::Chars;
+        node.arg = add_set(set);
+        return node;
+    }
+
+    Node parse_alt() {
+        if (++depth_ > kMaxNesting) {
+            ok_ = false;
+            return Node();
+        }
+        std::vector<Node> alts;
+        alts.push_back(parse_concat());
+        while (ok_ && !at_end() && peek() == '|') {
+            ++pos_;
+            alts.push_back(parse_concat());
+        }
+        --depth_;
+        if (alts.size() == 1) return std::move(alts.front());
+        Node node;
+        node.kind = NodeKind::Alt;
+        node.children = std::move(alts);
+        return node;
+    }
+
+    Node parse_concat() {
+        Node node;
+        node.kind = NodeKind::Concat;
+        while (ok_ && !at_end() && peek() != '|' && peek() != ')') {
+            Node atom;
+            if (!parse_atom(atom)) {
+                ok_ = false;
+                break;
+            }
+            parse_quantifier(atom);
+            node.children.push_back(std::move(atom));
+        }
+        return node;
+    }
+
+    bool parse_atom(Node &atom) {
+        unsigned char c = static_cast<unsigned char>(p_[pos_++]);
+        if (c >= 0x80) return false;
+        switch (c) {
+            case '(': {
+                if (!at_end() && peek() == '?') {
+                    if (pos_ + 1 >= p_.size() || p_[pos_ + 1] != ':') return false;
+                    pos_ += 2;
+                }
+                atom = parse_alt();
+                if (!ok_ || at_end() || peek() != ')') return false;
+                ++pos_;
+                return true;
+            }
+            case '[':
+                return parse_class(atom);
+            case '.': {
+                std::bitset<256> set;
+                set.set();
+                set.reset('\n');
+                set.reset('\r');
+                atom = chars(set);
+                return true;
+            }
+            case '^':
+            case '$':
+                atom.kind = NodeKind::Assert;
+                atom.arg = (c == '^') ? kBol : kEol;
+                return true;
+            case '\\':
+                return parse_escape(atom);
+            case '*': case '+': case '?': case '{': case '}': case ']': case ')':
+                return false;
+            default: {
+                std::bitset<256> set;
+                set.set(c);
+                atom = chars(set);
+                return true;
+            }
+        }
+    }
+
+    // Parses an escape that denotes a single byte. Returns -1 when the escape
+    // is not a single byte or is unsupported.
+    int parse_byte_escape(char c) {
+        switch (c) {
+            case 't': return '\t';
+            case 'n': return '\n';
+            case 'v': return '\v';
+            case 'f': return '\f';
+            case 'r': return '\r';
+            case '0':
+                if (!at_end() && peek() >= '0' && peek() <= '9') return -1;
+                return 0;
+            case 'x': {
+                if (pos_ + 2 > p_.size()) return -1;
+                int hi = hex_value(p_[pos_]);
+                int lo = hex_value(p_[pos_ + 1]);
+                if (hi < 0 || lo < 0) return -1;
+                pos_ += 2;
+                return hi * 16 + lo;
+            }
+            case 'u': {
+                if (pos_ + 4 > p_.size()) return -1;
+                int value = 0;
+                for (int k = 0; k < 4; ++k) {
+                    int digit = hex_value(p_[pos_ + k]);
+                    if (digit < 0) return -1;
+                    value = value * 16 + digit;
+                }
+                if (value >= 0x80) return -1;
+                pos_ += 4;
+                return value;
+            }
+            default: {
+                unsigned char u = static_cast<unsigned char>(c);
+                if (u >= 0x80 || (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z')) {
+                    return -1;
+                }
+                return u;
+            }
+        }
+    }
+
+    bool class_escape(char c, std::bitset<256> &set) {
+        switch (c) {
+            case 'd': set = digit_set(); return true;
+            case 'D': set = ~digit_set(); return true;
+            case 'w': set = word_set(); return true;
+            case 'W': set = ~word_set(); return true;
+            case 's': set = space_set(); return true;
+            case 'S': set = ~space_set(); return true;
+            default: return false;
+        }
+    }
+
+    bool parse_escape(Node &atom) {
+        if (at_end()) return false;
+        char c = p_[pos_++];
+        std::bitset<256> set;
+        if (class_escape(c, set)) {
+            atom = chars(set);
+            return true;
+        }
+        if (c == 'b' || c == 'B') {
+            atom.kind = NodeKind::Assert;
+            atom.arg = (c == 'b') ? kWordBoundary : kNotWordBoundary;
+            return true;
+        }
+        int byte = parse_byte_escape(c);
+        if (byte < 0) return false;
+        set.set(static_cast<size_t>(byte));
+        atom = chars(set);
+        return true;
+    }
+
+    // Reads one class member: a single byte (returned) or a set escape
+    // (returned as -2 with `set` filled).
+    int parse_class_member(std::bitset<256> &set) {
+        if (at_end()) return -1;
+        unsigned char c = static_cast<unsigned char>(p_[pos_++]);
+        if (c >= 0x80) return -1;
+        if (c == '[' && !at_end() && (peek() == ':' || peek() == '.' || peek() == '=')) return -1;
+        if (c != '\\') return c;
+        if (at_end()) return -1;
+        char e = p_[pos_++];
+        if (class_escape(e, set)) return -2;
+        if (e == 'b') return '\b';
+        if (e == 'B') return -1;
+        return parse_byte_escape(e);
+    }
+
+    bool parse_class(Node &atom) {
+        bool negate = false;
+        if (!at_end() && peek() == '^') {
+            negate = true;
+            ++pos_;
+        }
+        if (at_end() || peek() == ']') return false;
+        std::bitset<256> set;
+        while (true) {
+            if (at_end()) return false;
+            if (peek() == ']') {
+                ++pos_;
+                break;
+            }
+            std::bitset<256> member;
+            int lo = parse_class_member(member);
+            if (lo == -1) return false;
+            if (lo == -2) {
+                set |= member;
+                continue;
+            }
+            if (pos_ + 1 < p_.size() && peek() == '-' && p_[pos_ + 1] != ']') {
+                ++pos_;
+                int hi = parse_class_member(member);
+                if (hi < 0 || hi < lo) return false;
+                for (int b = lo; b <= hi; ++b) set.set(static_cast<size_t>(b));
+            } else {
+                set.set(static_cast<size_t>(lo));
+            }
+        }
+        if (negate) set.flip();
+        atom = chars(set);
+        return true;
+    }
+
+    bool parse_bound(int &value) {
+        size_t start = pos_;
+        value = 0;
+        while (!at_end() && peek() >= '0' && peek() <= '9') {
+            value = value * 10 + (peek() - '0');
+            if (value > kMaxRepeat) return false;
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    void parse_quantifier(Node &atom) {
+        if (at_end()) return;
+        int min = 0;
+        int max = 0;
+        char c = peek();
+        if (c == '*') {
+            max = -1;
+            ++pos_;
+        } else if (c == '+') {
+            min = 1;
+            max = -1;
+            ++pos_;
+        } else if (c == '?') {
+            max = 1;
+            ++pos_;
+        } else if (c == '{') {
+            ++pos_;
+            if (!parse_bound(min)) {
+                ok_ = false;
+                return;
+            }
+            max = min;
+            if (!at_end() && peek() == ',') {
+                ++pos_;
+                max = -1;
+                if (!at_end() && peek() != '}' && (!parse_bound(max) || max < min)) {
+                    ok_ = false;
+                    return;
+                }
+            }
+            if (at_end() || peek() != '}') {
+                ok_ = false;
+                return;
+            }
+            ++pos_;
+        } else {
+            return;
+        }
+        if (atom.kind == NodeKind::Assert) {
+            ok_ = false;
+            return;
+        }
+        if (!at_end() && peek() == '?') ++pos_;
+        if (!at_end() && (peek() == '*' || peek() == '+' || peek() == '?' || peek() == '{')) {
+            ok_ = false;
+            return;
+        }
+        Node repeat;
+        repeat.kind = NodeKind::Repeat;
+        repeat.min = min;
+        repeat.max = max;
+        repeat.children.push_back(std::move(atom));
+        atom = std::move(repeat);
+    }
+
+    const std::string &p_;
+    std::vector<std::bitset<256>> &charsets_;
+    size_t pos_ = 0;
+    int depth_ = 0;
+    bool ok_ = true;
+};
+
+// Thompson construction with dangling exits encoded as state * 2 + branch.
+class Builder {
+public:
+    Builder(std::vector<RegexSet::State> &states, size_t limit) : states_(states), limit_(limit) {}
+
+    struct Frag {
+        uint32_t start = 0;
+        std::vector<uint32_t> holes;
+    };
+
+    bool ok() const { return ok_; }
+
+    uint32_t add(RegexSet::StateKind kind, uint32_t arg = 0) {
+        if (states_.size() >= limit_) ok_ = false;
+        RegexSet::State state;
+        state.kind = kind;
+        state.arg = arg;
+        states_.push_back(state);
+        return static_cast<uint32_t>(states_.size() - 1);
+    }
+
+    void patch(const std::vector<uint32_t> &holes, uint32_t target) {
+        for (uint32_t hole : holes) {
+            if (hole & 1) states_[hole >> 1].out1 = target;
+            else states_[hole >> 1].out = target;
+        }
+    }
+
+    Frag single(RegexSet::StateKind kind, uint32_t arg = 0) {
+        uint32_t s = add(kind, arg);
+        return Frag{s, {s * 2}};
+    }
+
+    void append(Frag &acc, bool &have, Frag next) {
+        if (!have) {
+            acc = std::move(next);
+            have = true;
+            return;
+        }
+        patch(acc.holes, next.start);
+        acc.holes = std::move(next.holes);
+    }
+
+    Frag emit(const Node &node) {
+        if (!ok_) return Frag{};
+        switch (node.kind) {
+            case NodeKind::Empty:
+                return single(RegexSet::StateKind::Epsilon);
+            case NodeKind::Chars:
+                return single(RegexSet::StateKind::Char, node.arg);
+            case NodeKind::Assert:
+                return single(RegexSet::StateKind::Assert, node.arg);
+            case NodeKind::Concat: {
+                Frag acc;
+                bool have = false;
+                for (const auto &child : node.children) {
+                    append(acc, have, emit(child));
+                    if (!ok_) return Frag{};
+                }
+                return have ? acc : single(RegexSet::StateKind::Epsilon);
+            }
+            case NodeKind::Alt: {
+                std::vector<Frag> frags;
+                for (const auto &child : node.children) {
+                    frags.push_back(emit(child));
+                    if (!ok_) return Frag{};
+                }
+                Frag out;
+                out.start = frags.back().start;
+                for (size_t i = frags.size() - 1; i-- > 0;) {
+                    uint32_t split = add(RegexSet::StateKind::Split);
+                    states_[split].out = frags[i].start;
+                    states_[split].out1 = out.start;
+                    out.start = split;
+                }
+                for (auto &frag : frags) {
+                    out.holes.insert(out.holes.end(), frag.holes.begin(), frag.holes.end());
+                }
+                return out;
+            }
+            case NodeKind::Repeat: {
+                const Node &child = node.children.front();
+                Frag acc;
+                bool have = false;
+                for (int k = 0; k < node.min && ok_; ++k) {
+                    append(acc, have, emit(child));
+                }
+                if (node.max < 0) {
+                    Frag body = emit(child);
+                    uint32_t split = add(RegexSet::StateKind::Split);
+                    states_[split].out = body.start;
+                    patch(body.holes, split);
+                    append(acc, have, Frag{split, {split * 2 + 1}});
+                } else {
+                    for (int k = node.min; k < node.max && ok_; ++k) {
+                        Frag body = emit(child);
+                        uint32_t split = add(RegexSet::StateKind::Split);
+                        states_[split].out = body.start;
+                        body.holes.push_back(split * 2 + 1);
+                        append(acc, have, Frag{split, std::move(body.holes)});
+                    }
+                }
+                if (!ok_) return Frag{};
+                return have ? acc : single(RegexSet::StateKind::Epsilon);
+            }
+        }
+        return Frag{};
+    }
+
+private:
+    std::vector<RegexSet::State> &states_;
+    size_t limit_;
+    bool ok_ = true;
+};
+
+}  // namespace
+
+// Lazily built DFA over a RegexSet's NFA. A DFA state is the set of NFA
+// states reached after consuming a byte plus the context of that byte;
+// closures through assertions are resolved on the next transition once the
+// following byte is known. Each scanning thread keeps a few, one per set.
+struct RegexSetDfa {
+    uint64_t owner = 0;
+    uint64_t last_used = 0;
+    // Estimated heap bytes of the tables below, counted against
+    // RegexSet::kDfaBytesPerThread.
+    size_t bytes = 0;
+    uint32_t stride = 0;
+    // State at the start of a text, or -1 until interned after a reset.
+    int32_t start = -1;
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<std::string> keys;
+    std::vector<int32_t> next;
+    std::vector<uint32_t> accept;
+    std::vector<std::vector<uint32_t>> accept_lists;
+    std::vector<uint32_t> mark;
+    uint32_t epoch = 0;
+    std::vector<uint32_t> stack;
+    std::vector<uint32_t> consuming;
+    std::vector<uint32_t> matched;
+    // Per-pattern flags for the scan in progress.
+    std::vector<char> found;
+
+    // Returns the tables' memory; the scan scratch below is kept.
+    void release() {
+        owner = 0;
+        start = -1;
+        release_storage(index);
+        release_storage(keys);
+        release_storage(next);
+        release_storage(accept);
+        release_storage(accept_lists);
+        release_storage(mark);
+        bytes = 0;
+    }
+
+    void reset(const RegexSet &set) {
+        release();
+        owner = set.instance_id_;
+        stride = set.class_count_ + 1;
+        accept_lists.assign(1, {});
+        mark.assign(set.states_.size(), 0);
+        epoch = 0;
+        bytes = mark.size() * sizeof(uint32_t);
+    }
+
+    uint32_t intern(const std::string &key) {
+        auto it = index.find(key);
+        if (it != index.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(keys.size());
+        keys.push_back(key);
+        index.emplace(key, id);
+        next.resize(next.size() + stride, -1);
+        accept.resize(accept.size() + stride, 0);
+        // The key is held twice: in keys and in the index.
+        bytes += 2 * (sizeof(std::string) + key.size()) + kIndexNodeBytes +
+                 stride * (sizeof(int32_t) + sizeof(uint32_t));
+        return id;
+    }
+
+    // Drops every cached state except `state`, which is returned renumbered.
+    uint32_t flush(const RegexSet &set, uint32_t state) {
+        std::string key = keys[state];
+        reset(set);
+        return intern(key);
+    }
+
+    static bool assert_holds(uint32_t kind, unsigned char prev, unsigned char following) {
+        switch (kind) {
+            case kBol: return prev == kEdge;
+            case kEol: return following == kEdge;
+            case kWordBoundary: return (prev == kWord) != (following == kWord);
+            case kNotWordBoundary: return (prev == kWord) == (following == kWord);
+        }
+        return false;
+    }
+
+    void compute(const RegexSet &set, uint32_t state, uint32_t cls) {
+        const std::string key = keys[state];
+        unsigned char prev = static_cast<unsigned char>(key[0]);
+        bool at_end = cls == set.class_count_;
+        unsigned char rep = at_end ? 0 : set.class_rep_[cls];
+        unsigned char following = at_end ? kEdge : (is_word_byte(rep) ? kWord : kNonWord);
+
+        if (++epoch == 0) {
+            std::fill(mark.begin(), mark.end(), 0u);
+            epoch = 1;
+        }
+        stack.clear();
+        consuming.clear();
+        matched.clear();
+        for (size_t off = 1; off + 4 <= key.size(); off += 4) {
+            uint32_t s = 0;
+            for (int b = 0; b < 4; ++b) s |= static_cast<uint32_t>(static_cast<unsigned char>(key[off + b])) << (8 * b);
+            stack.push_back(s);
+        }
+        stack.insert(stack.end(), set.starts_.begin(), set.starts_.end());
+        while (!stack.empty()) {
+            uint32_t u = stack.back();
+            stack.pop_back();
+            if (mark[u] == epoch) continue;
+            mark[u] = epoch;
+            const auto &st = set.states_[u];
+            switch (st.kind) {
+                case RegexSet::StateKind::Char: consuming.push_back(u); break;
+                case RegexSet::StateKind::Split:
+                    stack.push_back(st.out1);
+                    stack.push_back(st.out);
+                    break;
+                case RegexSet::StateKind::Epsilon: stack.push_back(st.out); break;
+                case RegexSet::StateKind::Assert:
+                    if (assert_holds(st.arg, prev, following)) stack.push_back(st.out);
+                    break;
+                case RegexSet::StateKind::Match: matched.push_back(st.arg); break;
+            }
+        }
+
+        uint32_t target = state;
+        if (!at_end) {
+            std::vector<uint32_t> targets;
+            for (uint32_t u : consuming) {
+                const auto &st = set.states_[u];
+                if (set.charsets_[st.arg].test(rep)) targets.push_back(st.out);
+            }
+            std::sort(targets.begin(), targets.end());
+            targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+            std::string next_key(1, static_cast<char>(following));
+            next_key.reserve(1 + targets.size() * 4);
+            for (uint32_t t : targets) {
+                for (int b = 0; b < 4; ++b) next_key.push_back(static_cast<char>((t >> (8 * b)) & 0xFF));
+            }
+            target = intern(next_key);
+        }
+        size_t slot = static_cast<size_t>(state) * stride + cls;
+        next[slot] = static_cast<int32_t>(target);
+        if (!matched.empty()) {
+            std::sort(matched.begin(), matched.end());
+            matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+            accept[slot] = static_cast<uint32_t>(accept_lists.size());
+            accept_lists.push_back(matched);
+            bytes += sizeof(std::vector<uint32_t>) + matched.size() * sizeof(uint32_t);
+        }
+    }
+};
+
+namespace {
+
+// The DFAs one thread holds, across every set it scans.
+struct ThreadDfas {
+    RegexSetDfa caches[kDfaCachesPerThread];
+    uint64_t clock = 0;
+
+    size_t bytes() const {
+        size_t total = 0;
+        for (const auto &cache : caches) total += cache.bytes;
+        return total;
+    }
+
+    // Makes room for another state in `active`: idle sets give theirs up
+    // first, and `active` is flushed down to `state` when it alone is over
+    // budget or out of states. Returns `state`, renumbered if flushed.
+    uint32_t reserve(const RegexSet &set, RegexSetDfa &active, uint32_t state) {
+        if (bytes() >= RegexSet::kDfaBytesPerThread) {
+            for (auto &cache : caches) {
+                if (&cache != &active) cache.release();
+            }
+        }
+        if (active.keys.size() >= kMaxDfaStates || active.bytes >= RegexSet::kDfaBytesPerThread) {
+            state = active.flush(set, state);
+        }
+        return state;
+    }
+};
+
+ThreadDfas &thread_dfas() {
+    thread_local ThreadDfas dfas;
+    return dfas;
+}
+
+}  // namespace
+
+RegexSet::RegexSet() : instance_id_(g_next_instance_id.fetch_add(1)) {}
+
+bool RegexSet::add(const std::string &pattern, uint32_t id) {
+    const size_t state_mark = states_.size();
+    const size_t charset_mark = charsets_.size();
+    Node root;
+    Parser parser(pattern, charsets_);
+    bool ok = parser.parse(root);
+    if (ok) {
+        Builder builder(states_, state_mark + kMaxPatternStates);
+        auto frag = builder.emit(root);
+        if (builder.ok()) {
+            uint32_t match = builder.add(StateKind::Match, static_cast<uint32_t>(starts_.size()));
+            builder.patch(frag.holes, match);
+            starts_.push_back(frag.start);
+            ids_.push_back(id);
+            return true;
+        }
+    }
+    states_.resize(state_mark);
+    charsets_.resize(charset_mark);
+    return false;
+}
+
+void RegexSet::build() {
+    // Refine the byte partition by word-ness and then by every distinct
+    // charset; patterns share most of their sets, so few passes remain.
+    uint32_t cls[256];
+    for (int b = 0; b < 256; ++b) cls[b] = is_word_byte(static_cast<unsigned char>(b)) ? 1 : 0;
+    uint32_t classes = 2;
+    std::unordered_set<std::bitset<256>> seen;
+    std::vector<uint32_t> remap;
+    for (const auto &set : charsets_) {
+        if (classes == 256) break;
+        if (!seen.insert(set).second) continue;
+        remap.assign(static_cast<size_t>(classes) * 2, UINT32_MAX);
+        uint32_t next = 0;
+        for (int b = 0; b < 256; ++b) {
+            uint32_t &slot = remap[cls[b] * 2 + (set.test(static_cast<size_t>(b)) ? 1 : 0)];
+            if (slot == UINT32_MAX) slot = next++;
+            cls[b] = slot;
+        }
+        classes = next;
+    }
+    std::map<uint32_t, uint16_t> compact;
+    class_rep_.clear();
+    for (int b = 0; b < 256; ++b) {
+        auto it = compact.find(cls[b]);
+        if (it == compact.end()) {
+            it = compact.emplace(cls[b], static_cast<uint16_t>(compact.size())).first;
+            class_rep_.push_back(static_cast<unsigned char>(b));
+        }
+        byte_class_[b] = it->second;
+    }
+    class_count_ = static_cast<uint32_t>(compact.size());
+    instance_id_ = g_next_instance_id.fetch_add(1);
+}
+
+void RegexSet::clear() {
+    states_.clear();
+    charsets_.clear();
+    starts_.clear();
+    ids_.clear();
+    class_rep_.clear();
+    class_count_ = 0;
+    instance_id_ = g_next_instance_id.fetch_add(1);
+}
+
+void RegexSet::remap_ids(const std::vector<uint32_t> &map) {
+    for (auto &id : ids_) id = map[id];
+}
+
+void RegexSet::match(const char *data, size_t len, std::vector<uint32_t> &ids) const {
+    if (starts_.empty()) return;
+    ThreadDfas &dfas = thread_dfas();
+    RegexSetDfa *lru = &dfas.caches[0];
+    RegexSetDfa *cache = nullptr;
+    for (auto &candidate : dfas.caches) {
+        if (candidate.owner == instance_id_) {
+            cache = &candidate;
+            break;
+        }
+        if (candidate.last_used < lru->last_used) lru = &candidate;
+    }
+    if (!cache) {
+        cache = lru;
+        cache->reset(*this);
+    }
+    RegexSetDfa &dfa = *cache;
+    dfa.last_used = ++dfas.clock;
+
+    static const std::string kStartKey(1, static_cast<char>(kEdge));
+    if (dfa.start < 0) dfa.start = static_cast<int32_t>(dfa.intern(kStartKey));
+    std::vector<char> &found = dfa.found;
+    found.assign(starts_.size(), 0);
+    size_t remaining = starts_.size();
+    auto step = [&](uint32_t state, uint32_t cls) -> uint32_t {
+        size_t slot = static_cast<size_t>(state) * dfa.stride + cls;
+        if (dfa.next[slot] < 0) {
+            state = dfas.reserve(*this, dfa, state);
+            slot = static_cast<size_t>(state) * dfa.stride + cls;
+            dfa.compute(*this, state, cls);
+        }
+        if (uint32_t list = dfa.accept[slot]) {
+            for (uint32_t slot_id : dfa.accept_lists[list]) {
+                if (!found[slot_id]) {
+                    found[slot_id] = 1;
+                    --remaining;
+                }
+            }
+        }
+        return static_cast<uint32_t>(dfa.next[slot]);
+    };
+
+    uint32_t state = static_cast<uint32_t>(dfa.start);
+    for (size_t i = 0; i < len && remaining > 0; ++i) {
+        state = step(state, byte_class_[static_cast<unsigned char>(data[i])]);
+    }
+    if (remaining > 0) step(state, class_count_);
+
+    size_t first = ids.size();
+    for (size_t slot_id = 0; slot_id < found.size(); ++slot_id) {
+        if (found[slot_id]) ids.push_back(ids_[slot_id]);
+    }
+    std::sort(ids.begin() + static_cast<std::ptrdiff_t>(first), ids.end());
+}
+
+size_t RegexSet::thread_dfa_bytes() {
+    return thread_dfas().bytes();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Combines many ECMAScript patterns into one Thompson NFA and reports, in a
+// single linear pass, which of them match anywhere in a text. The DFA is
+// built lazily per scanning thread from the immutable NFA, so the set itself
+// can be shared freely.
+//
+// Supported: literals, escapes, classes, '.', groups, alternation, greedy and
+// lazy quantifiers, ^, $, \b and \B. Back-references, lookaround and other
+// constructs are rejected by add() and stay on the caller's std::regex path.
+class RegexSet {
+public:
+    RegexSet();
+
+    // Adds a pattern reported as `id` on match. Returns false, leaving the set
+    // unchanged, when the pattern cannot be compiled to the automaton.
+    bool add(const std::string &pattern, uint32_t id);
+    void build();
+    void clear();
+
+    bool empty() const { return starts_.empty(); }
+    size_t size() const { return starts_.size(); }
+    size_t nfa_size() const { return states_.size(); }
+
+    // Replaces every pattern id with map[id]. The automaton is unchanged, so
+    // per-thread DFAs built for the original carry over to a remapped copy.
+    void remap_ids(const std::vector<uint32_t> &map);
+
+    // Appends the ids of every pattern with at least one match in text, in
+    // ascending order.
+    void match(const char *data, size_t len, std::vector<uint32_t> &ids) const;
+
+    // Memory the DFAs of one scanning thread may hold across every set it
+    // scans; beyond it idle DFAs are released and the busy one flushed.
+    static constexpr size_t kDfaBytesPerThread = 8u << 20;
+    // Estimated bytes the calling thread's DFAs hold now.
+    static size_t thread_dfa_bytes();
+
+    enum class StateKind : uint8_t { Char, Split, Epsilon, Assert, Match };
+    struct State {
+        StateKind kind = StateKind::Epsilon;
+        uint32_t out = 0;
+        uint32_t out1 = 0;
+        uint32_t arg = 0;
+    };
+
+private:
+    friend struct RegexSetDfa;
+    friend class PolicyImage;
+
+    uint64_t instance_id_;
+    std::vector<State> states_;
+    std::vector<std::bitset<256>> charsets_;
+    std::vector<uint32_t> starts_;
+    std::vector<uint32_t> ids_;
+    // Byte -> equivalence class; bytes in one class are indistinguishable to
+    // every charset and to \b. Class `class_count_` is end of text.
+    uint16_t byte_class_[256] = {};
+    std::vector<unsigned char> class_rep_;
+    uint32_t class_count_ = 0;
+};
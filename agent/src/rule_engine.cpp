@@ -1,11 +1,19 @@
 #include "rule_engine.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <fstream>
+#include <future>
+#include <limits>
+#include <mutex>
 #include <regex>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 #include "config.h"
+#include "fnv1a.h"
+#include "json_reader.h"
 
 static std::string trim_copy(const std::string &s) {
     size_t start = 0;
@@ -22,30 +30,6 @@ static std::string to_lower_copy(const std::string &s) {
     return out;
 }
 
-static std::string extract_string_field(const std::string &s, const std::string &key) {
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return "";
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return "";
-    auto first = s.find('"', colon + 1);
-    if (first == std::string::npos) return "";
-    auto second = s.find('"', first + 1);
-    if (second == std::string::npos) return "";
-    return s.substr(first + 1, second - first - 1);
-}
-
-static bool extract_bool_field(const std::string &s, const std::string &key, bool default_value) {
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return default_value;
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return default_value;
-    size_t i = colon + 1;
-    while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
-    if (s.compare(i, 4, "true") == 0) return true;
-    if (s.compare(i, 5, "false") == 0) return false;
-    return default_value;
-}
-
 static int severity_from_string(const std::string &value, int fallback) {
     std::string lower = to_lower_copy(value);
     if (lower == "low") return 3;
@@ -58,147 +42,95 @@ static int severity_from_string(const std::string &value, int fallback) {
     return fallback;
 }
 
-static int extract_int_field(const std::string &s, const std::string &key, int default_value) {
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return default_value;
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return default_value;
-    size_t i = colon + 1;
-    while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
-    size_t j = i;
-    if (j < s.size() && s[j] == '-') ++j;
-    while (j < s.size() && std::isdigit(static_cast<unsigned char>(s[j]))) ++j;
-    if (j > i) {
-        return std::stoi(s.substr(i, j - i));
-    }
-    return default_value;
+static RuleAction parse_action(const std::string &action) {
+    std::string lower = to_lower_copy(action);
+    if (lower == "allow") return RuleAction::Allow;
+    if (lower == "alert") return RuleAction::Alert;
+    if (lower == "block") return RuleAction::Block;
+    if (lower == "quarantine") return RuleAction::Quarantine;
+    if (lower == "shadow-copy" || lower == "shadow_copy" || lower == "shadowcopy") return RuleAction::ShadowCopy;
+    return RuleAction::Allow;
 }
 
-static std::vector<std::string> extract_array_field(const std::string &s, const std::string &key) {
+static std::vector<std::string> string_list(const JsonValue &value) {
     std::vector<std::string> out;
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return out;
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return out;
-    auto lb = s.find('[', colon);
-    auto rb = s.find(']', lb);
-    if (lb == std::string::npos || rb == std::string::npos) return out;
-    std::string body = s.substr(lb + 1, rb - lb - 1);
-    std::istringstream iss(body);
-    std::string token;
-    while (std::getline(iss, token, ',')) {
-        auto first = token.find('"');
-        if (first == std::string::npos) continue;
-        auto second = token.find('"', first + 1);
-        if (second == std::string::npos) continue;
-        out.push_back(token.substr(first + 1, second - first - 1));
+    for (const auto &item : value.elements()) {
+        if (item.is_string()) out.push_back(item.as_string());
     }
     return out;
 }
 
-static std::vector<RuleCondition> extract_conditions_field(const std::string &s, const std::string &key) {
+static std::vector<RuleCondition> parse_json_conditions(const JsonValue &value) {
     std::vector<RuleCondition> out;
-    auto pos = s.find("\"" + key + "\"");
-    if (pos == std::string::npos) return out;
-    auto colon = s.find(':', pos);
-    if (colon == std::string::npos) return out;
-    auto lb = s.find('[', colon);
-    auto rb = s.find(']', lb);
-    if (lb == std::string::npos || rb == std::string::npos) return out;
-    size_t i = lb + 1;
-    int depth = 0;
-    size_t obj_start = std::string::npos;
-    for (; i < rb; ++i) {
-        char c = s[i];
-        if (c == '{') {
-            if (depth == 0) obj_start = i;
-            depth++;
-        } else if (c == '}') {
-            depth--;
-            if (depth == 0 && obj_start != std::string::npos) {
-                std::string obj = s.substr(obj_start, i - obj_start + 1);
-                RuleCondition cond;
-                cond.field = extract_string_field(obj, "field");
-                cond.op = extract_string_field(obj, "op");
-                cond.value = extract_string_field(obj, "value");
-                if (!cond.field.empty()) {
-                    out.push_back(cond);
-                }
-                obj_start = std::string::npos;
-            }
+    for (const auto &item : value.elements()) {
+        RuleCondition cond;
+        for (const auto &member : item.members()) {
+            if (member.key.equals("field")) cond.field = member.value.as_string();
+            else if (member.key.equals("op")) cond.op = member.value.as_string();
+            else if (member.key.equals("value")) cond.value = member.value.as_string();
+        }
+        if (!cond.field.empty()) {
+            out.push_back(std::move(cond));
         }
     }
     return out;
 }
 
-static RuleAction parse_action(const std::string &action) {
-    std::string lower = to_lower_copy(action);
-    if (lower == "allow") return RuleAction::Allow;
-    if (lower == "alert") return RuleAction::Alert;
-    if (lower == "block") return RuleAction::Block;
-    if (lower == "quarantine") return RuleAction::Quarantine;
-    if (lower == "shadow-copy" || lower == "shadow_copy" || lower == "shadowcopy") return RuleAction::ShadowCopy;
-    return RuleAction::Allow;
-}
-
-static std::vector<RuleAction> extract_actions_field(const std::string &s, const std::string &key) {
+static std::vector<RuleAction> parse_json_actions(const JsonValue &value) {
     std::vector<RuleAction> out;
-    auto items = extract_array_field(s, key);
-    for (const auto &item : items) {
-        out.push_back(parse_action(item));
+    if (value.is_string()) {
+        out.push_back(parse_action(value.as_string()));
+        return out;
     }
-    if (out.empty()) {
-        auto single = extract_string_field(s, key);
-        if (!single.empty()) {
-            out.push_back(parse_action(single));
-        }
+    for (const auto &item : value.elements()) {
+        if (item.is_string()) out.push_back(parse_action(item.as_string()));
     }
     return out;
 }
 
-static std::vector<Rule> parse_json_rules(const std::string &s) {
-    std::vector<Rule> rules;
-    auto rules_pos = s.find("\"rules\"");
-    if (rules_pos == std::string::npos) return rules;
-    auto lb = s.find('[', rules_pos);
-    if (lb == std::string::npos) return rules;
-    size_t i = lb + 1;
-    int depth = 0;
-    size_t obj_start = std::string::npos;
-    for (; i < s.size(); ++i) {
-        char c = s[i];
-        if (c == '{') {
-            if (depth == 0) obj_start = i;
-            depth++;
-        } else if (c == '}') {
-            depth--;
-            if (depth == 0 && obj_start != std::string::npos) {
-                std::string obj = s.substr(obj_start, i - obj_start + 1);
-                Rule rule;
-                rule.id = extract_string_field(obj, "id");
-                rule.name = extract_string_field(obj, "name");
-                rule.type = to_lower_copy(extract_string_field(obj, "type"));
-                rule.priority = extract_int_field(obj, "priority", 0);
-                rule.severity = extract_int_field(obj, "severity", 0);
-                if (rule.severity == 0) {
-                    rule.severity = severity_from_string(extract_string_field(obj, "severity"), rule.severity);
-                }
-                rule.pattern = extract_string_field(obj, "pattern");
-                rule.keywords = extract_array_field(obj, "keywords");
-                rule.hashes = extract_array_field(obj, "hashes");
-                rule.conditions = extract_conditions_field(obj, "conditions");
-                rule.actions = extract_actions_field(obj, "actions");
-                rule.enabled = extract_bool_field(obj, "enabled", true);
-                if (!rule.type.empty() || !rule.conditions.empty()) {
-                    rules.push_back(rule);
-                }
-                obj_start = std::string::npos;
-            }
-        } else if (c == ']') {
-            if (depth == 0) break;
+static Rule parse_json_rule(const JsonValue &object) {
+    Rule rule;
+    for (const auto &member : object.members()) {
+        const JsonValue &key = member.key;
+        const JsonValue &value = member.value;
+        if (key.equals("id")) rule.id = value.as_string();
+        else if (key.equals("name")) rule.name = value.as_string();
+        else if (key.equals("type")) rule.type = to_lower_copy(value.as_string());
+        else if (key.equals("priority")) rule.priority = static_cast<int>(value.as_int(0));
+        else if (key.equals("severity")) {
+            rule.severity = value.is_string() ? severity_from_string(value.as_string(), 0)
+                                              : static_cast<int>(value.as_int(0));
         }
+        else if (key.equals("pattern")) rule.pattern = value.as_string();
+        else if (key.equals("keywords")) rule.keywords = string_list(value);
+        else if (key.equals("hashes")) rule.hashes = string_list(value);
+        else if (key.equals("conditions")) rule.conditions = parse_json_conditions(value);
+        else if (key.equals("actions")) rule.actions = parse_json_actions(value);
+        else if (key.equals("enabled")) rule.enabled = value.as_bool(true);
     }
-    return rules;
+    return rule;
+}
+
+static void rules_from_document(const JsonValue &root, std::vector<Rule> &rules) {
+    // A policy or rule pack keeps its rules under "rules"; a bare array is a
+    // list of rules.
+    JsonValue list = root.is_array() ? root : root.get("rules");
+    if (!list.is_array()) list = root.find_first("rules");
+    for (const auto &item : list.elements()) {
+        if (!item.is_object()) continue;
+        Rule rule = parse_json_rule(item);
+        if (!rule.type.empty() || !rule.conditions.empty()) {
+            rules.push_back(std::move(rule));
+        }
+    }
+}
+
+bool parse_rules_json(std::string_view body, std::vector<Rule> &rules, std::string *error) {
+    rules.clear();
+    JsonDocument doc;
+    if (!doc.parse(body, error)) return false;
+    rules_from_document(doc.root(), rules);
+    return true;
 }
 
 static std::vector<std::string> parse_yaml_inline_list(const std::string &value) {
@@ -287,6 +219,10 @@ static double compute_confidence(const Rule &rule, size_t match_count) {
     return std::min(1.0, conf);
 }
 
+static bool is_content_rule(const Rule &rule) {
+    return rule.type == "regex" || rule.type == "keyword" || rule.type == "hash";
+}
+
 static int action_rank(RuleAction action) {
     switch (action) {
         case RuleAction::Block: return 5;
@@ -314,201 +250,1024 @@ static RuleAction default_action_for_severity(int severity) {
     return RuleAction::Allow;
 }
 
-static bool bool_value_match(const std::string &value, bool actual) {
-    std::string lower = to_lower_copy(value);
-    if (lower == "true" || lower == "1") return actual;
-    if (lower == "false" || lower == "0") return !actual;
+static bool parse_condition_field(const std::string &name, ConditionField &field) {
+    static const struct {
+        const char *name;
+        ConditionField field;
+    } kFields[] = {
+        {"file.extension", ConditionField::Extension},
+        {"file.path", ConditionField::Path},
+        {"user", ConditionField::User},
+        {"drive_type", ConditionField::DriveType},
+        {"process.name", ConditionField::ProcessName},
+        {"destination", ConditionField::Destination},
+        {"contains_pii", ConditionField::ContainsPii},
+        {"keyword_hit", ConditionField::KeywordHit},
+        {"size_exceeded", ConditionField::SizeExceeded},
+        {"removable_drive", ConditionField::RemovableDrive},
+        {"fingerprint_matched", ConditionField::FingerprintMatched},
+    };
+    std::string lower = to_lower_copy(name);
+    for (const auto &entry : kFields) {
+        if (lower == entry.name) {
+            field = entry.field;
+            return true;
+        }
+    }
     return false;
 }
 
-static bool string_match(const std::string &op, const std::string &actual, const std::string &expected) {
-    std::string op_lower = to_lower_copy(op);
-    if (op_lower.empty() || op_lower == "equals" || op_lower == "eq" || op_lower == "==") {
-        return actual == expected;
+static bool parse_condition_op(const std::string &name, ConditionOp &op) {
+    std::string lower = to_lower_copy(name);
+    if (lower.empty() || lower == "equals" || lower == "eq" || lower == "==") op = ConditionOp::Equals;
+    else if (lower == "contains") op = ConditionOp::Contains;
+    else if (lower == "starts_with") op = ConditionOp::StartsWith;
+    else if (lower == "ends_with") op = ConditionOp::EndsWith;
+    else return false;
+    return true;
+}
+
+static bool is_bool_field(ConditionField field) {
+    return field >= ConditionField::ContainsPii;
+}
+
+// Resolves a condition's field, operator and value once. Returns false with
+// a description in `error` when any of them cannot be understood.
+static bool compile_condition(const RuleCondition &condition, CompiledCondition &out, std::string &error) {
+    if (!parse_condition_field(condition.field, out.field)) {
+        error = "unknown condition field: " + condition.field;
+        return false;
     }
-    if (op_lower == "contains") {
-        return actual.find(expected) != std::string::npos;
+    if (!parse_condition_op(condition.op, out.op)) {
+        error = "unknown condition op: " + condition.op;
+        return false;
     }
-    if (op_lower == "starts_with") {
-        return actual.rfind(expected, 0) == 0;
+    if (!is_bool_field(out.field)) {
+        out.value = condition.value;
+        return true;
     }
-    if (op_lower == "ends_with") {
-        if (expected.size() > actual.size()) return false;
-        return actual.compare(actual.size() - expected.size(), expected.size(), expected) == 0;
+    if (out.op != ConditionOp::Equals) {
+        error = "condition op " + condition.op + " not supported for " + condition.field;
+        return false;
     }
-    return actual == expected;
+    std::string lower = to_lower_copy(condition.value);
+    if (lower == "true" || lower == "1") out.flag = true;
+    else if (lower == "false" || lower == "0") out.flag = false;
+    else {
+        error = "invalid boolean value for " + condition.field + ": " + condition.value;
+        return false;
+    }
+    return true;
 }
 
-static bool match_condition(const RuleCondition &condition, const RuleContext &context) {
-    std::string field = to_lower_copy(condition.field);
-    if (field == "file.extension") {
-        return string_match(condition.op, context.extension, condition.value);
+static const std::string &context_string(ConditionField field, const RuleContext &context) {
+    switch (field) {
+        case ConditionField::Path: return context.path;
+        case ConditionField::User: return context.user;
+        case ConditionField::DriveType: return context.drive_type;
+        case ConditionField::ProcessName: return context.process_name;
+        case ConditionField::Destination: return context.destination;
+        default: return context.extension;
     }
-    if (field == "file.path") {
-        return string_match(condition.op, context.path, condition.value);
+}
+
+static bool context_flag(ConditionField field, const RuleContext &context) {
+    switch (field) {
+        case ConditionField::ContainsPii: return context.contains_pii;
+        case ConditionField::KeywordHit: return context.keyword_hit;
+        case ConditionField::SizeExceeded: return context.size_exceeded;
+        case ConditionField::RemovableDrive: return context.removable_drive;
+        default: return context.fingerprint_matched;
     }
-    if (field == "user") {
-        return string_match(condition.op, context.user, condition.value);
+}
+
+static bool match_condition(const CompiledCondition &condition, const RuleContext &context) {
+    if (is_bool_field(condition.field)) {
+        return context_flag(condition.field, context) == condition.flag;
     }
-    if (field == "drive_type") {
-        return string_match(condition.op, context.drive_type, condition.value);
+    const std::string &actual = context_string(condition.field, context);
+    const std::string &expected = condition.value;
+    switch (condition.op) {
+        case ConditionOp::Equals:
+            return actual == expected;
+        case ConditionOp::Contains:
+            return actual.find(expected) != std::string::npos;
+        case ConditionOp::StartsWith:
+            return actual.compare(0, expected.size(), expected) == 0;
+        case ConditionOp::EndsWith:
+            return expected.size() <= actual.size() &&
+                   actual.compare(actual.size() - expected.size(), expected.size(), expected) == 0;
     }
-    if (field == "process.name") {
-        return string_match(condition.op, context.process_name, condition.value);
+    return false;
+}
+
+static bool read_file(const std::string &path, std::string &body) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) return false;
+    ifs.seekg(0, std::ios::end);
+    std::streamoff size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    body.clear();
+    if (size > 0) {
+        body.resize(static_cast<size_t>(size));
+        ifs.read(&body[0], size);
+        body.resize(static_cast<size_t>(ifs.gcount()));
     }
-    if (field == "destination") {
-        return string_match(condition.op, context.destination, condition.value);
+    return true;
+}
+
+static std::string directory_of(const std::string &path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// Whether a pack name stays inside the directory it is resolved against:
+// relative, without a drive, and with no ".." component.
+static bool pack_name_confined(const std::string &name) {
+    if (name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':')) return false;
+    size_t begin = 0;
+    while (begin <= name.size()) {
+        size_t end = name.find_first_of("/\\", begin);
+        if (end == std::string::npos) end = name.size();
+        if (name.compare(begin, end - begin, "..") == 0) return false;
+        begin = end + 1;
     }
-    if (field == "contains_pii") {
-        return bool_value_match(condition.value, context.contains_pii);
+    return true;
+}
+
+static std::string rule_label(const Rule &rule) {
+    return "rule " + (rule.id.empty() ? rule.name : rule.id);
+}
+
+// Builds the per-rule artifacts: typed conditions and the std::regex. Returns
+// false with `error` set when the rule cannot be used.
+static bool compile_rule(const Rule &rule, CompiledRule &entry, std::string &error) {
+    entry.conditions.resize(rule.conditions.size());
+    for (size_t c = 0; c < rule.conditions.size(); ++c) {
+        if (!compile_condition(rule.conditions[c], entry.conditions[c], error)) {
+            error = rule_label(rule) + ": " + error;
+            return false;
+        }
     }
-    if (field == "keyword_hit") {
-        return bool_value_match(condition.value, context.keyword_hit);
+    if (rule.type == "regex" && !rule.pattern.empty()) {
+        try {
+            entry.regex = LazyRegex::compiled(rule.pattern);
+        } catch (const std::regex_error &e) {
+            error = rule_label(rule) + ": invalid pattern: " + e.what();
+            return false;
+        }
     }
-    if (field == "size_exceeded") {
-        return bool_value_match(condition.value, context.size_exceeded);
+    return true;
+}
+
+namespace {
+
+uint64_t rule_fingerprint(const Rule &rule) {
+    std::hash<std::string> hash;
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](uint64_t value) { h = (h ^ value) * 1099511628211ull; };
+    mix(hash(rule.id));
+    mix(hash(rule.name));
+    mix(hash(rule.type));
+    mix(hash(rule.pattern));
+    mix(static_cast<uint64_t>(rule.priority) << 32 ^ static_cast<uint32_t>(rule.severity));
+    for (const auto &keyword : rule.keywords) mix(hash(keyword));
+    for (const auto &digest : rule.hashes) mix(hash(digest));
+    for (const auto &condition : rule.conditions) {
+        mix(hash(condition.field));
+        mix(hash(condition.op));
+        mix(hash(condition.value));
     }
-    if (field == "removable_drive") {
-        return bool_value_match(condition.value, context.removable_drive);
+    for (RuleAction action : rule.actions) mix(static_cast<uint64_t>(action));
+    mix(rule.enabled);
+    return h;
+}
+
+bool same_conditions(const std::vector<RuleCondition> &a, const std::vector<RuleCondition> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].field != b[i].field || a[i].op != b[i].op || a[i].value != b[i].value) return false;
     }
-    if (field == "fingerprint_matched") {
-        return bool_value_match(condition.value, context.fingerprint_matched);
+    return true;
+}
+
+bool same_rule(const Rule &a, const Rule &b) {
+    return a.id == b.id && a.name == b.name && a.type == b.type && a.priority == b.priority &&
+           a.severity == b.severity && a.pattern == b.pattern && a.keywords == b.keywords &&
+           a.hashes == b.hashes && same_conditions(a.conditions, b.conditions) && a.actions == b.actions &&
+           a.enabled == b.enabled;
+}
+
+// The compiled rules of the engine being replaced, looked up by content.
+class RuleReuse {
+public:
+    RuleReuse(const std::vector<Rule> &rules, const std::vector<CompiledRule> &compiled)
+        : rules_(rules), compiled_(compiled) {
+        by_fingerprint_.reserve(rules.size());
+        for (size_t i = 0; i < rules.size(); ++i) {
+            by_fingerprint_.emplace(rule_fingerprint(rules[i]), static_cast<uint32_t>(i));
+        }
     }
-    return false;
+
+    bool find(const Rule &rule, CompiledRule &out) const {
+        auto range = by_fingerprint_.equal_range(rule_fingerprint(rule));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (same_rule(rules_[it->second], rule)) {
+                out = compiled_[it->second];
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    const std::vector<Rule> &rules_;
+    const std::vector<CompiledRule> &compiled_;
+    std::unordered_multimap<uint64_t, uint32_t> by_fingerprint_;
+};
+
+// Compiles `rule`, or takes its compiled form from `reuse`.
+bool compile_or_reuse(const Rule &rule, const RuleReuse *reuse, CompiledRule &entry, std::string &error,
+                      ReloadStats &stats) {
+    if (reuse && reuse->find(rule, entry)) {
+        ++stats.reused_rules;
+        return true;
+    }
+    ++stats.compiled_rules;
+    return compile_rule(rule, entry, error);
+}
+
+// A rule pack parsed and compiled once, shared by every engine that loads
+// the same pack content.
+struct CompiledPack {
+    std::vector<Rule> rules;
+    std::vector<CompiledRule> compiled;
+    std::vector<std::string> errors;
+};
+
+struct PackCacheEntry {
+    size_t size = 0;
+    std::shared_ptr<const CompiledPack> pack;
+};
+
+std::mutex g_pack_cache_mutex;
+// Keyed by FNV-1a of the pack bytes; holds the packs of the latest load.
+std::unordered_map<uint64_t, PackCacheEntry> g_pack_cache;
+
+struct PackResult {
+    bool read = false;
+    uint64_t hash = 0;
+    size_t size = 0;
+    std::shared_ptr<const CompiledPack> pack;
+    ReloadStats stats;
+    std::string error;
+};
+
+PackResult load_pack(const std::string &path, const RuleReuse *reuse) {
+    PackResult result;
+    std::string body;
+    if (!read_file(path, body)) {
+        result.error = "cannot read " + path;
+        return result;
+    }
+    result.read = true;
+    result.hash = fnv1a64(body.data(), body.size());
+    result.size = body.size();
+    {
+        std::lock_guard<std::mutex> lock(g_pack_cache_mutex);
+        auto it = g_pack_cache.find(result.hash);
+        if (it != g_pack_cache.end() && it->second.size == result.size) {
+            result.pack = it->second.pack;
+            result.stats.reused_rules = result.pack->rules.size();
+            return result;
+        }
+    }
+    std::vector<Rule> parsed;
+    std::string error;
+    if (!parse_rules_json(body, parsed, &error)) {
+        result.error = path + ": invalid JSON: " + error;
+        return result;
+    }
+    auto pack = std::make_shared<CompiledPack>();
+    for (auto &rule : parsed) {
+        CompiledRule entry;
+        if (!compile_or_reuse(rule, reuse, entry, error, result.stats)) {
+            pack->errors.push_back(path + ": " + error);
+            continue;
+        }
+        pack->rules.push_back(std::move(rule));
+        pack->compiled.push_back(std::move(entry));
+    }
+    result.pack = std::move(pack);
+    return result;
 }
 
-bool RuleEngine::load_from_file(const std::string &path) {
-    std::ifstream ifs(path);
-    if (!ifs) {
+}  // namespace
+
+bool RuleEngine::load_from_file(const std::string &path, const std::vector<Rule> &defaults,
+                                const RuleEngine *previous) {
+    std::string body;
+    if (!read_file(path, body)) {
         rules_.clear();
+        compile();
         return false;
     }
-    std::ostringstream oss;
-    oss << ifs.rdbuf();
-    return load_from_string(oss.str());
+    return load_policy(body, directory_of(path), false, defaults, previous);
+}
+
+bool RuleEngine::load_from_string(const std::string &body, const std::vector<Rule> &defaults,
+                                  const RuleEngine *previous) {
+    return load_policy(body, directory_of(g_rules_path), true, defaults, previous);
 }
 
-bool RuleEngine::load_from_string(const std::string &body) {
+bool RuleEngine::load_policy(const std::string &body, const std::string &pack_dir, bool confine_packs,
+                             const std::vector<Rule> &defaults, const RuleEngine *previous) {
+    std::vector<Rule> inline_rules;
+    std::vector<std::string> pack_names;
+    std::vector<std::string> pack_errors;
     std::string trimmed = trim_copy(body);
-    if (trimmed.empty()) {
-        rules_.clear();
-        return true;
-    }
     if (!trimmed.empty() && (trimmed[0] == '{' || trimmed[0] == '[')) {
-        rules_ = parse_json_rules(body);
-    } else {
-        rules_ = parse_yaml_rules(body);
+        JsonDocument doc;
+        std::string error;
+        if (!doc.parse(body, &error)) {
+            rules_.clear();
+            compile();
+            load_errors_.push_back("invalid JSON: " + error);
+            return false;
+        }
+        rules_from_document(doc.root(), inline_rules);
+        for (const auto &item : doc.root().get("rule_packs").elements()) {
+            std::string name = item.as_string();
+            if (name.empty()) continue;
+            if (confine_packs && !pack_name_confined(name)) {
+                pack_errors.push_back("rule pack " + name + ": outside the rules directory");
+                continue;
+            }
+            pack_names.push_back(std::move(name));
+        }
+    } else if (!trimmed.empty()) {
+        inline_rules = parse_yaml_rules(body);
+    }
+
+    // Packs are read, parsed and compiled while the inline rules compile
+    // here, by at most one loader per core taking them in list order.
+    std::unique_ptr<RuleReuse> reuse;
+    if (previous) reuse = std::make_unique<RuleReuse>(previous->rules_, previous->compiled_);
+    std::vector<std::string> pack_paths;
+    for (const auto &name : pack_names) {
+        bool absolute = name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':');
+        pack_paths.push_back(absolute ? name : pack_dir + name);
     }
+    std::vector<std::promise<PackResult>> loaded(pack_paths.size());
+    std::vector<std::future<PackResult>> pending;
+    pending.reserve(loaded.size());
+    for (auto &result : loaded) pending.push_back(result.get_future());
+    std::atomic<size_t> next_pack{0};
+    auto load_packs = [&]() {
+        for (size_t i = next_pack++; i < pack_paths.size(); i = next_pack++) {
+            try {
+                loaded[i].set_value(load_pack(pack_paths[i], reuse.get()));
+            } catch (...) {
+                loaded[i].set_exception(std::current_exception());
+            }
+        }
+    };
+    const size_t loader_count =
+        std::min<size_t>(pack_paths.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::future<void>> loaders;
+    for (size_t i = 0; i < loader_count; ++i) loaders.push_back(std::async(std::launch::async, load_packs));
+
+    load_errors_ = std::move(pack_errors);
+    pack_sources_.clear();
+    reload_stats_ = ReloadStats{};
+    rules_.clear();
+    compiled_.clear();
+    // Sources merge in order: inline rules, packs as listed, then defaults.
+    // An id defined by an earlier source hides later rules with that id.
+    std::unordered_set<std::string> defined;
+    std::vector<std::string> source_ids;
+    auto take = [&](Rule rule, CompiledRule entry) {
+        if (!rule.id.empty()) {
+            if (defined.count(rule.id)) return;
+            source_ids.push_back(rule.id);
+        }
+        rules_.push_back(std::move(rule));
+        compiled_.push_back(std::move(entry));
+    };
+    auto close_source = [&]() {
+        defined.insert(source_ids.begin(), source_ids.end());
+        source_ids.clear();
+    };
+    auto take_uncompiled = [&](const std::vector<Rule> &rules) {
+        for (const auto &rule : rules) {
+            CompiledRule entry;
+            std::string error;
+            if (!compile_or_reuse(rule, reuse.get(), entry, error, reload_stats_)) {
+                load_errors_.push_back(error);
+                continue;
+            }
+            take(rule, std::move(entry));
+        }
+        close_source();
+    };
+
+    take_uncompiled(inline_rules);
+    std::unordered_map<uint64_t, PackCacheEntry> used;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        PackResult result = pending[i].get();
+        pack_sources_.push_back({pack_paths[i], result.read, result.size, result.hash});
+        reload_stats_.reused_rules += result.stats.reused_rules;
+        reload_stats_.compiled_rules += result.stats.compiled_rules;
+        if (!result.pack) {
+            load_errors_.push_back("rule pack " + pack_names[i] + ": " + result.error);
+            continue;
+        }
+        const CompiledPack &pack = *result.pack;
+        load_errors_.insert(load_errors_.end(), pack.errors.begin(), pack.errors.end());
+        for (size_t r = 0; r < pack.rules.size(); ++r) {
+            take(pack.rules[r], pack.compiled[r]);
+        }
+        close_source();
+        used[result.hash] = PackCacheEntry{result.size, result.pack};
+    }
+    if (!pack_names.empty()) {
+        std::lock_guard<std::mutex> lock(g_pack_cache_mutex);
+        g_pack_cache.swap(used);
+    }
+    take_uncompiled(defaults);
+    build_indexes(previous);
     return true;
 }
 
 void RuleEngine::load_from_rules(const std::vector<Rule> &rules) {
     rules_ = rules;
+    compile();
 }
 
-std::vector<RuleMatch> RuleEngine::scan_text(const std::string &text) const {
-    std::vector<RuleMatch> hits;
-    if (text.empty()) return hits;
-    std::string lower = to_lower_copy(text);
-    for (const auto &rule : rules_) {
-        if (rule.type == "regex" && !rule.pattern.empty()) {
-            try {
-                std::regex re(rule.pattern, std::regex::ECMAScript);
-                auto begin = std::sregex_iterator(text.begin(), text.end(), re);
-                auto end = std::sregex_iterator();
-                size_t count = static_cast<size_t>(std::distance(begin, end));
-                if (count > 0) {
-                    RuleMatch match;
-                    match.rule_id = rule.id;
-                    match.rule_name = rule.name;
-                    match.type = rule.type;
-                    match.priority = rule.priority;
-                    match.severity = rule.severity;
-                    match.match_count = count;
-                    match.match = begin->str();
-                    match.confidence = compute_confidence(rule, count);
-                    hits.push_back(match);
-                }
-            } catch (const std::regex_error &) {
+void RuleEngine::compile() {
+    load_errors_.clear();
+    pack_sources_.clear();
+    reload_stats_ = ReloadStats{};
+    std::vector<Rule> accepted;
+    std::vector<CompiledRule> compiled;
+    accepted.reserve(rules_.size());
+    compiled.reserve(rules_.size());
+    for (auto &rule : rules_) {
+        CompiledRule entry;
+        std::string error;
+        ++reload_stats_.compiled_rules;
+        if (!compile_rule(rule, entry, error)) {
+            load_errors_.push_back(error);
+            continue;
+        }
+        accepted.push_back(std::move(rule));
+        compiled.push_back(std::move(entry));
+    }
+    rules_.swap(accepted);
+    compiled_.swap(compiled);
+    build_indexes();
+}
+
+std::shared_ptr<const LazyRegex> LazyRegex::compiled(const std::string &pattern) {
+    auto lazy = std::make_shared<LazyRegex>(pattern);
+    std::call_once(lazy->once_, [&] {
+        lazy->regex_ = std::make_unique<const std::regex>(pattern, std::regex::ECMAScript);
+    });
+    return lazy;
+}
+
+std::shared_ptr<const LazyRegex> LazyRegex::deferred(const std::string &pattern) {
+    return std::make_shared<LazyRegex>(pattern);
+}
+
+const std::regex *LazyRegex::get() const {
+    std::call_once(once_, [this] {
+        try {
+            regex_ = std::make_unique<const std::regex>(pattern_, std::regex::ECMAScript);
+        } catch (const std::regex_error &) {
+        }
+    });
+    return regex_.get();
+}
+
+// Used when restoring a policy image, with in_regex_set already known: rules
+// the automaton pre-filters compile on their first candidate match, the rest
+// run on every scan and compile now.
+bool RuleEngine::attach_regexes(std::string &error) {
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        const Rule &rule = rules_[i];
+        if (rule.type != "regex" || rule.pattern.empty()) continue;
+        if (compiled_[i].in_regex_set) {
+            compiled_[i].regex = LazyRegex::deferred(rule.pattern);
+            continue;
+        }
+        try {
+            compiled_[i].regex = LazyRegex::compiled(rule.pattern);
+        } catch (const std::regex_error &e) {
+            error = rule_label(rule) + ": invalid pattern: " + e.what();
+            return false;
+        }
+    }
+    return true;
+}
+
+void RuleEngine::build_indexes(const RuleEngine *previous) {
+    reload_stats_.reused_regex_set = previous && reuse_regex_set(*previous);
+    if (!reload_stats_.reused_regex_set) build_regex_set();
+    reload_stats_.reused_keywords = previous && reuse_keywords(*previous);
+    if (!reload_stats_.reused_keywords) build_keywords();
+    reload_stats_.reused_hashes = previous && reuse_hashes(*previous);
+    if (!reload_stats_.reused_hashes) build_hashes();
+    build_rule_maps();
+    build_decision_tables();
+}
+
+// Indexes of the rules in `rules` that feed one of the shared indexes, in
+// rule order.
+template <typename Pred>
+static std::vector<uint32_t> rules_where(const std::vector<Rule> &rules, Pred pred) {
+    std::vector<uint32_t> indexes;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (pred(i)) indexes.push_back(static_cast<uint32_t>(i));
+    }
+    return indexes;
+}
+
+// Pairs up the rules feeding an index in `previous` and here. Succeeds when
+// both sequences have equal inputs, filling `remap` (previous rule index ->
+// rule index) for the paired rules.
+template <typename Same>
+static bool pair_rules(const std::vector<uint32_t> &before, const std::vector<uint32_t> &now, size_t previous_size,
+                       Same same, std::vector<uint32_t> &remap) {
+    if (before.size() != now.size()) return false;
+    for (size_t k = 0; k < now.size(); ++k) {
+        if (!same(before[k], now[k])) return false;
+    }
+    remap.assign(previous_size, KeywordMatcher::npos);
+    for (size_t k = 0; k < now.size(); ++k) remap[before[k]] = now[k];
+    return true;
+}
+
+bool RuleEngine::reuse_regex_set(const RuleEngine &previous) {
+    auto before = rules_where(previous.rules_, [&](size_t i) { return previous.compiled_[i].regex != nullptr; });
+    auto now = rules_where(rules_, [&](size_t i) { return compiled_[i].regex != nullptr; });
+    std::vector<uint32_t> remap;
+    auto same = [&](uint32_t b, uint32_t n) { return previous.rules_[b].pattern == rules_[n].pattern; };
+    if (!pair_rules(before, now, previous.rules_.size(), same, remap)) return false;
+    regex_set_ = previous.regex_set_;
+    regex_set_.remap_ids(remap);
+    for (size_t k = 0; k < now.size(); ++k) {
+        compiled_[now[k]].in_regex_set = previous.compiled_[before[k]].in_regex_set;
+    }
+    return true;
+}
+
+bool RuleEngine::reuse_keywords(const RuleEngine &previous) {
+    std::vector<std::string> content;
+    for (const auto &kw : g_content_keywords) {
+        if (!kw.empty()) content.push_back(kw);
+    }
+    if (content != previous.content_keywords_) return false;
+    auto before = rules_where(previous.rules_, [&](size_t i) { return previous.rules_[i].type == "keyword"; });
+    auto now = rules_where(rules_, [&](size_t i) { return rules_[i].type == "keyword"; });
+    std::vector<uint32_t> remap;
+    auto same = [&](uint32_t b, uint32_t n) { return previous.rules_[b].keywords == rules_[n].keywords; };
+    if (!pair_rules(before, now, previous.rules_.size(), same, remap)) return false;
+    keywords_ = previous.keywords_;
+    keyword_owner_offset_ = previous.keyword_owner_offset_;
+    keyword_owners_ = previous.keyword_owners_;
+    for (auto &owner : keyword_owners_) owner.first = remap[owner.first];
+    content_keyword_rank_ = previous.content_keyword_rank_;
+    content_keywords_ = previous.content_keywords_;
+    return true;
+}
+
+bool RuleEngine::reuse_hashes(const RuleEngine &previous) {
+    auto before = rules_where(previous.rules_, [&](size_t i) { return previous.rules_[i].type == "hash"; });
+    auto now = rules_where(rules_, [&](size_t i) { return rules_[i].type == "hash"; });
+    std::vector<uint32_t> remap;
+    auto same = [&](uint32_t b, uint32_t n) { return previous.rules_[b].hashes == rules_[n].hashes; };
+    if (!pair_rules(before, now, previous.rules_.size(), same, remap)) return false;
+    hashes_ = previous.hashes_;
+    hashes_.transform_values([&](uint64_t value) {
+        return static_cast<uint64_t>(remap[value >> 32]) << 32 | (value & 0xFFFFFFFFu);
+    });
+    // The digests were parsed before; only their load errors are repeated.
+    for (uint32_t i : now) {
+        for (const auto &hex : rules_[i].hashes) {
+            HashIndex::Digest digest;
+            if (!HashIndex::parse_hex(hex, digest)) {
+                load_errors_.push_back(rule_label(rules_[i]) + ": invalid hash: " + hex);
+            }
+        }
+    }
+    return true;
+}
+
+void RuleEngine::build_regex_set() {
+    regex_set_.clear();
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        if (compiled_[i].regex) {
+            compiled_[i].in_regex_set = regex_set_.add(rules_[i].pattern, static_cast<uint32_t>(i));
+        }
+    }
+    regex_set_.build();
+}
+
+void RuleEngine::build_keywords() {
+    keywords_.clear();
+    std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t>>> owners;
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        if (rules_[i].type != "keyword") continue;
+        const auto &kws = rules_[i].keywords;
+        for (size_t k = 0; k < kws.size(); ++k) {
+            uint32_t id = keywords_.add(kws[k]);
+            if (id == KeywordMatcher::npos) continue;
+            owners.push_back({id, {static_cast<uint32_t>(i), static_cast<uint32_t>(k)}});
+        }
+    }
+    content_keywords_.clear();
+    std::vector<std::pair<uint32_t, uint32_t>> ranks;
+    for (const auto &kw : g_content_keywords) {
+        uint32_t id = keywords_.add(kw);
+        if (id == KeywordMatcher::npos) continue;
+        ranks.push_back({id, static_cast<uint32_t>(content_keywords_.size())});
+        content_keywords_.push_back(kw);
+    }
+    keywords_.build();
+
+    std::sort(owners.begin(), owners.end());
+    keyword_owner_offset_.assign(keywords_.pattern_count() + 1, 0);
+    keyword_owners_.clear();
+    keyword_owners_.reserve(owners.size());
+    for (const auto &owner : owners) {
+        keyword_owner_offset_[owner.first + 1]++;
+        keyword_owners_.push_back(owner.second);
+    }
+    for (size_t p = 0; p < keywords_.pattern_count(); ++p) {
+        keyword_owner_offset_[p + 1] += keyword_owner_offset_[p];
+    }
+    content_keyword_rank_.assign(keywords_.pattern_count(), KeywordMatcher::npos);
+    for (const auto &rank : ranks) {
+        content_keyword_rank_[rank.first] = std::min(content_keyword_rank_[rank.first], rank.second);
+    }
+}
+
+void RuleEngine::build_hashes() {
+    hashes_.clear();
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        if (rules_[i].type != "hash") continue;
+        const auto &list = rules_[i].hashes;
+        for (size_t h = 0; h < list.size(); ++h) {
+            HashIndex::Digest digest;
+            if (!HashIndex::parse_hex(list[h], digest)) {
+                load_errors_.push_back(rule_label(rules_[i]) + ": invalid hash: " + list[h]);
                 continue;
             }
-        } else if (rule.type == "keyword" && !rule.keywords.empty()) {
-            size_t count = 0;
-            std::string first_hit;
-            for (const auto &kw : rule.keywords) {
-                auto kw_lower = to_lower_copy(kw);
-                if (!kw_lower.empty() && lower.find(kw_lower) != std::string::npos) {
-                    count++;
-                    if (first_hit.empty()) first_hit = kw;
-                }
+            hashes_.add(digest, (static_cast<uint64_t>(i) << 32) | h);
+        }
+    }
+    hashes_.build();
+}
+
+void RuleEngine::build_rule_maps() {
+    static std::atomic<uint64_t> next_generation{0};
+    generation_ = ++next_generation;
+    rules_by_id_.clear();
+    rules_by_name_.clear();
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        const Rule &rule = rules_[i];
+        if (!rule.id.empty()) rules_by_id_[rule.id].push_back(static_cast<uint32_t>(i));
+        if (!rule.name.empty()) rules_by_name_[rule.name].push_back(static_cast<uint32_t>(i));
+    }
+}
+
+void RuleEngine::build_decision_tables() {
+    eval_order_.resize(rules_.size());
+    for (size_t i = 0; i < rules_.size(); ++i) eval_order_[i] = static_cast<uint32_t>(i);
+    std::stable_sort(eval_order_.begin(), eval_order_.end(), [this](uint32_t a, uint32_t b) {
+        return rules_[a].priority > rules_[b].priority;
+    });
+    rank_.assign(rules_.size(), 0);
+    rank_severity_bound_.assign(rules_.size(), std::numeric_limits<int>::min());
+    condition_rules_.clear();
+    for (size_t r = rules_.size(); r-- > 0;) {
+        const Rule &rule = rules_[eval_order_[r]];
+        rank_[eval_order_[r]] = static_cast<uint32_t>(r);
+        int bound = std::numeric_limits<int>::min();
+        if (rule.enabled) {
+            // Severity 0 defers to the highest hit severity for the rule's id
+            // or name, which any rule that has one can pick up.
+            bound = rule.severity != 0 || (rule.id.empty() && rule.name.empty())
+                        ? rule.severity
+                        : std::numeric_limits<int>::max();
+        }
+        if (r + 1 < rules_.size() && rules_[eval_order_[r + 1]].priority == rule.priority) {
+            bound = std::max(bound, rank_severity_bound_[r + 1]);
+        }
+        rank_severity_bound_[r] = bound;
+    }
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        const Rule &rule = rules_[eval_order_[r]];
+        if (rule.enabled && !is_content_rule(rule) && !rule.conditions.empty()) {
+            condition_rules_.push_back(static_cast<uint32_t>(r));
+        }
+    }
+    alias_offset_.assign(rules_.size() + 1, 0);
+    alias_.clear();
+    std::vector<uint32_t> group;
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        group.clear();
+        if (!rules_[i].id.empty()) {
+            const auto &same = rules_by_id_[rules_[i].id];
+            group.insert(group.end(), same.begin(), same.end());
+        }
+        if (!rules_[i].name.empty()) {
+            const auto &same = rules_by_name_[rules_[i].name];
+            group.insert(group.end(), same.begin(), same.end());
+        }
+        std::sort(group.begin(), group.end());
+        group.erase(std::unique(group.begin(), group.end()), group.end());
+        alias_.insert(alias_.end(), group.begin(), group.end());
+        alias_offset_[i + 1] = static_cast<uint32_t>(alias_.size());
+    }
+}
+
+std::vector<RuleMatch> RuleEngine::scan_text(const std::string &text,
+                                             std::string *content_keyword) const {
+    if (content_keyword) content_keyword->clear();
+    if (text.empty()) return {};
+
+    // Single pass over the text for every keyword of every rule.
+    thread_local KeywordMatcher::Scratch scratch;
+    keywords_.begin(scratch);
+    if (!keywords_.empty()) keywords_.feed(0, text.data(), text.size(), scratch);
+
+    // One linear pass decides which automaton-backed regex rules match at
+    // all; only those (and fallback patterns) run std::regex for the count
+    // and first match.
+    std::vector<uint32_t> regex_candidates;
+    regex_set_.match(text.data(), text.size(), regex_candidates);
+
+    std::vector<RegexHit> regex_hits;
+    size_t regex_cursor = 0;
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        const auto &lazy = compiled_[i].regex;
+        if (rules_[i].type != "regex" || !lazy) continue;
+        if (compiled_[i].in_regex_set) {
+            while (regex_cursor < regex_candidates.size() && regex_candidates[regex_cursor] < i) {
+                ++regex_cursor;
             }
-            if (count > 0) {
-                RuleMatch match;
-                match.rule_id = rule.id;
-                match.rule_name = rule.name;
-                match.type = rule.type;
-                match.priority = rule.priority;
-                match.severity = rule.severity;
-                match.match_count = count;
-                match.match = first_hit;
-                match.confidence = compute_confidence(rule, count);
-                hits.push_back(match);
+            if (regex_cursor == regex_candidates.size() || regex_candidates[regex_cursor] != i) {
+                continue;
             }
         }
+        const std::regex *re = lazy->get();
+        if (!re) continue;
+        // Only the count, up to the match limit, and the first match are kept.
+        RegexHit hit{static_cast<uint32_t>(i), 0, {}};
+        for (std::sregex_iterator it(text.begin(), text.end(), *re), end; it != end; ++it) {
+            if (hit.count++ == 0) hit.first = it->str();
+            if (hit.count >= g_rule_match_limit) break;
+        }
+        if (hit.count > 0) regex_hits.push_back(std::move(hit));
+    }
+    return collect_hits(scratch.hits, regex_hits, content_keyword);
+}
+
+std::vector<RuleMatch> RuleEngine::collect_hits(const std::vector<uint32_t> &keyword_ids,
+                                                const std::vector<RegexHit> &regex_hits,
+                                                std::string *content_keyword) const {
+    // Owner hits sorted by rule, then by keyword position.
+    std::vector<std::pair<uint32_t, uint32_t>> keyword_hits;
+    uint32_t best_rank = KeywordMatcher::npos;
+    for (uint32_t id : keyword_ids) {
+        keyword_hits.insert(keyword_hits.end(),
+                            keyword_owners_.begin() + keyword_owner_offset_[id],
+                            keyword_owners_.begin() + keyword_owner_offset_[id + 1]);
+        best_rank = std::min(best_rank, content_keyword_rank_[id]);
+    }
+    std::sort(keyword_hits.begin(), keyword_hits.end());
+    if (content_keyword && best_rank != KeywordMatcher::npos) {
+        *content_keyword = content_keywords_[best_rank];
+    }
+
+    // A rule is either a keyword or a regex rule, so the two sorted runs
+    // merge into rule order.
+    std::vector<RuleMatch> hits;
+    size_t cursor = 0;
+    size_t regex_cursor = 0;
+    while (cursor < keyword_hits.size() || regex_cursor < regex_hits.size()) {
+        if (regex_cursor < regex_hits.size() &&
+            (cursor == keyword_hits.size() || regex_hits[regex_cursor].rule < keyword_hits[cursor].first)) {
+            const RegexHit &regex = regex_hits[regex_cursor++];
+            RuleMatch match = make_match(regex.rule, regex.count);
+            match.match = regex.first;
+            hits.push_back(std::move(match));
+            continue;
+        }
+        const uint32_t rule = keyword_hits[cursor].first;
+        size_t first = cursor;
+        while (cursor < keyword_hits.size() && keyword_hits[cursor].first == rule) ++cursor;
+        RuleMatch match = make_match(rule, cursor - first);
+        match.match = rules_[rule].keywords[keyword_hits[first].second];
+        hits.push_back(std::move(match));
     }
     return hits;
 }
 
+RuleEngine::TextStream::TextStream(const RuleEngine &engine, size_t overlap)
+    : engine_(engine), window_(overlap) {
+    engine_.keywords_.begin(keyword_scratch_);
+    for (size_t i = 0; i < engine_.rules_.size(); ++i) {
+        if (engine_.rules_[i].type == "regex" && engine_.compiled_[i].regex) {
+            regexes_.push_back({static_cast<uint32_t>(i), 0, {}});
+        }
+    }
+    cursors_.resize(regexes_.size());
+}
+
+void RuleEngine::TextStream::feed(const char *data, size_t len) {
+    if (len == 0) return;
+    if (!engine_.keywords_.empty()) {
+        keyword_state_ = engine_.keywords_.feed(keyword_state_, data, len, keyword_scratch_);
+    }
+    if (regexes_.empty()) return;
+    window_.append(data, len);
+    search(false);
+}
+
+std::vector<RuleMatch> RuleEngine::TextStream::finish(std::string *content_keyword) {
+    if (content_keyword) content_keyword->clear();
+    search(true);
+    std::vector<RegexHit> regex_hits;
+    for (auto &regex : regexes_) {
+        if (regex.count > 0) regex_hits.push_back(std::move(regex));
+    }
+    regexes_.clear();
+    cursors_.clear();
+    return engine_.collect_hits(keyword_scratch_.hits, regex_hits, content_keyword);
+}
+
+// Same candidate filtering as scan_text, over the current window.
+void RuleEngine::TextStream::search(bool final) {
+    if (regexes_.empty() || !window_.ready(final)) return;
+    candidates_.clear();
+    engine_.regex_set_.match(window_.data().data(), window_.data().size(), candidates_);
+    size_t next = 0;
+    for (size_t r = 0; r < regexes_.size(); ++r) {
+        RegexHit &regex = regexes_[r];
+        const CompiledRule &compiled = engine_.compiled_[regex.rule];
+        if (compiled.in_regex_set) {
+            while (next < candidates_.size() && candidates_[next] < regex.rule) ++next;
+            if (next == candidates_.size() || candidates_[next] != regex.rule) {
+                window_.skip(cursors_[r], final);
+                continue;
+            }
+        }
+        const std::regex *re = compiled.regex->get();
+        if (!re || regex.count >= g_rule_match_limit) {
+            window_.skip(cursors_[r], final);
+            continue;
+        }
+        window_.search(*re, cursors_[r], final, [&](const std::smatch &m, uint64_t) {
+            if (regex.count++ == 0) regex.first = m.str();
+            return regex.count < g_rule_match_limit;
+        });
+    }
+}
+
 std::vector<RuleMatch> RuleEngine::scan_hashes(const std::string &full_hash,
                                                const std::string &partial_hash) const {
     std::vector<RuleMatch> hits;
-    if (full_hash.empty() && partial_hash.empty()) return hits;
-    for (const auto &rule : rules_) {
-        if (rule.type != "hash" || rule.hashes.empty()) continue;
-        for (const auto &hash : rule.hashes) {
-            if ((!full_hash.empty() && hash == full_hash) ||
-                (!partial_hash.empty() && hash == partial_hash)) {
-                RuleMatch match;
-                match.rule_id = rule.id;
-                match.rule_name = rule.name;
-                match.type = rule.type;
-                match.priority = rule.priority;
-                match.severity = rule.severity;
-                match.match_count = 1;
-                match.match = hash;
-                match.confidence = compute_confidence(rule, 1);
-                hits.push_back(match);
-                break;
-            }
+    HashIndex::Digest digest;
+    HashIndex::Range full(nullptr, nullptr);
+    HashIndex::Range partial(nullptr, nullptr);
+    if (HashIndex::parse_hex(full_hash, digest)) full = hashes_.lookup(digest);
+    if (HashIndex::parse_hex(partial_hash, digest)) partial = hashes_.lookup(digest);
+
+    // Both runs are sorted by rule then position, so merging them yields each
+    // rule once, in rule order, with its first matching hash.
+    while (full.first != full.second || partial.first != partial.second) {
+        uint64_t next;
+        if (partial.first == partial.second ||
+            (full.first != full.second && *full.first < *partial.first)) {
+            next = *full.first;
+        } else {
+            next = *partial.first;
         }
+        const uint64_t rule_index = next >> 32;
+        while (full.first != full.second && (*full.first >> 32) == rule_index) ++full.first;
+        while (partial.first != partial.second && (*partial.first >> 32) == rule_index) ++partial.first;
+
+        RuleMatch match = make_match(rule_index, 1);
+        match.match = rules_[rule_index].hashes[next & 0xFFFFFFFFu];
+        hits.push_back(std::move(match));
     }
     return hits;
 }
 
+RuleMatch RuleEngine::make_match(size_t index, size_t count) const {
+    const Rule &rule = rules_[index];
+    RuleMatch match;
+    match.rule_id = rule.id;
+    match.rule_name = rule.name;
+    match.type = rule.type;
+    match.priority = rule.priority;
+    match.severity = rule.severity;
+    match.match_count = count;
+    match.confidence = compute_confidence(rule, count);
+    match.rule_index = static_cast<uint32_t>(index);
+    match.generation = generation_;
+    return match;
+}
+
+namespace {
+
+// Per-thread hit state for evaluate(): stamp[i] == epoch marks rule i as hit,
+// severity[i] then holds the highest severity among its hits.
+struct EvalScratch {
+    std::vector<uint32_t> stamp;
+    std::vector<int> severity;
+    std::vector<uint32_t> touched;
+    uint32_t epoch = 0;
+};
+
+}  // namespace
+
 RuleDecision RuleEngine::evaluate(const RuleContext &context,
                                   const std::vector<RuleMatch> &matches) const {
-    RuleDecision best;
-    bool has_best = false;
-    for (const auto &rule : rules_) {
-        if (!rule.enabled) continue;
-        bool matched = false;
-        if (rule.type == "regex" || rule.type == "keyword" || rule.type == "hash") {
-            for (const auto &hit : matches) {
-                if ((!rule.id.empty() && hit.rule_id == rule.id) ||
-                    (!rule.name.empty() && hit.rule_name == rule.name)) {
-                    matched = true;
-                    break;
-                }
+    thread_local EvalScratch scratch;
+    if (scratch.stamp.size() < rules_.size()) {
+        scratch.stamp.resize(rules_.size(), 0);
+        scratch.severity.resize(rules_.size(), 0);
+    }
+    if (++scratch.epoch == 0) {
+        std::fill(scratch.stamp.begin(), scratch.stamp.end(), 0u);
+        scratch.epoch = 1;
+    }
+    scratch.touched.clear();
+    auto mark = [&](uint32_t i, int severity) {
+        if (scratch.stamp[i] != scratch.epoch) {
+            scratch.stamp[i] = scratch.epoch;
+            scratch.severity[i] = 0;
+            if (rules_[i].enabled && is_content_rule(rules_[i])) scratch.touched.push_back(rank_[i]);
+        }
+        scratch.severity[i] = std::max(scratch.severity[i], severity);
+    };
+    for (const auto &hit : matches) {
+        if (hit.generation == generation_ && hit.rule_index < rules_.size()) {
+            for (uint32_t a = alias_offset_[hit.rule_index]; a < alias_offset_[hit.rule_index + 1]; ++a) {
+                mark(alias_[a], hit.severity);
+            }
+            continue;
+        }
+        if (!hit.rule_id.empty()) {
+            auto it = rules_by_id_.find(hit.rule_id);
+            if (it != rules_by_id_.end()) {
+                for (uint32_t i : it->second) mark(i, hit.severity);
+            }
+        }
+        if (!hit.rule_name.empty()) {
+            auto it = rules_by_name_.find(hit.rule_name);
+            if (it != rules_by_name_.end()) {
+                for (uint32_t i : it->second) mark(i, hit.severity);
             }
-        } else if (!rule.conditions.empty()) {
-            matched = true;
         }
+    }
+    std::sort(scratch.touched.begin(), scratch.touched.end());
 
-        if (!matched) {
-            continue;
+    // Candidates are the hit content rules plus the condition-only rules,
+    // visited by rank. Within one priority ties resolve to the lowest rule
+    // index, as a full scan would; once nothing left can outrank the best
+    // decision the walk stops.
+    size_t best_index = rules_.size();
+    int best_priority = 0;
+    int best_severity = 0;
+    RuleAction best_action = RuleAction::Allow;
+    size_t t = 0;
+    size_t c = 0;
+    while (t < scratch.touched.size() || c < condition_rules_.size()) {
+        uint32_t rank;
+        if (c == condition_rules_.size() ||
+            (t < scratch.touched.size() && scratch.touched[t] < condition_rules_[c])) {
+            rank = scratch.touched[t++];
+        } else {
+            rank = condition_rules_[c++];
+        }
+        const uint32_t i = eval_order_[rank];
+        const Rule &rule = rules_[i];
+        if (best_index != rules_.size()) {
+            if (rule.priority < best_priority) break;
+            const int bound = rank_severity_bound_[rank];
+            if (best_severity > bound ||
+                (best_severity == bound && action_rank(best_action) == action_rank(RuleAction::Block))) {
+                break;
+            }
         }
 
-        for (const auto &cond : rule.conditions) {
+        bool matched = true;
+        for (const auto &cond : compiled_[i].conditions) {
             if (!match_condition(cond, context)) {
                 matched = false;
                 break;
@@ -518,53 +1277,41 @@ RuleDecision RuleEngine::evaluate(const RuleContext &context,
             continue;
         }
 
-        RuleDecision decision;
-        decision.rule_id = rule.id;
-        decision.rule_name = rule.name;
-        decision.priority = rule.priority;
-        decision.severity = rule.severity;
-        if (decision.severity == 0) {
-            for (const auto &hit : matches) {
-                if ((!rule.id.empty() && hit.rule_id == rule.id) ||
-                    (!rule.name.empty() && hit.rule_name == rule.name)) {
-                    decision.severity = std::max(decision.severity, hit.severity);
-                }
-            }
-        }
-        if (!rule.actions.empty()) {
-            decision.action = rule.actions.front();
-        } else {
-            decision.action = default_action_for_severity(decision.severity);
-        }
-        if (!rule.name.empty()) {
-            decision.reason = rule.name;
-        } else if (!rule.id.empty()) {
-            decision.reason = rule.id;
-        } else {
-            decision.reason = "rule_match";
+        int severity = rule.severity;
+        if (severity == 0 && scratch.stamp[i] == scratch.epoch) {
+            severity = scratch.severity[i];
         }
+        RuleAction action = !rule.actions.empty() ? rule.actions.front() : default_action_for_severity(severity);
 
-        if (!has_best) {
-            best = decision;
-            has_best = true;
-            continue;
-        }
-        if (decision.priority > best.priority) {
-            best = decision;
-            continue;
-        }
-        if (decision.priority == best.priority && decision.severity > best.severity) {
-            best = decision;
-            continue;
-        }
-        if (decision.priority == best.priority && decision.severity == best.severity &&
-            action_rank(decision.action) > action_rank(best.action)) {
-            best = decision;
+        if (best_index == rules_.size() || rule.priority > best_priority ||
+            (rule.priority == best_priority && severity > best_severity) ||
+            (rule.priority == best_priority && severity == best_severity &&
+             action_rank(action) > action_rank(best_action))) {
+            best_index = i;
+            best_priority = rule.priority;
+            best_severity = severity;
+            best_action = action;
         }
     }
-    if (!has_best) {
+
+    RuleDecision best;
+    if (best_index == rules_.size()) {
         best.action = RuleAction::Allow;
         best.reason = "no_match";
+        return best;
+    }
+    const Rule &rule = rules_[best_index];
+    best.rule_id = rule.id;
+    best.rule_name = rule.name;
+    best.priority = best_priority;
+    best.severity = best_severity;
+    best.action = best_action;
+    if (!rule.name.empty()) {
+        best.reason = rule.name;
+    } else if (!rule.id.empty()) {
+        best.reason = rule.id;
+    } else {
+        best.reason = "rule_match";
     }
     return best;
 }
@@ -572,3 +1319,15 @@ RuleDecision RuleEngine::evaluate(const RuleContext &context,
 const std::vector<Rule> &RuleEngine::rules() const {
     return rules_;
 }
+
+const std::vector<std::string> &RuleEngine::load_errors() const {
+    return load_errors_;
+}
+
+size_t RuleEngine::hash_count() const {
+    return hashes_.size();
+}
+
+size_t RuleEngine::hash_index_bytes() const {
+    return hashes_.memory_bytes();
+}
@@ -1,7 +1,18 @@
 #pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <regex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "hash_index.h"
+#include "keyword_matcher.h"
+#include "regex_set.h"
+#include "stream_window.h"
+
 enum class RuleAction {
     Allow,
     Alert,
@@ -39,6 +50,10 @@ struct RuleMatch {
     double confidence = 0.0;
     std::string match;
     size_t match_count = 0;
+    // Dense index of the producing rule inside the engine generation that
+    // built this match; lets evaluate() skip id/name lookups.
+    uint32_t rule_index = 0xFFFFFFFFu;
+    uint64_t generation = 0;
 };
 
 struct RuleContext {
@@ -64,18 +79,206 @@ struct RuleDecision {
     std::string reason;
 };
 
+enum class ConditionField : uint8_t {
+    Extension,
+    Path,
+    User,
+    DriveType,
+    ProcessName,
+    Destination,
+    ContainsPii,
+    KeywordHit,
+    SizeExceeded,
+    RemovableDrive,
+    FingerprintMatched
+};
+
+enum class ConditionOp : uint8_t {
+    Equals,
+    Contains,
+    StartsWith,
+    EndsWith
+};
+
+// A RuleCondition resolved at load time. String fields compare against
+// value; boolean fields compare against flag.
+struct CompiledCondition {
+    ConditionField field = ConditionField::Extension;
+    ConditionOp op = ConditionOp::Equals;
+    std::string value;
+    bool flag = false;
+};
+
+// A std::regex built either at load time or on first use. Deferred patterns
+// were already validated by the load that wrote the policy image.
+class LazyRegex {
+public:
+    // Compiles now; throws std::regex_error for an invalid pattern.
+    static std::shared_ptr<const LazyRegex> compiled(const std::string &pattern);
+    static std::shared_ptr<const LazyRegex> deferred(const std::string &pattern);
+
+    explicit LazyRegex(std::string pattern) : pattern_(std::move(pattern)) {}
+    // Null if a deferred pattern fails to compile.
+    const std::regex *get() const;
+
+private:
+    std::string pattern_;
+    mutable std::once_flag once_;
+    mutable std::unique_ptr<const std::regex> regex_;
+};
+
+// Per-rule artifacts built once at load time and shared read-only by every
+// scanning thread.
+struct CompiledRule {
+    std::shared_ptr<const LazyRegex> regex;
+    // Set when the pattern is part of regex_set_; std::regex then only runs
+    // for rules the combined automaton reports as matching.
+    bool in_regex_set = false;
+    std::vector<CompiledCondition> conditions;
+};
+
+// A rule pack read by a policy load. Kept so a policy image can tell when a
+// pack changed on disk after the image was written.
+struct PolicyPackSource {
+    std::string path;
+    bool present = false;
+    uint64_t size = 0;
+    uint64_t hash = 0;
+};
+
+// What a load took over from the engine it replaced.
+struct ReloadStats {
+    size_t reused_rules = 0;
+    size_t compiled_rules = 0;
+    bool reused_keywords = false;
+    bool reused_regex_set = false;
+    bool reused_hashes = false;
+};
+
+// Parses a JSON policy or rule pack in one pass. Returns false, with a
+// description in `error`, when the body is not valid JSON.
+bool parse_rules_json(std::string_view body, std::vector<Rule> &rules, std::string *error = nullptr);
+
 class RuleEngine {
 public:
-    bool load_from_file(const std::string &path);
-    bool load_from_string(const std::string &body);
+    // Loads a policy and the rule packs its "rule_packs" lists, resolved next
+    // to the policy file (or, for a body, next to g_rules_path). A body's pack
+    // names must stay in that directory: absolute names and ".." are refused
+    // with a load error. Packs are read in parallel, on at most one thread
+    // per core, and cached by content. Rules merge in order: inline,
+    // packs as listed, then `defaults`; the first source to define an id wins.
+    // With `previous`, rules whose content is unchanged take over its compiled
+    // form, and the keyword automaton, regex set and hash index are copied
+    // when the rules feeding them are unchanged.
+    bool load_from_file(const std::string &path, const std::vector<Rule> &defaults = {},
+                        const RuleEngine *previous = nullptr);
+    bool load_from_string(const std::string &body, const std::vector<Rule> &defaults = {},
+                          const RuleEngine *previous = nullptr);
     void load_from_rules(const std::vector<Rule> &rules);
-    std::vector<RuleMatch> scan_text(const std::string &text) const;
+    // Scans text against every content rule. When content_keyword is given it
+    // receives the first configured content keyword found in the text.
+    std::vector<RuleMatch> scan_text(const std::string &text,
+                                     std::string *content_keyword = nullptr) const;
+    // scan_text over text fed in chunks; see below.
+    class TextStream;
     std::vector<RuleMatch> scan_hashes(const std::string &full_hash,
                                        const std::string &partial_hash) const;
     RuleDecision evaluate(const RuleContext &context,
                           const std::vector<RuleMatch> &matches) const;
     const std::vector<Rule> &rules() const;
+    const std::vector<std::string> &load_errors() const;
+    const ReloadStats &reload_stats() const { return reload_stats_; }
+    // Unique per load and increasing; see RuleMatch::generation.
+    uint64_t generation() const { return generation_; }
+    // Distinct digests held by hash rules and the memory the index uses.
+    size_t hash_count() const;
+    size_t hash_index_bytes() const;
 
 private:
+    friend class PolicyImage;
+
+    bool load_policy(const std::string &body, const std::string &pack_dir, bool confine_packs,
+                     const std::vector<Rule> &defaults, const RuleEngine *previous);
+    void compile();
+    bool attach_regexes(std::string &error);
+    void build_indexes(const RuleEngine *previous = nullptr);
+    bool reuse_regex_set(const RuleEngine &previous);
+    bool reuse_keywords(const RuleEngine &previous);
+    bool reuse_hashes(const RuleEngine &previous);
+    void build_regex_set();
+    void build_keywords();
+    void build_hashes();
+    void build_rule_maps();
+    void build_decision_tables();
+    RuleMatch make_match(size_t index, size_t count) const;
+    // Match count and first match of a regex rule over the scanned text.
+    struct RegexHit {
+        uint32_t rule = 0;
+        size_t count = 0;
+        std::string first;
+    };
+    // Builds scan results in rule order from the keyword pattern ids found
+    // and the regex hits (ascending by rule).
+    std::vector<RuleMatch> collect_hits(const std::vector<uint32_t> &keyword_ids,
+                                        const std::vector<RegexHit> &regex_hits,
+                                        std::string *content_keyword) const;
+
     std::vector<Rule> rules_;
+    std::vector<CompiledRule> compiled_;
+    std::vector<std::string> load_errors_;
+    std::vector<PolicyPackSource> pack_sources_;
+    ReloadStats reload_stats_;
+    uint64_t generation_ = 0;
+    // Rules satisfied by a hit from rule j (same non-empty id or name):
+    // alias_[alias_offset_[j], alias_offset_[j + 1]), ascending.
+    std::vector<uint32_t> alias_offset_;
+    std::vector<uint32_t> alias_;
+    // Fallback for matches from another generation.
+    std::unordered_map<std::string, std::vector<uint32_t>> rules_by_id_;
+    std::unordered_map<std::string, std::vector<uint32_t>> rules_by_name_;
+    // Rules in decision order: priority descending, then rule index. rank_
+    // maps a rule index to its position in eval_order_.
+    std::vector<uint32_t> eval_order_;
+    std::vector<uint32_t> rank_;
+    // Highest severity any rule at or after a rank, within the same priority,
+    // can decide with; INT_MAX when it depends on hit severity.
+    std::vector<int> rank_severity_bound_;
+    // Ranks of enabled rules decided by conditions alone, visited on every
+    // evaluation, ascending.
+    std::vector<uint32_t> condition_rules_;
+    RegexSet regex_set_;
+    // One automaton over every keyword rule plus g_content_keywords. Owners
+    // map a pattern id to (rule index, keyword position) pairs.
+    KeywordMatcher keywords_;
+    std::vector<uint32_t> keyword_owner_offset_;
+    std::vector<std::pair<uint32_t, uint32_t>> keyword_owners_;
+    std::vector<uint32_t> content_keyword_rank_;
+    std::vector<std::string> content_keywords_;
+    // Digest -> (rule index << 32 | hash position) for every hash rule.
+    HashIndex hashes_;
+};
+
+// Scans a file of any size chunk by chunk with memory bounded by one chunk
+// plus `overlap` bytes. The keyword automaton carries its state from chunk to
+// chunk; regex rules run over a StreamWindow, so a match shorter than
+// `overlap` is found wherever the chunk boundaries fall. finish() returns
+// what scan_text would for the whole text. The engine must outlive the stream.
+class RuleEngine::TextStream {
+public:
+    TextStream(const RuleEngine &engine, size_t overlap);
+
+    void feed(const char *data, size_t len);
+    std::vector<RuleMatch> finish(std::string *content_keyword = nullptr);
+
+private:
+    void search(bool final);
+
+    const RuleEngine &engine_;
+    KeywordMatcher::Scratch keyword_scratch_;
+    uint32_t keyword_state_ = 0;
+    StreamWindow window_;
+    // One entry per regex rule, ascending by rule; cursors_ runs alongside.
+    std::vector<RegexHit> regexes_;
+    std::vector<StreamWindow::Cursor> cursors_;
+    std::vector<uint32_t> candidates_;
 };
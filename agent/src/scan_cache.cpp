@@ -0,0 +1,113 @@
+#include "scan_cache.h"
+
+#include "fnv1a.h"
+
+#include <iterator>
+
+size_t ScanCache::IdentityHash::operator()(const FileIdentity &id) const {
+    const uint64_t words[4] = {id.volume, id.file_id, id.size, id.mtime};
+    return static_cast<size_t>(fnv1a64(words, sizeof(words)));
+}
+
+size_t ScanCache::CopyKeyHash::operator()(const std::pair<uint64_t, uint64_t> &key) const {
+    const uint64_t words[2] = {key.first, key.second};
+    return static_cast<size_t>(fnv1a64(words, sizeof(words)));
+}
+
+bool ScanCache::adopt(uint64_t generation) {
+    if (generation < generation_) return false;
+    if (generation > generation_) {
+        entries_.clear();
+        by_identity_.clear();
+        by_content_.clear();
+        by_copy_key_.clear();
+        generation_ = generation;
+    }
+    return true;
+}
+
+bool ScanCache::find(uint64_t generation, const FileIdentity &identity, ScanOutcome &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.lookups;
+    if (!adopt(generation)) return false;
+    auto found = by_identity_.find(identity);
+    if (found == by_identity_.end()) return false;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    out = found->second->outcome;
+    ++stats_.identity_hits;
+    stats_.saved += found->second->cost;
+    return true;
+}
+
+bool ScanCache::peek(uint64_t generation, const FileIdentity &identity, ScanOutcome &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!adopt(generation)) return false;
+    auto found = by_identity_.find(identity);
+    if (found == by_identity_.end()) return false;
+    out = found->second->outcome;
+    return true;
+}
+
+bool ScanCache::copy_candidate(uint64_t generation, const FileIdentity &identity, std::string &sha256) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!adopt(generation)) return false;
+    auto found = by_copy_key_.find({identity.size, identity.mtime});
+    if (found == by_copy_key_.end()) return false;
+    sha256 = found->second->outcome.sha256;
+    return true;
+}
+
+bool ScanCache::find_content(uint64_t generation, const std::string &sha256, const FileIdentity &identity,
+                             ScanOutcome &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sha256.empty() || !adopt(generation)) return false;
+    auto found = by_content_.find(sha256);
+    if (found == by_content_.end()) return false;
+    out = found->second->outcome;
+    const Cost cost = found->second->cost;
+    ++stats_.content_hits;
+    stats_.saved += cost;
+    insert_locked(identity, out, cost);
+    return true;
+}
+
+void ScanCache::insert(uint64_t generation, const FileIdentity &identity, const ScanOutcome &outcome, Cost cost) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0 || !adopt(generation)) return;
+    insert_locked(identity, outcome, cost);
+}
+
+void ScanCache::insert_locked(const FileIdentity &identity, const ScanOutcome &outcome, Cost cost) {
+    auto existing = by_identity_.find(identity);
+    if (existing != by_identity_.end()) unlink(existing->second);
+    entries_.push_front(Entry{identity, outcome, cost});
+    auto it = entries_.begin();
+    by_identity_[identity] = it;
+    if (!outcome.sha256.empty()) {
+        by_content_[outcome.sha256] = it;
+        by_copy_key_[{identity.size, identity.mtime}] = it;
+    }
+    while (entries_.size() > capacity_) {
+        unlink(std::prev(entries_.end()));
+        ++stats_.evictions;
+    }
+}
+
+// Removes an entry and every index still pointing at it.
+void ScanCache::unlink(EntryList::iterator it) {
+    by_identity_.erase(it->identity);
+    if (!it->outcome.sha256.empty()) {
+        auto content = by_content_.find(it->outcome.sha256);
+        if (content != by_content_.end() && content->second == it) by_content_.erase(content);
+        auto copy = by_copy_key_.find({it->identity.size, it->identity.mtime});
+        if (copy != by_copy_key_.end() && copy->second == it) by_copy_key_.erase(copy);
+    }
+    entries_.erase(it);
+}
+
+ScanCache::Stats ScanCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
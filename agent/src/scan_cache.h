@@ -0,0 +1,102 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pii_detector.h"
+#include "rule_engine.h"
+
+// Identifies one version of a file: the file itself (volume serial and file
+// index survive renames) plus the size and last-write time of its content.
+struct FileIdentity {
+    uint64_t volume = 0;
+    uint64_t file_id = 0;
+    uint64_t size = 0;
+    uint64_t mtime = 0;
+
+    bool operator==(const FileIdentity &other) const {
+        return volume == other.volume && file_id == other.file_id && size == other.size && mtime == other.mtime;
+    }
+};
+
+// Everything the pipeline derives from file content alone.
+struct ScanOutcome {
+    std::vector<RuleMatch> rule_hits;
+    std::vector<PiiDetection> pii_hits;
+    bool keyword_found = false;
+    std::string sha256;
+    std::string partial_hash;
+};
+
+// Bounded LRU of scan outcomes for one rule engine generation, looked up by
+// file identity or, for copies, by content hash. Entries stored under an
+// older generation are dropped as soon as a newer one is seen, so a policy
+// change never serves stale rule hits. Thread-safe.
+class ScanCache {
+public:
+    using Cost = std::chrono::microseconds;
+
+    struct Stats {
+        uint64_t lookups = 0;
+        uint64_t identity_hits = 0;
+        uint64_t content_hits = 0;
+        uint64_t evictions = 0;
+        // Scanning CPU time the hits would have cost, as measured when they
+        // were stored.
+        Cost saved{0};
+        size_t entries = 0;
+    };
+
+    explicit ScanCache(size_t capacity) : capacity_(capacity) {}
+
+    bool find(uint64_t generation, const FileIdentity &identity, ScanOutcome &out);
+    // find() for a lookup another find() of the same evaluation counts: no
+    // statistics and no change to the eviction order.
+    bool peek(uint64_t generation, const FileIdentity &identity, ScanOutcome &out);
+    // Hash of a cached file with the same size and last-write time but
+    // another identity, i.e. a likely copy. The caller hashes the file to
+    // confirm through find_content().
+    bool copy_candidate(uint64_t generation, const FileIdentity &identity, std::string &sha256);
+    // On a hit the outcome is also stored under `identity`.
+    bool find_content(uint64_t generation, const std::string &sha256, const FileIdentity &identity,
+                      ScanOutcome &out);
+    void insert(uint64_t generation, const FileIdentity &identity, const ScanOutcome &outcome, Cost cost);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        FileIdentity identity;
+        ScanOutcome outcome;
+        Cost cost{0};
+    };
+    using EntryList = std::list<Entry>;
+
+    struct IdentityHash {
+        size_t operator()(const FileIdentity &id) const;
+    };
+    struct CopyKeyHash {
+        size_t operator()(const std::pair<uint64_t, uint64_t> &key) const;
+    };
+
+    // Clears everything for a newer generation; false for an older one.
+    bool adopt(uint64_t generation);
+    void insert_locked(const FileIdentity &identity, const ScanOutcome &outcome, Cost cost);
+    void unlink(EntryList::iterator it);
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    uint64_t generation_ = 0;
+    // Most recently used first.
+    EntryList entries_;
+    std::unordered_map<FileIdentity, EntryList::iterator, IdentityHash> by_identity_;
+    std::unordered_map<std::string, EntryList::iterator> by_content_;
+    // (size, mtime) -> latest entry with a full hash.
+    std::unordered_map<std::pair<uint64_t, uint64_t>, EntryList::iterator, CopyKeyHash> by_copy_key_;
+    Stats stats_;
+};
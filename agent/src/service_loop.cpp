@@ -1,13 +1,16 @@
 #include "service_loop.h"
 #include "log.h"
 #include "config.h"
+#include "file_watch.h"
 #include "enterprise/rules/rule_engine_v2.h"
 #include "enterprise/policy/policy_fetcher.h"
 #include "enterprise/policy/policy_version_manager.h"
+#include "policy_image.h"
 
 #include <chrono>
+#include <fstream>
+#include <iterator>
 #include <thread>
-#include <unordered_set>
 
 namespace {
 
@@ -43,44 +46,93 @@ std::vector<Rule> BuildDefaultRules() {
     return defaults;
 }
 
-void MergeDefaultRules(std::vector<Rule>& rules, const std::vector<Rule>& defaults) {
-    std::unordered_set<std::string> existing_ids;
-    for (const auto& rule : rules) {
-        if (!rule.id.empty()) {
-            existing_ids.insert(rule.id);
-        }
+void LogRuleLoadErrors(const dlp::rules::RuleEngineV2& engine) {
+    for (const auto& error : engine.LoadErrors()) {
+        log_error("Rule rejected at load: %s", error.c_str());
     }
-    for (const auto& rule : defaults) {
-        if (rule.id.empty() || existing_ids.insert(rule.id).second) {
-            rules.push_back(rule);
-        }
+}
+
+void LogHashIndex() {
+    auto snapshot = dlp::rules::g_rule_engine_v2.Current();
+    size_t count = snapshot->hash_count();
+    if (count == 0) return;
+    size_t bytes = snapshot->hash_index_bytes();
+    log_info("Hash index: %llu hashes, %llu bytes (%.1f bytes/hash)",
+             static_cast<unsigned long long>(count), static_cast<unsigned long long>(bytes),
+             static_cast<double>(bytes) / count);
+}
+
+// The compiled form of the last applied policy, kept beside the snapshot
+// store: policy_snapshot.json -> policy_snapshot.bin.
+std::string PolicyImagePath() {
+    std::string path = g_policy_store_path;
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        path.erase(dot);
     }
+    return path + ".bin";
+}
+
+void LogReload(const ReloadStats& stats, std::chrono::steady_clock::duration elapsed) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    log_info("Policy reload: %llu rules reused, %llu rebuilt; keywords %s, regex set %s, hashes %s; %lld ms",
+             static_cast<unsigned long long>(stats.reused_rules),
+             static_cast<unsigned long long>(stats.compiled_rules),
+             stats.reused_keywords ? "reused" : "rebuilt", stats.reused_regex_set ? "reused" : "rebuilt",
+             stats.reused_hashes ? "reused" : "rebuilt", static_cast<long long>(ms));
 }
 
+// Only the rules that differ from the published engine are compiled again.
 bool ApplyRulesFromPayload(const std::string& payload_json) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Rule> defaults = BuildDefaultRules();
     dlp::rules::RuleEngineV2 temp;
-    if (!temp.LoadFromString(payload_json)) {
+    bool loaded = temp.LoadFromString(payload_json, defaults, dlp::rules::g_rule_engine_v2.Current());
+    LogRuleLoadErrors(temp);
+    if (!loaded) {
         return false;
     }
-    auto rules = temp.SnapshotRules();
-    auto defaults = BuildDefaultRules();
-    MergeDefaultRules(rules, defaults);
-    dlp::rules::g_rule_engine_v2.LoadRules(rules);
+    dlp::rules::g_rule_engine_v2.Publish(temp.Current());
+    LogReload(temp.LastReloadStats(), std::chrono::steady_clock::now() - start);
+    LogHashIndex();
+    std::string error;
+    if (!temp.SaveImage(PolicyImagePath(), PolicyImage::source_key(payload_json, defaults), &error)) {
+        log_error("Policy image not saved: %s", error.c_str());
+    }
     return true;
 }
 
-bool LoadRulesFromFile(const std::string& path) {
+// Boot path: maps the image written for this exact policy instead of parsing
+// and compiling it again.
+bool LoadRulesFromImage(const std::string& payload_json) {
+    auto start = std::chrono::steady_clock::now();
     dlp::rules::RuleEngineV2 temp;
-    if (!temp.LoadFromFile(path)) {
+    std::string error;
+    uint64_t key = PolicyImage::source_key(payload_json, BuildDefaultRules());
+    if (!temp.LoadFromImage(PolicyImagePath(), key, &error)) {
+        log_info("Policy image not used (%s), parsing policy", error.c_str());
         return false;
     }
-    auto rules = temp.SnapshotRules();
-    auto defaults = BuildDefaultRules();
-    MergeDefaultRules(rules, defaults);
-    dlp::rules::g_rule_engine_v2.LoadRules(rules);
+    LogRuleLoadErrors(temp);
+    dlp::rules::g_rule_engine_v2.Publish(temp.Current());
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    log_info("Policy loaded from image in %lld ms", static_cast<long long>(elapsed.count()));
+    LogHashIndex();
     return true;
 }
 
+// Packs of a local rules file resolve next to g_rules_path, exactly as for a
+// fetched payload, so both share the image path.
+bool LoadLocalRules() {
+    std::ifstream in(g_rules_path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::string body((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return LoadRulesFromImage(body) || ApplyRulesFromPayload(body);
+}
+
 }  // namespace
 
 void service_loop() {
@@ -95,15 +147,18 @@ void service_loop() {
     dlp::policy::PolicySnapshot snapshot;
     if (version_manager.LoadLastKnown(&snapshot)) {
         if (!snapshot.json.empty()) {
-            if (ApplyRulesFromPayload(snapshot.json)) {
+            if (LoadRulesFromImage(snapshot.json) || ApplyRulesFromPayload(snapshot.json)) {
                 std::lock_guard<std::mutex> lock(g_policy_mutex);
                 g_policy_version = snapshot.version;
             }
         }
     } else {
-        if (LoadRulesFromFile(g_rules_path)) {
+        if (LoadLocalRules()) {
             std::lock_guard<std::mutex> lock(g_policy_mutex);
             g_policy_version = "local";
+        } else {
+            // Keep the configured content keywords scannable without a rules file.
+            dlp::rules::g_rule_engine_v2.LoadRules(BuildDefaultRules());
         }
     }
 
@@ -141,7 +196,23 @@ void service_loop() {
                 }
             }
         }
-        log_info("heartbeat");
+        FileWatchStats watch = file_watch_stats();
+        log_info("heartbeat: watch queue %llu, queued %llu, dropped %llu, overflows %llu, coalesced %llu, pending %llu",
+                 static_cast<unsigned long long>(watch.queue_depth), static_cast<unsigned long long>(watch.queued),
+                 static_cast<unsigned long long>(watch.dropped), static_cast<unsigned long long>(watch.overflows),
+                 static_cast<unsigned long long>(watch.coalesced), static_cast<unsigned long long>(watch.pending_paths));
+        if (watch.cache_lookups > 0) {
+            log_info("scan cache: %llu of %llu files served from cache (%.1f%%), %llu ms of scanning CPU saved",
+                     static_cast<unsigned long long>(watch.cache_hits), static_cast<unsigned long long>(watch.cache_lookups),
+                     100.0 * watch.cache_hits / watch.cache_lookups, static_cast<unsigned long long>(watch.cache_saved_ms));
+        }
+        if (watch.driver_full_verdicts + watch.driver_fast_verdicts > 0) {
+            log_info("driver verdicts: %llu full, %llu fast after the %llu ms deadline, %llu follow-ups",
+                     static_cast<unsigned long long>(watch.driver_full_verdicts),
+                     static_cast<unsigned long long>(watch.driver_fast_verdicts),
+                     static_cast<unsigned long long>(g_driver_verdict_deadline_ms),
+                     static_cast<unsigned long long>(watch.driver_followups));
+        }
         std::this_thread::sleep_for(std::chrono::seconds(5));
     }
     log_info("Service loop exiting");
@@ -0,0 +1,18 @@
+#include "stream_window.h"
+
+void StreamWindow::append(const char *data, size_t len) {
+    // Cursors sit past end() - overlap_ by now; one byte before them stays
+    // as context for anchors and word boundaries.
+    if (buffer_.size() > overlap_ + 1) {
+        size_t drop = buffer_.size() - overlap_ - 1;
+        buffer_.erase(0, drop);
+        base_ += drop;
+    }
+    buffer_.append(data, len);
+}
+
+void StreamWindow::skip(Cursor &cursor, bool final) const {
+    if (!ready(final)) return;
+    // Nothing starting at or before the limit was left unreported.
+    cursor.resume = std::max(cursor.resume, limit(final) + 1);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <regex>
+#include <string>
+
+// Bounded window over a byte stream fed in chunks, for running std::regex
+// across chunk boundaries. Each pattern keeps a Cursor. A match is reported
+// once its start lies at least `overlap` bytes before the end of the data
+// seen so far, or when the stream ends, so for matches shorter than
+// `overlap` the results equal a std::sregex_iterator pass over the whole
+// stream. The window holds at most one chunk plus overlap + 1 bytes.
+//
+// After every append() each cursor must go through search() or skip()
+// before the next append().
+class StreamWindow {
+public:
+    struct Cursor {
+        // Stream offset the next search starts at.
+        uint64_t resume = 0;
+    };
+
+    explicit StreamWindow(size_t overlap) : overlap_(overlap) {}
+
+    // Appends a chunk, first dropping the bytes every cursor has moved past.
+    void append(const char *data, size_t len);
+    // Window contents: stream offsets [base(), end()).
+    const std::string &data() const { return buffer_; }
+    uint64_t base() const { return base_; }
+    uint64_t end() const { return base_ + buffer_.size(); }
+    // False while too little of the stream was seen to report anything
+    // before the end.
+    bool ready(bool final) const { return final || end() >= overlap_; }
+    // Last start offset whose match cannot depend on bytes not seen yet.
+    // Only meaningful once ready().
+    uint64_t limit(bool final) const { return final ? end() : end() - overlap_; }
+
+    // Calls on_match(const std::smatch &, uint64_t start) for each match of
+    // `re` that can be reported now and moves the cursor past it. on_match
+    // returns false to stop early; the rest of the window is then skipped.
+    // `final` marks the end of the stream.
+    template <typename Fn>
+    void search(const std::regex &re, Cursor &cursor, bool final, Fn on_match) const;
+    // Moves the cursor as search() would when a prefilter found no match of
+    // the pattern anywhere in data().
+    void skip(Cursor &cursor, bool final) const;
+
+private:
+    size_t overlap_;
+    uint64_t base_ = 0;
+    std::string buffer_;
+};
+
+template <typename Fn>
+void StreamWindow::search(const std::regex &re, Cursor &cursor, bool final, Fn on_match) const {
+    if (!ready(final)) return;
+    const uint64_t limit = this->limit(final);
+    auto flags = std::regex_constants::match_default;
+    // Past the window end lies more text: no '$' or word boundary there.
+    if (!final) flags |= std::regex_constants::match_not_eol | std::regex_constants::match_not_eow;
+    std::smatch m;
+    while (cursor.resume <= limit) {
+        auto from = buffer_.begin() + static_cast<std::ptrdiff_t>(cursor.resume - base_);
+        auto step = flags;
+        if (cursor.resume > base_) step |= std::regex_constants::match_prev_avail;
+        if (!std::regex_search(from, buffer_.end(), m, re, step)) break;
+        const uint64_t start = base_ + static_cast<uint64_t>(m[0].first - buffer_.begin());
+        if (start > limit) break;
+        const bool more = on_match(m, start);
+        const uint64_t length = static_cast<uint64_t>(m.length(0));
+        // An empty match would be found again at the same offset.
+        cursor.resume = start + (length ? length : 1);
+        if (!more) break;
+    }
+    skip(cursor, final);
+}
@@ -0,0 +1,216 @@
+#include "text_normalizer.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define DLP_TEXT_NORMALIZER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Bytes of the first chunk examined for UTF-16 without a byte order mark.
+constexpr size_t kSniffBytes = 512;
+
+uint16_t load_unit(const unsigned char *p, bool big_endian) {
+    return big_endian ? static_cast<uint16_t>(p[0] << 8 | p[1]) : static_cast<uint16_t>(p[1] << 8 | p[0]);
+}
+
+// Narrows the leading run of ASCII code units into `out`, 16 units at a
+// time where SSE2 is available, and returns how many units it covered.
+size_t narrow_ascii(const unsigned char *src, size_t units, bool big_endian, char *out) {
+    size_t i = 0;
+#if defined(DLP_TEXT_NORMALIZER_SSE2)
+    const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= units; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i + 16));
+        if (big_endian) {
+            a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+            b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+        }
+        const __m128i wide = _mm_and_si128(_mm_or_si128(a, b), non_ascii);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(wide, zero)) != 0xFFFF) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(a, b));
+    }
+#endif
+    for (; i < units; ++i) {
+        const uint16_t u = load_unit(src + 2 * i, big_endian);
+        if (u >= 0x80) break;
+        out[i] = static_cast<char>(u);
+    }
+    return i;
+}
+
+}  // namespace
+
+std::string_view TextNormalizer::feed(const char *data, size_t len) {
+    if (len == 0) return {};
+    if (encoding_ == Encoding::Unknown) {
+        detect(data, len);
+        const size_t bom = static_cast<size_t>(src_offset_);
+        data += bom;
+        len -= bom;
+    }
+    if (encoding_ == Encoding::Bytes) {
+        src_offset_ += len;
+        out_offset_ += len;
+        return std::string_view(data, len);
+    }
+    // At most three bytes per unit, plus a replaced surrogate left pending.
+    const size_t needed = (len / 2 + 2) * 3;
+    if (out_.size() < needed) out_.resize(needed);
+    out_size_ = 0;
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    if (has_carry_ && len > 0) {
+        const unsigned char pair[2] = {carry_, p[0]};
+        has_carry_ = false;
+        unit(load_unit(pair, encoding_ == Encoding::Utf16Be), src_offset_ - 1);
+        ++src_offset_;
+        ++p;
+        --len;
+    }
+    transcode(p, len);
+    return std::string_view(out_.data(), out_size_);
+}
+
+std::string_view TextNormalizer::finish() {
+    out_size_ = 0;
+    if (encoding_ != Encoding::Utf16Le && encoding_ != Encoding::Utf16Be) return {};
+    if (out_.size() < 6) out_.resize(6);
+    if (high_ != 0) {
+        emit(0xFFFD, high_src_, 2);
+        high_ = 0;
+    }
+    if (has_carry_) {
+        emit(0xFFFD, src_offset_ - 1, 1);
+        has_carry_ = false;
+    }
+    return std::string_view(out_.data(), out_size_);
+}
+
+uint64_t TextNormalizer::source_offset(uint64_t offset) const {
+    auto it = std::upper_bound(runs_.begin(), runs_.end(), offset,
+                               [](uint64_t value, const Run &run) { return value < run.out; });
+    if (it == runs_.begin()) return offset;
+    const Run &run = *(it - 1);
+    return run.src + (offset - run.out) / run.out_width * run.src_width;
+}
+
+void TextNormalizer::release_before(uint64_t offset) {
+    // Keep the run that contains `offset`.
+    auto it = std::upper_bound(runs_.begin(), runs_.end(), offset,
+                               [](uint64_t value, const Run &run) { return value < run.out; });
+    if (it - runs_.begin() > 1) runs_.erase(runs_.begin(), it - 1);
+}
+
+void TextNormalizer::detect(const char *data, size_t len) {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    size_t bom = 0;
+    encoding_ = Encoding::Bytes;
+    if (len >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+        bom = 3;
+    } else if (len >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+        encoding_ = Encoding::Utf16Le;
+        bom = 2;
+    } else if (len >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+        encoding_ = Encoding::Utf16Be;
+        bom = 2;
+    } else {
+        // ASCII text in UTF-16 has a zero in the high byte of nearly every
+        // unit and hardly ever in the low one.
+        const size_t units = std::min(len, kSniffBytes) / 2;
+        size_t zero_even = 0;
+        size_t zero_odd = 0;
+        for (size_t i = 0; i < units; ++i) {
+            zero_even += p[2 * i] == 0;
+            zero_odd += p[2 * i + 1] == 0;
+        }
+        if (units >= 4 && zero_odd * 10 >= units * 3 && zero_even * 20 <= units) {
+            encoding_ = Encoding::Utf16Le;
+        } else if (units >= 4 && zero_even * 10 >= units * 3 && zero_odd * 20 <= units) {
+            encoding_ = Encoding::Utf16Be;
+        }
+    }
+    src_offset_ = bom;
+    if (encoding_ == Encoding::Bytes) runs_.push_back({0, bom, 1, 1});
+}
+
+void TextNormalizer::transcode(const unsigned char *data, size_t len) {
+    const bool big_endian = encoding_ == Encoding::Utf16Be;
+    const size_t units = len / 2;
+    for (size_t i = 0; i < units;) {
+        if (high_ == 0) {
+            const size_t ascii = narrow_ascii(data + 2 * i, units - i, big_endian, &out_[out_size_]);
+            if (ascii > 0) {
+                note_run(src_offset_ + 2 * i, 1, 2);
+                out_size_ += ascii;
+                out_offset_ += ascii;
+                i += ascii;
+                continue;
+            }
+        }
+        unit(load_unit(data + 2 * i, big_endian), src_offset_ + 2 * i);
+        ++i;
+    }
+    src_offset_ += 2 * units;
+    if (len % 2 != 0) {
+        has_carry_ = true;
+        carry_ = data[len - 1];
+        ++src_offset_;
+    }
+}
+
+void TextNormalizer::unit(uint16_t u, uint64_t src) {
+    const bool high = u >= 0xD800 && u <= 0xDBFF;
+    const bool low = u >= 0xDC00 && u <= 0xDFFF;
+    if (high_ != 0) {
+        if (low) {
+            emit(0x10000 + ((static_cast<uint32_t>(high_) - 0xD800) << 10) + (u - 0xDC00), high_src_, 4);
+            high_ = 0;
+            return;
+        }
+        emit(0xFFFD, high_src_, 2);
+        high_ = 0;
+    }
+    if (high) {
+        high_ = u;
+        high_src_ = src;
+        return;
+    }
+    emit(low ? 0xFFFD : u, src, 2);
+}
+
+void TextNormalizer::emit(uint32_t code_point, uint64_t src, uint8_t src_width) {
+    char bytes[4];
+    uint8_t n;
+    if (code_point < 0x80) {
+        bytes[0] = static_cast<char>(code_point);
+        n = 1;
+    } else if (code_point < 0x800) {
+        bytes[0] = static_cast<char>(0xC0 | code_point >> 6);
+        bytes[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+        n = 2;
+    } else if (code_point < 0x10000) {
+        bytes[0] = static_cast<char>(0xE0 | code_point >> 12);
+        bytes[1] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+        bytes[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+        n = 3;
+    } else {
+        bytes[0] = static_cast<char>(0xF0 | code_point >> 18);
+        bytes[1] = static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+        bytes[2] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+        bytes[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+        n = 4;
+    }
+    note_run(src, n, src_width);
+    std::copy(bytes, bytes + n, &out_[out_size_]);
+    out_size_ += n;
+    out_offset_ += n;
+}
+
+// Consecutive characters with the same widths extend the last run.
+void TextNormalizer::note_run(uint64_t src, uint8_t out_width, uint8_t src_width) {
+    if (!runs_.empty() && runs_.back().out_width == out_width && runs_.back().src_width == src_width) return;
+    runs_.push_back({out_offset_, src, out_width, src_width});
+}
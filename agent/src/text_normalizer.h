@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Turns file content fed in chunks into the byte text the scanners expect.
+// The encoding is decided from the first chunk: a UTF-8 byte order mark is
+// dropped, and UTF-16 (by byte order mark, or by the zero bytes ASCII text
+// leaves in every other position) is transcoded to UTF-8. Anything else
+// passes through untouched. Case is left alone: keyword matching already
+// ignores ASCII case, and regex rules and PII types are case-sensitive.
+//
+// source_offset() maps normalized offsets back to file offsets. The map
+// keeps one entry per run of characters with the same encoded widths; the
+// caller releases runs it no longer needs, or text that alternates scripts
+// would grow it by an entry per word for the whole file.
+class TextNormalizer {
+public:
+    enum class Encoding { Unknown, Bytes, Utf16Le, Utf16Be };
+
+    // Normalizes the next chunk. The view stays valid until the next call.
+    std::string_view feed(const char *data, size_t len);
+    // Ends the stream: a trailing odd byte or unpaired surrogate becomes
+    // U+FFFD.
+    std::string_view finish();
+
+    Encoding encoding() const { return encoding_; }
+    // File offset of the character that normalized `offset` belongs to; the
+    // end of the normalized text maps to the end of what produced it.
+    // Offsets below the last release_before() cannot be mapped.
+    uint64_t source_offset(uint64_t offset) const;
+    // Forgets the mapping of normalized offsets below `offset`, so the map
+    // stays bounded by what the scanners still hold.
+    void release_before(uint64_t offset);
+    // Entries the offset map holds.
+    size_t map_entries() const { return runs_.size(); }
+
+private:
+    // Characters of one encoded width pair: the k-th starts at out + k *
+    // out_width in the normalized text and at src + k * src_width in the file.
+    struct Run {
+        uint64_t out;
+        uint64_t src;
+        uint8_t out_width;
+        uint8_t src_width;
+    };
+
+    void detect(const char *data, size_t len);
+    void transcode(const unsigned char *data, size_t len);
+    void unit(uint16_t u, uint64_t src);
+    void emit(uint32_t code_point, uint64_t src, uint8_t src_width);
+    void note_run(uint64_t src, uint8_t out_width, uint8_t src_width);
+
+    Encoding encoding_ = Encoding::Unknown;
+    std::string out_;
+    size_t out_size_ = 0;
+    std::vector<Run> runs_;
+    uint64_t src_offset_ = 0;
+    uint64_t out_offset_ = 0;
+    // Odd byte left over from the previous chunk.
+    bool has_carry_ = false;
+    unsigned char carry_ = 0;
+    // High surrogate waiting for its pair, and where it started.
+    uint16_t high_ = 0;
+    uint64_t high_src_ = 0;
+};
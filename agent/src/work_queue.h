@@ -0,0 +1,69 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Fixed-capacity multi-producer, multi-consumer queue. Producers never block:
+// push() fails when the queue is full (or closed) and the caller decides what
+// a drop means. pop() blocks until an item arrives, or returns false once the
+// queue is closed and drained.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+    bool push(T item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_ || items_.size() >= capacity_) return false;
+            items_.push_back(std::move(item));
+        }
+        ready_.notify_one();
+        return true;
+    }
+
+    bool pop(T &out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        out = std::move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+
+    // Wakes every consumer; items already queued are still handed out.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+    // Closes the queue and returns the items no consumer has taken.
+    std::deque<T> close_and_take() {
+        std::deque<T> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            pending.swap(items_);
+        }
+        ready_.notify_all();
+        return pending;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+    size_t capacity() const { return capacity_; }
+
+private:
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<T> items_;
+    bool closed_ = false;
+};
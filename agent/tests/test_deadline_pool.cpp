@@ -0,0 +1,113 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "../src/deadline_pool.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+int main() {
+    using ms = std::chrono::milliseconds;
+    DeadlinePool<int> pool(2, 4);
+    int out = 0;
+
+    // In time: the caller gets the result and `late` is never called.
+    std::atomic<int> late_calls{0};
+    auto outcome = pool.run([] { return 7; }, ms(5000), out, [&](int) { ++late_calls; });
+    assert(outcome == DeadlinePool<int>::Outcome::Completed && out == 7);
+
+    // Too slow: the caller moves on and the result arrives through `late`.
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<int> late_result;
+    out = 0;
+    outcome = pool.run([released] { released.wait(); return 9; }, ms(10), out,
+                       [&](int value) { late_result.set_value(value); });
+    assert(outcome == DeadlinePool<int>::Outcome::Detached && out == 0);
+    release.set_value();
+    assert(late_result.get_future().get() == 9);
+    assert(late_calls == 0);
+
+    // Submitted first and waited for later: the caller's work in between
+    // counts against the deadline, and what it wrote is visible to `late`.
+    {
+        std::promise<void> go;
+        std::shared_future<void> started = go.get_future().share();
+        int seen_by_late = 0;
+        std::promise<void> late_done;
+        int written = 0;
+        auto ticket = pool.submit([started] { started.wait(); return 3; },
+                                  [&](int) { seen_by_late = written; late_done.set_value(); });
+        assert(ticket);
+        written = 42;
+        out = 0;
+        auto until = std::chrono::steady_clock::now() + ms(10);
+        assert(pool.wait(ticket, until, out) == DeadlinePool<int>::Outcome::Detached && out == 0);
+        go.set_value();
+        late_done.get_future().wait();
+        assert(seen_by_late == 42);
+
+        ticket = pool.submit([] { return 5; }, nullptr);
+        std::this_thread::sleep_for(ms(20));
+        // The deadline has already passed, but the job finished first.
+        assert(pool.wait(ticket, std::chrono::steady_clock::now() - ms(1), out) ==
+                   DeadlinePool<int>::Outcome::Completed &&
+               out == 5);
+    }
+
+    // With every worker busy and the queue full, new jobs are turned away.
+    DeadlinePool<int> busy(1, 1);
+    std::promise<void> unblock;
+    std::shared_future<void> unblocked = unblock.get_future().share();
+    std::atomic<int> ran{0};
+    auto blocker = [unblocked, &ran] { unblocked.wait(); return ++ran; };
+    assert(busy.run(blocker, ms(0), out, nullptr) == DeadlinePool<int>::Outcome::Detached);
+    while (true) {
+        // Rejected until the worker takes the first job off the one-slot queue.
+        auto queued = busy.run(blocker, ms(0), out, nullptr);
+        if (queued == DeadlinePool<int>::Outcome::Detached) break;
+        std::this_thread::sleep_for(ms(1));
+    }
+    assert(busy.run(blocker, ms(0), out, nullptr) == DeadlinePool<int>::Outcome::Rejected);
+    unblock.set_value();
+    // Both accepted jobs run once the worker is free.
+    while (ran < 2) std::this_thread::sleep_for(ms(1));
+    busy.stop();
+    assert(busy.run(blocker, ms(0), out, nullptr) == DeadlinePool<int>::Outcome::Rejected);
+
+    // Stopped with its worker busy and the queue full: the queued jobs are
+    // dropped at once, their waiters told so, and only the running job
+    // finishes and reports late.
+    {
+        DeadlinePool<int> full(1, 2);
+        std::promise<void> started;
+        std::promise<void> gate;
+        std::shared_future<void> opened = gate.get_future().share();
+        std::atomic<int> runs{0};
+        std::atomic<int> late_results{0};
+        auto late = [&](int) { ++late_results; };
+        auto first = full.submit([&started, opened, &runs] {
+            started.set_value();
+            opened.wait();
+            return ++runs;
+        }, late);
+        started.get_future().wait();
+        auto second = full.submit([&runs] { return ++runs; }, late);
+        auto third = full.submit([&runs] { return ++runs; }, late);
+        assert(second && third && !full.submit([&runs] { return ++runs; }, late));
+        assert(full.wait(first, std::chrono::steady_clock::now(), out) == DeadlinePool<int>::Outcome::Detached);
+
+        std::thread stopper([&full] { full.stop(); });
+        const auto patience = std::chrono::steady_clock::now() + ms(5000);
+        assert(full.wait(second, patience, out) == DeadlinePool<int>::Outcome::Rejected);
+        assert(full.wait(third, patience, out) == DeadlinePool<int>::Outcome::Rejected);
+        gate.set_value();
+        stopper.join();
+        assert(runs == 1 && late_results == 1);
+    }
+    return 0;
+}
+
+#endif
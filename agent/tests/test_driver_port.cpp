@@ -0,0 +1,118 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/driver_port.h"
+#include "../src/work_queue.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+// Stands in for the minifilter: each create blocks until the reply carrying
+// its message id arrives.
+class SimulatedPort : public DriverMessageSource {
+public:
+    DlpPolicyDecision create(uint32_t pid, const std::string &path) {
+        DriverQuery query;
+        query.process_id = pid;
+        query.path = path;
+        std::future<DlpPolicyDecision> verdict;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            query.message_id = ++next_id_;
+            verdict = waiting_[query.message_id].get_future();
+        }
+        bool queued = queries_.push(query);
+        assert(queued);
+        return verdict.get();
+    }
+
+    void close() { queries_.close(); }
+
+    bool receive(DriverQuery &query) override { return queries_.pop(query); }
+
+    void reply(uint64_t message_id, const DlpPolicyDecision &decision) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = waiting_.find(message_id);
+        assert(found != waiting_.end());
+        found->second.set_value(decision);
+        waiting_.erase(found);
+    }
+
+    size_t waiting() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return waiting_.size();
+    }
+
+private:
+    BoundedQueue<DriverQuery> queries_{1024};
+    std::mutex mutex_;
+    uint64_t next_id_ = 0;
+    std::unordered_map<uint64_t, std::promise<DlpPolicyDecision>> waiting_;
+};
+
+int main() {
+    // Every create gets the verdict computed for its own query.
+    {
+        SimulatedPort port;
+        std::thread server([&] {
+            serve_driver_queries(port, 4, [](const DriverQuery &query) {
+                DlpPolicyDecision decision = {};
+                decision.action = query.path.back() == '7' ? DlpPolicyAction::Block : DlpPolicyAction::Allow;
+                decision.rule_id = query.process_id;
+                decision.severity = static_cast<uint32_t>(query.path.size());
+                return decision;
+            });
+        });
+        std::vector<std::thread> clients;
+        for (uint32_t c = 0; c < 8; ++c) {
+            clients.emplace_back([&port, c] {
+                for (int i = 0; i < 500; ++i) {
+                    std::string path = "C:\\data\\" + std::to_string(c) + "-" + std::to_string(i);
+                    DlpPolicyDecision decision = port.create(c * 1000 + i, path);
+                    assert(decision.rule_id == c * 1000 + i);
+                    assert(decision.severity == path.size());
+                    assert((decision.action == DlpPolicyAction::Block) == (path.back() == '7'));
+                }
+            });
+        }
+        for (auto &t : clients) t.join();
+        port.close();
+        server.join();
+        assert(port.waiting() == 0);
+    }
+
+    // A slow evaluation does not hold up the creates queued behind it.
+    {
+        SimulatedPort port;
+        std::atomic<bool> fast_done{false};
+        std::thread server([&] {
+            serve_driver_queries(port, 2, [&](const DriverQuery &query) {
+                DlpPolicyDecision decision = {};
+                if (query.path == "slow") {
+                    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                    while (!fast_done && std::chrono::steady_clock::now() < deadline) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    decision.severity = fast_done ? 1 : 0;
+                }
+                return decision;
+            });
+        });
+        std::thread slow([&] { assert(port.create(1, "slow").severity == 1); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        port.create(2, "fast");
+        fast_done = true;
+        slow.join();
+        port.close();
+        server.join();
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#include "../src/path_coalescer.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+int main() {
+    using ms = std::chrono::milliseconds;
+    const PathCoalescer::Clock::time_point t0{};
+    const uint32_t added = 1, modified = 3, renamed_from = 4, renamed_to = 5;
+
+    // An Office-style save: one evaluation of the final state, with the
+    // action sequence kept.
+    PathCoalescer coalescer(ms(100), ms(1000));
+    coalescer.add("C:\\Users\\a\\Report.docx", renamed_from, t0);
+    coalescer.add("C:\\Users\\a\\report.docx", renamed_to, t0 + ms(2));
+    coalescer.add("C:\\Users\\a\\Report.docx", modified, t0 + ms(3));
+    coalescer.add("C:\\Users\\a\\Report.docx", modified, t0 + ms(4));
+    coalescer.add("C:\\Users\\a\\other.txt", added, t0 + ms(5));
+    assert(coalescer.pending() == 2 && coalescer.merged() == 3);
+    assert(coalescer.next_due() == t0 + ms(104));
+
+    std::vector<PathCoalescer::Burst> due;
+    coalescer.take_due(t0 + ms(103), due);
+    assert(due.empty());
+    coalescer.take_due(t0 + ms(105), due);
+    assert(due.size() == 2);
+    assert(due[0].path == "C:\\Users\\a\\Report.docx" && due[0].notifications == 4);
+    assert((due[0].actions == std::vector<uint32_t>{renamed_from, renamed_to, modified}));
+    assert(due[1].path == "C:\\Users\\a\\other.txt");
+    assert(coalescer.pending() == 0 && coalescer.next_due() == PathCoalescer::Clock::time_point::max());
+
+    // A path that never goes quiet is still released after max_delay, and
+    // the action list stays bounded with the last action kept.
+    due.clear();
+    for (int i = 0; i < 60; ++i) {
+        coalescer.take_due(t0 + ms(20 * i), due);
+        coalescer.add("build\\out.obj", i % 2 ? modified : added, t0 + ms(20 * i));
+    }
+    assert(due.size() == 1 && due[0].notifications == 50);
+    assert(due[0].actions.size() == PathCoalescer::kMaxActions && due[0].actions.back() == modified);
+    return 0;
+}
+
+#endif
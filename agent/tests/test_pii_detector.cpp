@@ -1,10 +1,169 @@
 #include <cassert>
+#include <algorithm>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "../src/byte_classes.h"
+#include "../src/pii_detector.h"
 
 #if defined(DLP_ENABLE_TESTS)
 
+static bool same(const std::vector<PiiDetection> &a, const std::vector<PiiDetection> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].type != b[i].type || a[i].value != b[i].value || a[i].start != b[i].start ||
+            a[i].end != b[i].end || a[i].valid != b[i].valid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The regular expressions the built-in scanner replaces, run the way
+// detect_pii used to run them. `valid` is derived from the value alone, so
+// matching values imply matching validation.
+static std::vector<PiiDetection> regex_reference(const std::string &text, const std::vector<std::string> &national) {
+    std::vector<std::pair<std::string, std::regex>> patterns = {
+        {"email", std::regex(R"(\b[A-Z0-9._%+-]+@[A-Z0-9.-]+\.[A-Z]{2,}\b)", std::regex::icase)},
+        {"phone", std::regex(R"(\b\+?[0-9][0-9()\-\.\s]{7,}[0-9]\b)")},
+        {"passport", std::regex(R"(\b[A-Z]{1,2}[0-9]{6,9}\b)")},
+        {"iban", std::regex(R"(\b[A-Z]{2}[0-9]{2}[A-Z0-9]{11,30}\b)")},
+        {"credit_card", std::regex(R"(\b(?:\d[ -]*?){13,19}\b)")},
+    };
+    for (const auto &pattern : national) {
+        try {
+            patterns.push_back({"national_id", std::regex(pattern)});
+        } catch (const std::regex_error &) {
+        }
+    }
+    std::vector<PiiDetection> out;
+    for (const auto &pattern : patterns) {
+        for (std::sregex_iterator it(text.begin(), text.end(), pattern.second), end; it != end; ++it) {
+            PiiDetection det;
+            det.type = pattern.first;
+            det.value = it->str();
+            det.start = static_cast<size_t>(it->position(0));
+            det.end = det.start + static_cast<size_t>(it->length(0));
+            out.push_back(det);
+        }
+    }
+    return out;
+}
+
+static bool same_matches(const std::vector<PiiDetection> &a, const std::vector<PiiDetection> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].type != b[i].type || a[i].value != b[i].value || a[i].start != b[i].start || a[i].end != b[i].end) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int main() {
-    // TODO: Wire to pii_detector once exposed in a test harness.
-    assert(true);
+    const std::vector<std::string> national = {R"(\b\d{3}-\d{2}-\d{4}\b)", "(unbalanced"};
+    const PiiPatterns patterns(national);
+    auto hits = detect_pii("mail Jane.Doe@Example.org card 4111 1111 1111 1111 ssn 123-45-6789", patterns);
+    auto has = [&](const char *type) {
+        return std::any_of(hits.begin(), hits.end(), [&](const PiiDetection &d) { return d.type == type; });
+    };
+    assert(has("email") && has("credit_card") && has("national_id"));
+    auto card = std::find_if(hits.begin(), hits.end(), [](const PiiDetection &d) { return d.type == "credit_card"; });
+    assert(card->valid && card->value == "4111 1111 1111 1111");
+
+    // Every byte classifier the CPU supports finds the same anchor blocks as
+    // a byte-by-byte scan, at any length and alignment.
+    std::vector<ByteKernel> kernels;
+    for (ByteKernel kernel : {ByteKernel::Scalar, ByteKernel::Sse2, ByteKernel::Avx2}) {
+        if (byte_kernel_supported(kernel)) kernels.push_back(kernel);
+    }
+    std::mt19937 rng(23);
+    std::string bytes(8192, '\0');
+    for (char &c : bytes) c = static_cast<char>(rng() % 40 == 0 ? "09@/:?"[rng() % 6] : 'A' + rng() % 58);
+    for (size_t offset = 0; offset + 200 < bytes.size(); offset += 7) {
+        const size_t len = offset % 200;
+        size_t block = 0;
+        ByteMasks expected = {};
+        for (; block < len; block += 32, expected = ByteMasks{}) {
+            for (size_t i = 0; i < 32 && block + i < len; ++i) {
+                const char c = bytes[offset + block + i];
+                if (c >= '0' && c <= '9') expected.digit |= 1u << i;
+                if (c == '@') expected.at |= 1u << i;
+            }
+            if (expected.digit != 0 || expected.at != 0) break;
+        }
+        block = std::min(block, len);
+        for (ByteKernel kernel : kernels) {
+            set_byte_kernel(kernel);
+            ByteMasks masks;
+            assert(find_anchor_block(bytes.data() + offset, len, masks) == block);
+            assert(masks.digit == expected.digit && masks.at == expected.at);
+        }
+    }
+
+    // Differential fuzz against the regular expressions, under each byte
+    // classifier in turn: text built from fragments of every pattern,
+    // separators and bytes that flip word boundaries.
+    const char *fragments[] = {"a.b@corp.example", "x@y.zz", "@", ".", "-", "+", "_", "%", " ", "  ", "\t", "\n",
+                               "(", ")", "GB82", "WEST", "1234", "5678", "4111", "1111", "AB", "X", "Q", "123456",
+                               "1234567890", "0", "9", "com", "ORG", "de", "a", "Z", "\xc3\xa9", "--", " - ", "555"};
+    const size_t fragment_count = sizeof(fragments) / sizeof(fragments[0]);
+    for (int iter = 0; iter < 5000; ++iter) {
+        set_byte_kernel(kernels[iter % kernels.size()]);
+        std::string text;
+        for (int f = rng() % 40; f > 0; --f) {
+            if (rng() % 4 == 0) {
+                text += static_cast<char>(rng() % 128);
+            } else {
+                text += fragments[rng() % fragment_count];
+            }
+        }
+        assert(same_matches(detect_pii(text, patterns), regex_reference(text, national)));
+    }
+
+    // Chunked detection reports what detect_pii reports over the whole text,
+    // with the same stream offsets, wherever the chunk boundaries fall, as
+    // long as every detection is shorter than the overlap.
+    const char *tokens[] = {"a.b@corp.example ", "GB82WEST12345698765432 ", "4111", " 1111 ", "+1 (555) 010-0199 ",
+                            "AB1234567 ", "123-45-6789", " ", "text ", "@", "x", " x "};
+    int checked = 0;
+    for (int iter = 0; iter < 1500; ++iter) {
+        std::string text;
+        for (int t = rng() % 30; t > 0; --t) text += tokens[rng() % 12];
+        auto whole = detect_pii(text, patterns);
+        bool bounded = std::all_of(whole.begin(), whole.end(), [](const PiiDetection &d) { return d.end - d.start < 64; });
+        PiiStream stream(patterns, 64);
+        for (size_t pos = 0; pos < text.size();) {
+            size_t len = std::min<size_t>(1 + rng() % 13, text.size() - pos);
+            stream.feed(text.data() + pos, len);
+            pos += len;
+        }
+        if (!bounded) continue;
+        assert(same(stream.finish(), whole));
+        ++checked;
+    }
+    assert(checked > 1000);
+
+    const PiiPatterns builtin_only({});
+    PiiStream capped(builtin_only, 64, 2);
+    std::string emails = "a@b.cc c@d.ee f@g.hh";
+    capped.feed(emails.data(), emails.size());
+    auto first_two = capped.finish();
+    assert(first_two.size() == 2 && first_two[1].value == "c@d.ee");
+    assert(same(detect_pii(emails, builtin_only, 2), first_two));
+
+    // Once every type is full, later chunks are ignored; the first detection
+    // of each type is still the one reported.
+    std::string one_each = "a@b.cc +1 (555) 010-0199 AB1234567 GB82WEST12345698765432 4111 1111 1111 1111 ";
+    for (int i = 0; i < 20; ++i) one_each += "x@y.zz 4012 8888 8888 1881 ";
+    PiiStream full(builtin_only, 64, 1);
+    for (size_t pos = 0; pos < one_each.size(); pos += 10) {
+        full.feed(one_each.data() + pos, std::min<size_t>(10, one_each.size() - pos));
+    }
+    auto kept = full.finish();
+    assert(kept.size() == 5 && same(kept, detect_pii(one_each, builtin_only, 1)));
     return 0;
 }
 
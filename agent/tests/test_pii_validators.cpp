@@ -0,0 +1,82 @@
+#include <cassert>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/pii_validators.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+// Luhn over a plain digit string, one digit at a time.
+static bool reference_luhn(const std::string &digits) {
+    int sum = 0;
+    for (size_t i = 0; i < digits.size(); ++i) {
+        int n = digits[digits.size() - 1 - i] - '0';
+        if (i % 2 == 1) n = n * 2 > 9 ? n * 2 - 9 : n * 2;
+        sum += n;
+    }
+    return sum % 10 == 0;
+}
+
+int main() {
+    assert(valid_card_number("4111 1111 1111 1111"));
+    assert(valid_card_number("4111-1111-1111-1111"));
+    assert(valid_card_number("4111111111111111"));
+    assert(valid_card_number("378282246310005"));
+    assert(!valid_card_number("4111 1111 1111 1112"));
+    assert(!valid_card_number("4111  1111 1111 1111"));
+    assert(!valid_card_number("4111 1111 1111 1111 "));
+    assert(!valid_card_number("-4111 1111 1111 1111"));
+    assert(!valid_card_number("411111111116"));
+    assert(!valid_card_number("41111111111111111113"));
+    assert(!valid_card_number(""));
+
+    // The batch agrees with the definition for every value, whatever its
+    // position in a lane group.
+    std::mt19937 rng(7);
+    std::vector<std::string> values;
+    std::vector<bool> expected;
+    for (int i = 0; i < 1000; ++i) {
+        std::string digits;
+        for (size_t n = 10 + rng() % 12; n > 0; --n) digits += static_cast<char>('0' + rng() % 10);
+        std::string value;
+        for (size_t d = 0; d < digits.size(); ++d) {
+            if (d > 0 && rng() % 5 == 0) value += rng() % 2 ? ' ' : '-';
+            value += digits[d];
+        }
+        values.push_back(value);
+        expected.push_back(digits.size() >= 13 && digits.size() <= 19 && reference_luhn(digits));
+    }
+    std::vector<std::string_view> views(values.begin(), values.end());
+    std::unique_ptr<bool[]> valid(new bool[views.size()]);
+    valid_card_numbers(views.data(), views.size(), valid.get());
+    size_t passed = 0;
+    for (size_t i = 0; i < views.size(); ++i) {
+        assert(valid[i] == expected[i]);
+        assert(valid_card_number(views[i]) == expected[i]);
+        passed += valid[i];
+    }
+    assert(passed > 20);
+
+    assert(iban_length("GB") == 22 && iban_length("NO") == 15 && iban_length("US") == 0 && iban_length("gb") == 0);
+    assert(valid_iban("GB82WEST12345698765432"));
+    assert(valid_iban("DE89370400440532013000"));
+    assert(valid_iban("FR1420041010050500013M02606"));
+    assert(valid_iban("NO9386011117947"));
+    assert(!valid_iban("GB82WEST12345698765433"));
+    assert(!valid_iban("GB82WEST1234569876543"));
+    assert(!valid_iban("US82WEST12345698765432"));
+    assert(!valid_iban("GB82west12345698765432"));
+    assert(!valid_iban("GB82 WEST 1234 5698 7654 32"));
+
+    assert(valid_ssn("123-45-6789") && valid_ssn("123 45 6789"));
+    assert(!valid_ssn("000-45-6789") && !valid_ssn("666-45-6789") && !valid_ssn("912-45-6789"));
+    assert(!valid_ssn("123-00-6789") && !valid_ssn("123-45-0000") && !valid_ssn("123-45 6789"));
+    assert(valid_national_id("123-45-6789") && !valid_national_id("666-45-6789"));
+    assert(valid_national_id("AB 12 34 56 C"));
+    return 0;
+}
+
+#endif
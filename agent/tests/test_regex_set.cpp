@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "../src/regex_set.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+// Random patterns over the subset RegexSet compiles, and texts over the same
+// few bytes so that they match often enough to be interesting.
+class PatternGen {
+public:
+    explicit PatternGen(uint32_t seed) : rng_(seed) {}
+
+    std::string pattern() {
+        std::string p;
+        if (pick(5) == 0) p += '^';
+        p += sequence(0);
+        if (pick(5) == 0) p += '$';
+        return p;
+    }
+
+    std::string text(size_t max_len) {
+        static const char alphabet[] = "aab b1-2_cA";
+        std::string t;
+        const size_t len = pick(max_len + 1);
+        for (size_t i = 0; i < len; ++i) t += alphabet[pick(sizeof(alphabet) - 1)];
+        return t;
+    }
+
+    uint32_t pick(size_t n) { return static_cast<uint32_t>(rng_() % n); }
+
+private:
+    std::string sequence(int depth) {
+        std::string s;
+        const uint32_t items = 1 + pick(depth == 0 ? 4 : 2);
+        for (uint32_t i = 0; i < items; ++i) s += piece(depth);
+        return s;
+    }
+
+    std::string piece(int depth) {
+        switch (pick(12)) {
+            case 0: return "\\b";
+            case 1: return "\\B";
+            default: break;
+        }
+        std::string atom = this->atom(depth);
+        // Groups only take bounded quantifiers: (x+)+ backtracks
+        // exponentially in std::regex.
+        static const char *quantifiers[] = {"?", "{2}", "{1,3}", "{0,2}", "*", "+", "{2,}"};
+        const size_t choices = atom[0] == '(' ? 4 : 7;
+        if (pick(3) == 0) {
+            atom += quantifiers[pick(choices)];
+            if (pick(3) == 0) atom += '?';
+        }
+        return atom;
+    }
+
+    std::string atom(int depth) {
+        static const char *atoms[] = {"a", "b", "1", "-", " ", "A", ".", "\\d", "\\w", "\\s", "\\W",
+                                      "[ab]", "[^a]", "[a-c]", "[0-9_]", "[^\\d ]", "\\-"};
+        // One level of groups keeps std::regex's backtracking affordable.
+        if (depth == 0 && pick(4) == 0) {
+            std::string group = "(" + sequence(depth + 1);
+            if (pick(2) == 0) group += "|" + sequence(depth + 1);
+            return group + ")";
+        }
+        return atoms[pick(sizeof(atoms) / sizeof(atoms[0]))];
+    }
+
+    std::mt19937 rng_;
+};
+
+static std::vector<uint32_t> reference(const std::vector<std::regex> &regexes, const std::string &text) {
+    std::vector<uint32_t> ids;
+    for (size_t i = 0; i < regexes.size(); ++i) {
+        if (std::regex_search(text, regexes[i])) ids.push_back(static_cast<uint32_t>(i));
+    }
+    return ids;
+}
+
+int main() {
+    // Sets of random patterns against per-pattern std::regex_search.
+    PatternGen gen(20240317);
+    size_t compiled = 0;
+    for (int round = 0; round < 500; ++round) {
+        RegexSet set;
+        std::vector<std::regex> regexes;
+        const uint32_t patterns = 1 + gen.pick(12);
+        for (uint32_t i = 0; i < patterns; ++i) {
+            std::string pattern = gen.pattern();
+            if (!set.add(pattern, static_cast<uint32_t>(regexes.size()))) continue;
+            regexes.emplace_back(pattern, std::regex::ECMAScript);
+        }
+        set.build();
+        compiled += regexes.size();
+        for (int t = 0; t < 60; ++t) {
+            const std::string text = gen.text(40);
+            std::vector<uint32_t> ids;
+            set.match(text.data(), text.size(), ids);
+            assert(ids == reference(regexes, text));
+        }
+    }
+    assert(compiled > 1000);
+
+    // A pattern whose DFA has thousands of states: the cache is flushed
+    // mid-scan, more than once, and the result must not change.
+    {
+        RegexSet set;
+        std::vector<std::regex> regexes;
+        for (const char *pattern : {"a[ab]{12}c", "b[ab]{11}a{2}c", "\\bba{3}b\\b", "^[ab]{4}c"}) {
+            assert(set.add(pattern, static_cast<uint32_t>(regexes.size())));
+            regexes.emplace_back(pattern, std::regex::ECMAScript);
+        }
+        set.build();
+        std::mt19937 rng(5);
+        for (int round = 0; round < 8; ++round) {
+            std::string text;
+            for (int i = 0; i < 60000; ++i) text += rng() % 2 ? 'a' : 'b';
+            if (round % 2 == 1) text[text.size() - 1 - rng() % 32] = 'c';
+            std::vector<uint32_t> ids;
+            set.match(text.data(), text.size(), ids);
+            assert(ids == reference(regexes, text));
+        }
+    }
+
+    // Many patterns live at once make every DFA state's key kilobytes long:
+    // the thread's DFAs stay within their byte budget, flushing well before
+    // the state limit, and answers do not change.
+    {
+        RegexSet set;
+        std::vector<std::regex> regexes;
+        std::vector<std::string> patterns = {"a[ab]{12}c", "b[ab]{11}a{2}c"};
+        for (int i = 0; i < 200; ++i) patterns.push_back("[ab]{0,6}d" + std::to_string(i));
+        for (const auto &pattern : patterns) {
+            assert(set.add(pattern, static_cast<uint32_t>(regexes.size())));
+            regexes.emplace_back(pattern, std::regex::ECMAScript);
+        }
+        set.build();
+        std::mt19937 rng(9);
+        size_t peak = 0;
+        for (int round = 0; round < 2; ++round) {
+            std::string text;
+            for (int i = 0; i < 6000; ++i) text += rng() % 2 ? 'a' : 'b';
+            if (round % 2 == 1) text += "bd17c";
+            std::vector<uint32_t> ids;
+            set.match(text.data(), text.size(), ids);
+            assert(ids == reference(regexes, text));
+            peak = std::max(peak, RegexSet::thread_dfa_bytes());
+        }
+        assert(peak > RegexSet::kDfaBytesPerThread / 2);
+        assert(peak <= RegexSet::kDfaBytesPerThread + 64 * 1024);
+    }
+
+    // Sets scanned in turn on one thread, more of them than it keeps DFAs
+    // for, each answer as if scanned alone.
+    {
+        const char *patterns[] = {"\\d{3}-\\d{2}", "\\bsecret\\b", "^[a-z]+@", "[A-Z]{2}\\d{2}", "x+y$", "q(u|v)?z"};
+        std::vector<RegexSet> sets(6);
+        for (size_t i = 0; i < sets.size(); ++i) {
+            assert(sets[i].add(patterns[i], static_cast<uint32_t>(i)));
+            sets[i].build();
+        }
+        const std::string text = "jo@ 123-45 secret GB82 xxy quz";
+        for (int pass = 0; pass < 3; ++pass) {
+            for (size_t i = 0; i < sets.size(); ++i) {
+                const uint32_t id = static_cast<uint32_t>((i * 5 + pass) % sets.size());
+                std::vector<uint32_t> ids;
+                sets[id].match(text.data(), text.size(), ids);
+                assert(ids == (id == 4 ? std::vector<uint32_t>{} : std::vector<uint32_t>{id}));
+            }
+        }
+    }
+
+    // Unsupported constructs are refused and leave the set usable.
+    {
+        RegexSet set;
+        assert(!set.add("(a)\\1", 0));
+        assert(!set.add("pass(?=word)", 1));
+        assert(set.add("word", 2));
+        set.build();
+        std::vector<uint32_t> ids;
+        set.match("password", 8, ids);
+        assert(ids == std::vector<uint32_t>{2});
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include <cassert>
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/rule_engine.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+// Randomized differential test: RuleEngine::evaluate must pick exactly the
+// decision of the plain full scan over every rule.
+
+namespace reference {
+
+static std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+static bool bool_match(const std::string &value, bool actual) {
+    std::string v = lower(value);
+    if (v == "true" || v == "1") return actual;
+    if (v == "false" || v == "0") return !actual;
+    return false;
+}
+
+static bool string_match(const std::string &op, const std::string &actual, const std::string &expected) {
+    std::string o = lower(op);
+    if (o == "contains") return actual.find(expected) != std::string::npos;
+    if (o == "starts_with") return actual.rfind(expected, 0) == 0;
+    if (o == "ends_with") {
+        return expected.size() <= actual.size() &&
+               actual.compare(actual.size() - expected.size(), expected.size(), expected) == 0;
+    }
+    return actual == expected;
+}
+
+static bool condition(const RuleCondition &c, const RuleContext &ctx) {
+    std::string f = lower(c.field);
+    if (f == "file.extension") return string_match(c.op, ctx.extension, c.value);
+    if (f == "file.path") return string_match(c.op, ctx.path, c.value);
+    if (f == "user") return string_match(c.op, ctx.user, c.value);
+    if (f == "contains_pii") return bool_match(c.value, ctx.contains_pii);
+    if (f == "removable_drive") return bool_match(c.value, ctx.removable_drive);
+    return false;
+}
+
+static int rank(RuleAction a) {
+    switch (a) {
+        case RuleAction::Block: return 5;
+        case RuleAction::Quarantine: return 4;
+        case RuleAction::ShadowCopy: return 3;
+        case RuleAction::Alert: return 2;
+        case RuleAction::Allow: return 1;
+    }
+    return 0;
+}
+
+static RuleAction default_action(int severity) {
+    if (g_enable_quarantine && severity >= g_quarantine_severity_threshold) return RuleAction::Quarantine;
+    if (severity >= g_block_severity_threshold) return RuleAction::Block;
+    if (g_enable_shadow_copy && severity >= g_shadow_copy_severity_threshold) return RuleAction::ShadowCopy;
+    if (severity > 0) return RuleAction::Alert;
+    return RuleAction::Allow;
+}
+
+static bool hit_for(const Rule &rule, const RuleMatch &hit) {
+    return (!rule.id.empty() && hit.rule_id == rule.id) || (!rule.name.empty() && hit.rule_name == rule.name);
+}
+
+static RuleDecision evaluate(const std::vector<Rule> &rules, const RuleContext &ctx,
+                             const std::vector<RuleMatch> &matches) {
+    RuleDecision best;
+    bool has_best = false;
+    for (const auto &rule : rules) {
+        if (!rule.enabled) continue;
+        bool matched = false;
+        if (rule.type == "regex" || rule.type == "keyword" || rule.type == "hash") {
+            for (const auto &hit : matches) matched = matched || hit_for(rule, hit);
+        } else {
+            matched = !rule.conditions.empty();
+        }
+        for (const auto &c : rule.conditions) matched = matched && condition(c, ctx);
+        if (!matched) continue;
+        RuleDecision d;
+        d.rule_id = rule.id;
+        d.rule_name = rule.name;
+        d.priority = rule.priority;
+        d.severity = rule.severity;
+        if (d.severity == 0) {
+            for (const auto &hit : matches) {
+                if (hit_for(rule, hit)) d.severity = std::max(d.severity, hit.severity);
+            }
+        }
+        d.action = rule.actions.empty() ? default_action(d.severity) : rule.actions.front();
+        d.reason = !rule.name.empty() ? rule.name : !rule.id.empty() ? rule.id : "rule_match";
+        if (!has_best || d.priority > best.priority ||
+            (d.priority == best.priority && d.severity > best.severity) ||
+            (d.priority == best.priority && d.severity == best.severity && rank(d.action) > rank(best.action))) {
+            best = d;
+            has_best = true;
+        }
+    }
+    if (!has_best) {
+        best.action = RuleAction::Allow;
+        best.reason = "no_match";
+    }
+    return best;
+}
+
+}  // namespace reference
+
+int main() {
+    g_content_keywords.clear();
+    std::mt19937 rng(20240601);
+    const char *names[] = {"", "a", "b", "c", "d", "e"};
+    const char *types[] = {"regex", "keyword", "hash", "", "composite"};
+    const RuleCondition conditions[] = {
+        {"file.extension", "==", ".docx"}, {"FILE.PATH", "starts_with", "C:\\fin"},
+        {"user", "contains", "ob"},        {"contains_pii", "==", "true"},
+        {"removable_drive", "eq", "0"},    {"file.path", "ends_with", ".docx"},
+    };
+    const char *words[] = {"alpha", "beta", "gamma"};
+
+    for (int iter = 0; iter < 20000; ++iter) {
+        g_enable_quarantine = rng() % 2;
+        g_enable_shadow_copy = rng() % 2;
+        g_quarantine_severity_threshold = 6 + rng() % 4;
+        g_block_severity_threshold = 5 + rng() % 4;
+        g_shadow_copy_severity_threshold = 3 + rng() % 4;
+
+        std::vector<Rule> rules;
+        const int count = 1 + rng() % 12;
+        for (int i = 0; i < count; ++i) {
+            Rule rule;
+            rule.id = names[rng() % 6];
+            rule.name = names[rng() % 6];
+            rule.type = types[rng() % 5];
+            if (rule.type == "regex") rule.pattern = words[rng() % 3];
+            if (rule.type == "keyword") rule.keywords = {words[rng() % 3]};
+            rule.priority = rng() % 4;
+            rule.severity = rng() % 3 == 0 ? 0 : static_cast<int>(rng() % 11);
+            rule.enabled = rng() % 8 != 0;
+            for (int k = rng() % 3; k > 0; --k) rule.conditions.push_back(conditions[rng() % 6]);
+            if (rng() % 2) rule.actions.push_back(static_cast<RuleAction>(rng() % 5));
+            rules.push_back(rule);
+        }
+        RuleEngine engine;
+        engine.load_from_rules(rules);
+        assert(engine.load_errors().empty());
+
+        std::string text;
+        for (int w = rng() % 4; w > 0; --w) text += std::string(words[rng() % 3]) + " ";
+        std::vector<RuleMatch> matches = engine.scan_text(text);
+        for (int m = rng() % 3; m > 0; --m) {
+            RuleMatch hit;
+            hit.rule_id = names[rng() % 6];
+            hit.rule_name = names[rng() % 6];
+            hit.severity = rng() % 11;
+            matches.insert(matches.begin() + rng() % (matches.size() + 1), hit);
+        }
+
+        RuleContext ctx;
+        ctx.extension = rng() % 2 ? ".docx" : ".txt";
+        ctx.path = rng() % 2 ? "C:\\fin\\q.docx" : "D:\\x.txt";
+        ctx.user = rng() % 2 ? "bob" : "al";
+        ctx.contains_pii = rng() % 2;
+        ctx.removable_drive = rng() % 2;
+
+        RuleDecision expected = reference::evaluate(rules, ctx, matches);
+        RuleDecision actual = engine.evaluate(ctx, matches);
+        assert(actual.rule_id == expected.rule_id);
+        assert(actual.rule_name == expected.rule_name);
+        assert(actual.priority == expected.priority);
+        assert(actual.severity == expected.severity);
+        assert(actual.action == expected.action);
+        assert(actual.reason == expected.reason);
+    }
+    return 0;
+}
+
+#endif
@@ -1,5 +1,11 @@
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
 
+#include "../src/config.h"
 #include "../src/enterprise/rules/rule_engine_v2.h"
 
 #if defined(DLP_ENABLE_TESTS)
@@ -35,6 +41,307 @@ int main() {
     context.drive_type = "FIXED";
     auto decision = engine.Evaluate(context, {});
     assert(decision.rule_id == "high");
+
+    Rule path;
+    path.id = "path";
+    path.priority = 20;
+    path.conditions = {{"File.Path", "STARTS_WITH", "C:\\Finance"}, {"removable_drive", "==", "1"}};
+    Rule typo;
+    typo.id = "typo";
+    typo.priority = 30;
+    typo.conditions = {{"file.extention", "==", ".docx"}};
+    engine.LoadRules({low, high, path, typo});
+    assert(engine.LoadErrors().size() == 1);
+    assert(engine.SnapshotRules().size() == 3);
+    context.path = "C:\\Finance\\q3.docx";
+    assert(engine.Evaluate(context, {}).rule_id == "high");
+    context.removable_drive = true;
+    assert(engine.Evaluate(context, {}).rule_id == "path");
+
+    Rule keywords;
+    keywords.id = "kw";
+    keywords.type = "keyword";
+    keywords.severity = 4;
+    keywords.keywords = {"Secret", "payroll", "missing"};
+    engine.LoadRules({keywords});
+    auto hits = engine.ScanText("PAYROLL export marked secret");
+    assert(hits.size() == 1);
+    assert(hits[0].match_count == 2);
+    assert(hits[0].match == "Secret");
+
+    Rule ssn;
+    ssn.id = "ssn";
+    ssn.type = "regex";
+    ssn.pattern = "\\b\\d{3}-\\d{2}-\\d{4}\\b";
+    Rule lookahead;
+    lookahead.id = "lookahead";
+    lookahead.type = "regex";
+    lookahead.pattern = "pass(?=word)";
+    engine.LoadRules({ssn, lookahead});
+    hits = engine.ScanText("ids 123-45-6789 and 987-65-4321, password");
+    assert(hits.size() == 2);
+    assert(hits[0].rule_id == "ssn" && hits[0].match_count == 2 && hits[0].match == "123-45-6789");
+    assert(hits[1].rule_id == "lookahead" && hits[1].match == "pass");
+    assert(engine.ScanText("no identifiers here").empty());
+
+    const std::string policy = R"({
+        "policy": {"name": "p", "description": "\"rules\": [ignored]"},
+        "rules": [
+            {"id": "ssn", "type": "REGEX", "pattern": "\\b\\d{3}-\\d{2}-\\d{4}\\b",
+             "severity": "high", "conditions": [{"field": "contains_pii", "value": true}]},
+            {"id": "off", "type": "keyword", "keywords": ["a\u00e9"], "enabled": false}
+        ]
+    })";
+    assert(engine.LoadFromString(policy));
+    auto loaded = engine.SnapshotRules();
+    assert(loaded.size() == 2);
+    assert(loaded[0].type == "regex" && loaded[0].pattern == "\\b\\d{3}-\\d{2}-\\d{4}\\b");
+    assert(loaded[0].severity == 8 && loaded[0].conditions[0].value == "true");
+    assert(loaded[1].keywords[0] == "a\xc3\xa9" && !loaded[1].enabled);
+    assert(engine.ScanText("id 123-45-6789").size() == 1);
+    assert(!engine.LoadFromString("{\"rules\": [}"));
+
+    {
+        std::ofstream("test_pack_policy.json")
+            << R"({"rule_packs": ["test_pack_a.json", "test_pack_missing.json", "test_pack_b.json"],
+                  "rules": [{"id": "dup", "type": "keyword", "keywords": ["inline"]}]})";
+        std::ofstream("test_pack_a.json")
+            << R"({"rules": [{"id": "dup", "type": "keyword", "keywords": ["shadowed"]},
+                             {"id": "acct", "type": "regex", "pattern": "ACCT-\\d+"}]})";
+        std::ofstream("test_pack_b.json")
+            << R"({"rules": [{"id": "acct", "type": "keyword", "keywords": ["shadowed"]},
+                             {"id": "pack_b", "type": "keyword", "keywords": ["bravo"]}]})";
+    }
+    Rule fallback;
+    fallback.id = "pack_b";
+    fallback.type = "keyword";
+    fallback.keywords = {"shadowed"};
+    Rule extra;
+    extra.id = "extra";
+    extra.type = "keyword";
+    extra.keywords = {"extra"};
+    for (int pass = 0; pass < 2; ++pass) {
+        assert(engine.LoadFromFile("test_pack_policy.json", {fallback, extra}));
+        assert(engine.LoadErrors().size() == 1);
+        loaded = engine.SnapshotRules();
+        assert(loaded.size() == 4);
+        assert(loaded[0].id == "dup" && loaded[1].id == "acct" && loaded[2].id == "pack_b" &&
+               loaded[3].id == "extra");
+        hits = engine.ScanText("inline ACCT-42 bravo extra shadowed");
+        assert(hits.size() == 4);
+        assert(hits[1].rule_id == "acct" && hits[1].match == "ACCT-42");
+    }
+
+    std::string image_error;
+    assert(engine.SaveImage("test_policy.bin", 7, &image_error));
+    RuleEngineV2 mapped;
+    assert(!mapped.LoadFromImage("test_policy.bin", 8, &image_error));
+    assert(mapped.LoadFromImage("test_policy.bin", 7, &image_error));
+    assert(mapped.LoadErrors() == engine.LoadErrors());
+    auto mapped_rules = mapped.SnapshotRules();
+    assert(mapped_rules.size() == 4 && mapped_rules[1].pattern == loaded[1].pattern);
+    auto mapped_hits = mapped.ScanText("inline ACCT-42 bravo extra shadowed");
+    assert(mapped_hits.size() == 4);
+    for (size_t i = 0; i < hits.size(); ++i) {
+        assert(mapped_hits[i].rule_id == hits[i].rule_id && mapped_hits[i].match == hits[i].match);
+    }
+    assert(mapped.Evaluate(RuleContext{}, mapped_hits).rule_id == engine.Evaluate(RuleContext{}, hits).rule_id);
+    {
+        std::fstream image("test_policy.bin", std::ios::in | std::ios::out | std::ios::binary);
+        image.seekp(-3, std::ios::end);
+        image.put('\x7f');
+    }
+    assert(!mapped.LoadFromImage("test_policy.bin", 7, &image_error));
+    assert(image_error.find("checksum") != std::string::npos);
+    assert(engine.SaveImage("test_policy.bin", 7));
+    std::ofstream("test_pack_b.json", std::ios::app) << " ";
+    assert(!mapped.LoadFromImage("test_policy.bin", 7, &image_error));
+    assert(image_error.find("test_pack_b.json") != std::string::npos);
+    std::remove("test_policy.bin");
+    std::remove("test_pack_policy.json");
+    std::remove("test_pack_a.json");
+    std::remove("test_pack_b.json");
+
+    // More packs than loader threads still merge in list order.
+    {
+        std::string list;
+        for (int i = 0; i < 40; ++i) {
+            const std::string id = "pack" + std::to_string(i);
+            std::ofstream("test_" + id + ".json")
+                << R"({"rules": [{"id": ")" << id << R"(", "type": "keyword", "keywords": [")" << id << "\"]}]}";
+            list += (i ? ", \"test_" : "\"test_") + id + ".json\"";
+        }
+        std::ofstream("test_pack_policy.json") << "{\"rule_packs\": [" << list << "]}";
+        assert(engine.LoadFromFile("test_pack_policy.json"));
+        assert(engine.LoadErrors().empty());
+        loaded = engine.SnapshotRules();
+        assert(loaded.size() == 40);
+        for (int i = 0; i < 40; ++i) {
+            assert(loaded[i].id == "pack" + std::to_string(i));
+            std::remove(("test_pack" + std::to_string(i) + ".json").c_str());
+        }
+        std::remove("test_pack_policy.json");
+    }
+
+    // A fetched policy cannot name packs outside the rules directory.
+    {
+        const std::string fetched = R"({"rule_packs": ["/etc/passwd", "C:\\Windows\\x.json", "c:x.json",
+                                                       "\\\\host\\share\\x.json", "../x.json",
+                                                       "packs/..\\..\\x.json", "packs/../x.json"],
+                                        "rules": [{"id": "kept", "type": "keyword", "keywords": ["kept"]}]})";
+        assert(engine.LoadFromString(fetched));
+        assert(engine.LoadErrors().size() == 7);
+        for (const auto &error : engine.LoadErrors()) {
+            assert(error.find("outside the rules directory") != std::string::npos);
+        }
+        assert(engine.SnapshotRules().size() == 1);
+    }
+
+    const std::string full(64, 'a');
+    const std::string partial(64, 'b');
+    Rule ioc;
+    ioc.id = "ioc";
+    ioc.type = "hash";
+    ioc.hashes = {"not-a-hash", std::string(64, 'B'), full};
+    Rule known;
+    known.id = "known";
+    known.type = "hash";
+    known.hashes = {full};
+    engine.LoadRules({ioc, known});
+    assert(engine.LoadErrors().size() == 1);
+    hits = engine.ScanHashes(full, partial);
+    assert(hits.size() == 2);
+    assert(hits[0].rule_id == "ioc" && hits[0].match == std::string(64, 'B'));
+    assert(hits[1].rule_id == "known" && hits[1].match == full);
+    assert(engine.ScanHashes(std::string(64, 'c'), "").empty());
+
+    const std::string kw_rule = R"({"id": "kw", "type": "keyword", "keywords": ["secret"], "severity": 3})";
+    const std::string hash_rule = R"({"id": "ioc", "type": "hash", "hashes": [")" + full + R"("]})";
+    const std::string base = "{\"rules\": [" + kw_rule + R"(, {"id": "acct", "type": "regex", "pattern": "ACCT-\\d+"}, )" +
+                             hash_rule + "]}";
+    const std::string changed = R"({"rules": [{"id": "tmp", "conditions": [{"field": "file.extension", "op": "==", "value": ".tmp"}]}, )" +
+                                kw_rule + R"(, {"id": "case", "type": "regex", "pattern": "CASE-\\d+"}, )" + hash_rule + "]}";
+    RuleEngineV2 first;
+    assert(first.LoadFromString(base));
+    assert(first.LastReloadStats().compiled_rules == 3 && first.LastReloadStats().reused_rules == 0);
+    RuleEngineV2 second;
+    assert(second.LoadFromString(base, {}, first.Current()));
+    auto stats = second.LastReloadStats();
+    assert(stats.reused_rules == 3 && stats.compiled_rules == 0);
+    assert(stats.reused_keywords && stats.reused_regex_set && stats.reused_hashes);
+    assert(second.ScanText("secret ACCT-9").size() == 2);
+    RuleEngineV2 third;
+    assert(third.LoadFromString(changed, {}, second.Current()));
+    stats = third.LastReloadStats();
+    assert(stats.reused_rules == 2 && stats.compiled_rules == 2);
+    assert(stats.reused_keywords && !stats.reused_regex_set && stats.reused_hashes);
+    auto current = third.SnapshotRules();
+    hits = third.ScanText("secret ACCT-9 CASE-7");
+    assert(hits.size() == 2 && hits[0].rule_id == "kw" && hits[1].rule_id == "case");
+    auto hash_hits = third.ScanHashes(full, "");
+    assert(hash_hits.size() == 1 && hash_hits[0].rule_id == "ioc");
+    hits.push_back(hash_hits[0]);
+    for (const auto &hit : hits) {
+        assert(current[hit.rule_index].id == hit.rule_id);
+    }
+    assert(third.Evaluate(RuleContext{}, hits).rule_id == "kw");
+
+    // A reader thread keeps its snapshot between reads and picks up every
+    // publish; reads of other engines in between do not confuse it.
+    {
+        RuleEngineV2 live;
+        std::atomic<int> published{0};
+        std::atomic<bool> done{false};
+        std::thread reader([&] {
+            size_t seen = 0;
+            while (seen < 50) {
+                const int expected = published.load();
+                assert(third.Current()->rules().size() == 4);
+                const size_t rules = live.Current()->rules().size();
+                assert(rules >= static_cast<size_t>(expected));
+                seen = rules;
+            }
+            done = true;
+        });
+        for (int i = 1; i <= 50; ++i) {
+            std::vector<Rule> rules(static_cast<size_t>(i));
+            for (int r = 0; r < i; ++r) {
+                rules[r].id = "r" + std::to_string(r);
+                rules[r].type = "keyword";
+                rules[r].keywords = {"k" + std::to_string(r)};
+            }
+            live.LoadRules(rules);
+            published = i;
+        }
+        reader.join();
+        assert(done && live.Current()->rules().size() == 50);
+    }
+
+    // Chunked scanning finds what a whole-buffer scan finds, wherever the
+    // chunk boundaries fall.
+    RuleEngine streamed;
+    Rule kw;
+    kw.id = "kw";
+    kw.type = "keyword";
+    kw.keywords = {"secret", "top secret", "Payroll"};
+    Rule acct;
+    acct.id = "acct";
+    acct.type = "regex";
+    acct.pattern = "ACCT-\\d{2,6}";
+    Rule word;
+    word.id = "word";
+    word.type = "regex";
+    word.pattern = "\\bcase\\b";
+    Rule tail;
+    tail.id = "tail";
+    tail.type = "regex";
+    tail.pattern = "end$";
+    Rule backref;
+    backref.id = "backref";
+    backref.type = "regex";
+    backref.pattern = "(ab)\\1";
+    streamed.load_from_rules({kw, acct, word, tail, backref});
+    assert(streamed.load_errors().empty());
+    const char *tokens[] = {"secret ", "top ", "PAYROLL", "ACCT-", "123456", "7", "case", "cases ",
+                            "abab", " ", "end", "x"};
+    std::mt19937 rng(7);
+    for (int iter = 0; iter < 2000; ++iter) {
+        std::string text;
+        for (int t = rng() % 40; t > 0; --t) text += tokens[rng() % 12];
+        std::string whole_keyword;
+        auto whole = streamed.scan_text(text, &whole_keyword);
+        RuleEngine::TextStream stream(streamed, 16);
+        for (size_t pos = 0; pos < text.size();) {
+            size_t len = std::min<size_t>(1 + rng() % 9, text.size() - pos);
+            stream.feed(text.data() + pos, len);
+            pos += len;
+        }
+        std::string chunked_keyword;
+        auto chunked = stream.finish(&chunked_keyword);
+        assert(chunked.size() == whole.size());
+        for (size_t h = 0; h < whole.size(); ++h) {
+            assert(chunked[h].rule_id == whole[h].rule_id);
+            assert(chunked[h].match_count == whole[h].match_count);
+            assert(chunked[h].match == whole[h].match);
+        }
+        assert(chunked_keyword == whole_keyword);
+    }
+
+    // A regex rule stops at the match limit, whole or chunked, and keeps its
+    // first match.
+    const size_t default_limit = g_rule_match_limit;
+    g_rule_match_limit = 5;
+    std::string accounts;
+    for (int i = 0; i < 50; ++i) accounts += "ACCT-" + std::to_string(1000 + i) + " ";
+    auto limited = streamed.scan_text(accounts);
+    assert(limited.size() == 1 && limited[0].match_count == 5 && limited[0].match == "ACCT-1000");
+    RuleEngine::TextStream limited_stream(streamed, 16);
+    for (size_t pos = 0; pos < accounts.size(); pos += 7) {
+        limited_stream.feed(accounts.data() + pos, std::min<size_t>(7, accounts.size() - pos));
+    }
+    limited = limited_stream.finish();
+    assert(limited.size() == 1 && limited[0].match_count == 5 && limited[0].match == "ACCT-1000");
+    g_rule_match_limit = default_limit;
     return 0;
 }
 
@@ -0,0 +1,73 @@
+#include <cassert>
+#include <chrono>
+#include <string>
+
+#include "../src/scan_cache.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+static ScanOutcome outcome(const std::string &sha, const std::string &rule) {
+    ScanOutcome scan;
+    scan.sha256 = sha;
+    RuleMatch hit;
+    hit.rule_id = rule;
+    scan.rule_hits.push_back(hit);
+    return scan;
+}
+
+int main() {
+    using us = std::chrono::microseconds;
+    ScanCache cache(2);
+    const FileIdentity report{1, 100, 5000, 777};
+    const FileIdentity renamed = report;
+    FileIdentity edited = report;
+    edited.mtime = 778;
+    ScanOutcome out;
+
+    assert(!cache.find(1, report, out));
+    cache.insert(1, report, outcome("aa", "kw"), us(400));
+    assert(cache.find(1, renamed, out) && out.rule_hits[0].rule_id == "kw");
+    assert(!cache.find(1, edited, out));
+
+    // A copy: new file index, same size and mtime; confirmed by content hash.
+    const FileIdentity copy{1, 200, 5000, 777};
+    std::string sha;
+    assert(!cache.find(1, copy, out));
+    assert(cache.copy_candidate(1, copy, sha) && sha == "aa");
+    assert(!cache.find_content(1, "bb", copy, out));
+    assert(cache.find_content(1, sha, copy, out) && out.sha256 == "aa");
+    assert(cache.find(1, copy, out));
+
+    auto stats = cache.stats();
+    assert(stats.identity_hits == 2 && stats.content_hits == 1 && stats.saved == us(1200));
+    assert(stats.entries == 2);
+
+    // A peek finds the same entries without counting.
+    assert(cache.peek(1, report, out) && out.rule_hits[0].rule_id == "kw");
+    assert(!cache.peek(1, edited, out));
+    assert(cache.stats().lookups == stats.lookups && cache.stats().identity_hits == stats.identity_hits &&
+           cache.stats().saved == stats.saved);
+
+    // Least recently used goes first; its indexes go with it.
+    const FileIdentity other{1, 300, 10, 5};
+    cache.insert(1, other, outcome("cc", "other"), us(10));
+    assert(cache.stats().evictions == 1 && cache.stats().entries == 2);
+    assert(!cache.find(1, report, out));
+    assert(cache.find(1, copy, out));
+
+    // A newer policy generation empties the cache; stores from an older
+    // one are ignored.
+    assert(!cache.find(2, copy, out));
+    assert(cache.stats().entries == 0);
+    cache.insert(1, copy, outcome("aa", "kw"), us(1));
+    assert(cache.stats().entries == 0);
+    cache.insert(2, copy, outcome("aa", "kw"), us(1));
+    assert(cache.find(2, copy, out));
+
+    ScanCache disabled(0);
+    disabled.insert(1, report, outcome("aa", "kw"), us(1));
+    assert(!disabled.find(1, report, out));
+    return 0;
+}
+
+#endif
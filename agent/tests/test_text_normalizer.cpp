@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/pii_detector.h"
+#include "../src/text_normalizer.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+static std::string utf16(const std::vector<uint16_t> &units, bool big_endian) {
+    std::string out;
+    for (uint16_t u : units) {
+        char lo = static_cast<char>(u & 0xFF);
+        char hi = static_cast<char>(u >> 8);
+        out += big_endian ? hi : lo;
+        out += big_endian ? lo : hi;
+    }
+    return out;
+}
+
+static std::vector<uint16_t> ascii_units(const std::string &text) {
+    return std::vector<uint16_t>(text.begin(), text.end());
+}
+
+// Feeds `data` in pieces of `step` bytes, after a first one of `first` bytes
+// (the one the encoding is decided from), and collects the normalized text.
+static std::string normalize(TextNormalizer &normalizer, const std::string &data, size_t step, size_t first = 0) {
+    std::string out;
+    first = std::min(first, data.size());
+    if (first > 0) out += normalizer.feed(data.data(), first);
+    for (size_t pos = first; pos < data.size(); pos += step) {
+        out += normalizer.feed(data.data() + pos, std::min(step, data.size() - pos));
+    }
+    out += normalizer.finish();
+    return out;
+}
+
+int main() {
+    const std::string sentence = "Contact alice@example.com, card 4111 1111 1111 1111.";
+
+    // Plain bytes pass through; a UTF-8 byte order mark is dropped.
+    {
+        TextNormalizer normalizer;
+        assert(normalize(normalizer, sentence, 7) == sentence);
+        assert(normalizer.encoding() == TextNormalizer::Encoding::Bytes);
+        assert(normalizer.source_offset(8) == 8);
+    }
+    {
+        TextNormalizer normalizer;
+        assert(normalize(normalizer, "\xEF\xBB\xBF" + sentence, 64) == sentence);
+        assert(normalizer.source_offset(0) == 3);
+    }
+
+    // UTF-16 in either byte order, with or without a byte order mark, and
+    // split at every chunk size including odd ones.
+    for (bool big_endian : {false, true}) {
+        const std::string bom = big_endian ? "\xFE\xFF" : "\xFF\xFE";
+        for (bool with_bom : {false, true}) {
+            const std::string data = (with_bom ? bom : "") + utf16(ascii_units(sentence), big_endian);
+            for (size_t step : {1, 2, 3, 5, 16, 33, 4096}) {
+                TextNormalizer normalizer;
+                assert(normalize(normalizer, data, step, with_bom ? 3 : 9) == sentence);
+                assert(normalizer.encoding() ==
+                       (big_endian ? TextNormalizer::Encoding::Utf16Be : TextNormalizer::Encoding::Utf16Le));
+                const uint64_t base = with_bom ? 2 : 0;
+                assert(normalizer.source_offset(8) == base + 16);
+                assert(normalizer.source_offset(sentence.size()) == data.size());
+            }
+        }
+    }
+
+    // Characters beyond ASCII, a surrogate pair split across chunks, and
+    // offsets mapped back through runs of different widths.
+    {
+        // "é€😀a": U+00E9, U+20AC, U+1F600, 'a'.
+        const std::vector<uint16_t> units = {0x00E9, 0x20AC, 0xD83D, 0xDE00, 'a'};
+        const std::string expected = "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"
+                                     "a";
+        const std::string data = "\xFF\xFE" + utf16(units, false);
+        for (size_t step = 1; step <= data.size(); ++step) {
+            TextNormalizer normalizer;
+            assert(normalize(normalizer, data, step, 2) == expected);
+            assert(normalizer.source_offset(0) == 2);
+            assert(normalizer.source_offset(2) == 4);
+            assert(normalizer.source_offset(5) == 6);
+            assert(normalizer.source_offset(9) == 10);
+            assert(normalizer.source_offset(10) == 12);
+        }
+    }
+
+    // Unpaired surrogates and a trailing odd byte become U+FFFD.
+    {
+        TextNormalizer normalizer;
+        const std::string data = "\xFF\xFE" + utf16({'a', 0xDC00, 'b', 0xD800}, false) + "c";
+        assert(normalize(normalizer, data, 3) == "a\xEF\xBF\xBD"
+                                                 "b\xEF\xBF\xBD\xEF\xBF\xBD");
+        assert(normalizer.source_offset(4) == 6);
+        assert(normalizer.source_offset(5) == 8);
+        assert(normalizer.source_offset(8) == 10);
+    }
+
+    // Binary data with scattered zeros is not mistaken for UTF-16.
+    {
+        std::string binary;
+        std::mt19937 rng(3);
+        for (int i = 0; i < 512; ++i) binary += static_cast<char>(rng() % 4 == 0 ? 0 : 1 + rng() % 255);
+        TextNormalizer normalizer;
+        assert(normalize(normalizer, binary, 100) == binary);
+        assert(normalizer.encoding() == TextNormalizer::Encoding::Bytes);
+    }
+
+    // Long mixed text takes the block path for ASCII runs and must agree
+    // with one unit at a time.
+    {
+        std::mt19937 rng(11);
+        std::vector<uint16_t> units;
+        std::string expected;
+        for (int i = 0; i < 20000; ++i) {
+            if (rng() % 64 == 0) {
+                units.push_back(0x0416);  // Cyrillic Zhe
+                expected += "\xD0\x96";
+            } else {
+                const char c = static_cast<char>(' ' + rng() % 95);
+                units.push_back(static_cast<uint8_t>(c));
+                expected += c;
+            }
+        }
+        for (bool big_endian : {false, true}) {
+            const std::string data = utf16(units, big_endian);
+            TextNormalizer whole;
+            TextNormalizer bytewise;
+            assert(normalize(whole, data, 65536) == expected);
+            assert(normalize(bytewise, data, 1, 9) == expected);
+            for (uint64_t offset = 0; offset <= expected.size(); offset += 97) {
+                assert(whole.source_offset(offset) == bytewise.source_offset(offset));
+            }
+        }
+    }
+
+    // Detections in UTF-16 content report where they are in the file.
+    {
+        const std::string data = "\xFF\xFE" + utf16(ascii_units(sentence), false);
+        TextNormalizer normalizer;
+        const auto hits = detect_pii(normalize(normalizer, data, 4096), PiiPatterns({}));
+        bool found_email = false;
+        for (const auto &hit : hits) {
+            if (hit.type != "email") continue;
+            found_email = true;
+            assert(normalizer.source_offset(hit.start) == 2 + 2 * sentence.find("alice"));
+            assert(normalizer.source_offset(hit.end) == 2 + 2 * sentence.find(','));
+        }
+        assert(found_email);
+    }
+
+    // Text that switches width every word, scanned the way the file watcher
+    // scans it: detections are mapped as they are found and the map only
+    // keeps the runs the PII window still covers.
+    {
+        const std::vector<uint16_t> word = {0x0416, 0x0430, 0x0440, 0x0443, ' '};  // Cyrillic, then a space
+        const std::string email = "id a.b@corp.example.com ";
+        std::vector<uint16_t> units = {0xFEFF};
+        size_t emails = 0;
+        while (units.size() < 4 * 1024 * 1024) {
+            for (int w = 0; w < 997; ++w) units.insert(units.end(), word.begin(), word.end());
+            const auto ascii = ascii_units(email);
+            units.insert(units.end(), ascii.begin(), ascii.end());
+            ++emails;
+        }
+        const std::string data = utf16(units, false);
+        const size_t chunk = 64 * 1024;
+        TextNormalizer normalizer;
+        PiiStream stream(PiiPatterns({}), 4096);
+        stream.map_offsets([&normalizer](uint64_t offset) { return normalizer.source_offset(offset); });
+        size_t peak = 0;
+        auto scan = [&](std::string_view text) {
+            stream.feed(text.data(), text.size());
+            normalizer.release_before(stream.pending_offset());
+            peak = std::max(peak, normalizer.map_entries());
+        };
+        for (size_t pos = 0; pos < data.size(); pos += chunk) {
+            scan(normalizer.feed(data.data() + pos, std::min(chunk, data.size() - pos)));
+        }
+        scan(normalizer.finish());
+        // Two runs per word: the whole file would need about 1.7 million.
+        assert(peak < 2 * (chunk + 4096) / 5);
+        size_t found = 0;
+        for (const auto &hit : stream.finish()) {
+            if (hit.type != "email") continue;
+            ++found;
+            assert(hit.end - hit.start == 2 * hit.value.size());
+            for (size_t i = 0; i < hit.value.size(); ++i) {
+                assert(data[hit.start + 2 * i] == hit.value[i] && data[hit.start + 2 * i + 1] == 0);
+            }
+        }
+        assert(found == emails);
+    }
+    return 0;
+}
+
+#endif
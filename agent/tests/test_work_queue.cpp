@@ -0,0 +1,53 @@
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../src/work_queue.h"
+
+#if defined(DLP_ENABLE_TESTS)
+
+int main() {
+    BoundedQueue<int> small(2);
+    assert(small.push(1) && small.push(2));
+    assert(!small.push(3));
+    assert(small.size() == 2);
+    int value = 0;
+    assert(small.pop(value) && value == 1);
+    assert(small.push(3));
+    small.close();
+    assert(!small.push(4));
+    assert(small.pop(value) && value == 2);
+    assert(small.pop(value) && value == 3);
+    assert(!small.pop(value));
+
+    // Every item pushed is popped exactly once; pushes against a full queue
+    // fail instead of blocking.
+    BoundedQueue<int> queue(64);
+    std::atomic<long long> popped_sum{0};
+    std::atomic<long long> pushed_sum{0};
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 4; ++c) {
+        consumers.emplace_back([&] {
+            int item = 0;
+            while (queue.pop(item)) popped_sum += item;
+        });
+    }
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 1; i <= 20000; ++i) {
+                int item = p * 100000 + i;
+                if (queue.push(item)) pushed_sum += item;
+            }
+        });
+    }
+    for (auto &t : producers) t.join();
+    queue.close();
+    for (auto &t : consumers) t.join();
+    assert(popped_sum == pushed_sum);
+    assert(queue.size() == 0);
+    return 0;
+}
+
+#endif